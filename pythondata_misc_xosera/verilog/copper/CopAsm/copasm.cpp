@@ -0,0 +1,359 @@
+// copasm.cpp - copasm command line driver (the assembler itself is in xlasm.cpp, see libxlasm.h to embed it)
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <thread>
+
+#include "xlasm.h"
+
+// output error and exit immediately
+[[noreturn]] static void fatal_error(const char * msg, ...) ATTRIBUTE((format(printf, 1, 2)));
+
+static void fatal_error(const char * msg, ...)
+{
+    va_list ap;
+    va_start(ap, msg);
+
+    printf(TERM_ERROR "FATAL ERROR: ");
+    vprintf(msg, ap);
+    printf(TERM_CLEAR "\n");
+
+    va_end(ap);
+
+    exit(xlasm::FATAL_EXIT_CODE);
+}
+
+// batch mode input (each assembled separately into its own output and listing)
+struct batch_job_t
+{
+    std::string input;
+    std::string output;
+    std::string messages;        // console messages (printed in input order when batch is done)
+    int32_t     rc;
+
+    batch_job_t() noexcept
+            : rc(EXIT_FAILURE)
+    {
+    }
+};
+
+// batch output name from pattern, with '%' replaced by input name without extension (like make %.h : %.casm)
+static std::string batch_output_name(const std::string & pattern, const std::string & input)
+{
+    std::string stem = input;
+    size_t      dot  = stem.find_last_of('.');
+    if (dot != std::string::npos && dot > 0 && stem.find_first_of("/\\", dot) == std::string::npos)
+        stem.erase(dot);
+
+    std::string name = pattern;
+    size_t      pct  = name.find('%');
+    if (pct != std::string::npos)
+        name.replace(pct, 1, stem);
+
+    return name;
+}
+
+// assemble each input separately using a pool of threads, INCLUDE files are read once and shared by all inputs
+static int32_t assemble_batch(const std::string &              archname,
+                              const std::vector<std::string> & source_files,
+                              const std::string &              object_pattern,
+                              const xlasm::opts_t &            opts,
+                              uint32_t                         num_threads)
+{
+    std::vector<batch_job_t> jobs(source_files.size());
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        jobs[i].input = source_files[i];
+        if (object_pattern.size())
+            jobs[i].output = batch_output_name(object_pattern, source_files[i]);
+    }
+
+    if (num_threads == 0)
+        num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0)
+        num_threads = 1;
+    if (num_threads > jobs.size())
+        num_threads = static_cast<uint32_t>(jobs.size());
+
+    xlasm::include_cache_t include_cache;
+    std::atomic<size_t>    next_job(0);
+
+    auto worker = [&]() {
+        size_t j;
+        while ((j = next_job++) < jobs.size())
+        {
+            xlasm xl(archname);
+            xl.msg_out.file  = nullptr;
+            xl.msg_out.text  = &jobs[j].messages;
+            xl.include_cache = &include_cache;
+
+            jobs[j].rc = xl.assemble(std::vector<std::string>(1, jobs[j].input), jobs[j].output, opts);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (uint32_t t = 1; t < num_threads; t++)
+        threads.push_back(std::thread(worker));
+    worker();
+    for (auto & t : threads)
+        t.join();
+
+    int32_t rc     = EXIT_SUCCESS;
+    int32_t failed = 0;
+    for (auto & job : jobs)
+    {
+        fputs(job.messages.c_str(), stdout);
+        if (job.rc != EXIT_SUCCESS)
+            failed++;
+        if (job.rc > rc)
+            rc = job.rc;
+    }
+
+    if (opts.verbose)
+    {
+        printf("%scopasm batch of " PR_DSIZET " file%s %s (%d failed) using %u thread%s\n",
+               failed ? "\n*** " : "",
+               jobs.size(),
+               jobs.size() == 1 ? "" : "s",
+               failed ? "FAILED" : "completed",
+               failed,
+               num_threads,
+               num_threads == 1 ? "" : "s");
+    }
+
+    return rc;
+}
+
+static void show_help()
+{
+    printf("copasm - XarkLabs Xosera \"Slim Copper\" Assembler\n");
+    printf("         Copyright 2022 Xark - MIT Licensed\n");
+    printf("\n");
+    printf("Usage:  copasm [options] <input files ...> [-o output.fmt]\n");
+    printf("        copasm -j <threads> [options] <input files ...> [-o %%.fmt]\n");
+    printf("\n");
+    printf("-b      maximum bytes hex per listing line (8-64, default 8)\n");
+    printf("-c      suppress listing inside false conditional (.LISTCOND false)\n");
+    printf("-d sym  define <sym>[=expression]\n");
+    printf("-i      add default include search path (tried if include fails)\n");
+    printf("-j      batch mode, assemble each input separately using threads (0 for one per CPU)\n");
+    printf("-k      no error-kill, continue assembly despite errors\n");
+    printf("-l      request listing file (uses output name with .lst)\n");
+    printf("-m      suppress macro expansion listing (.LISTMAC false)\n");
+    printf("-n      suppress macro name in listing (.MACNAME false)\n");
+    printf("-o      output file name (using extension format .c/.h or binary, %% is input name in batch mode)\n");
+    printf("-q      quiet operation\n");
+    printf("-v      verbose operation (repeat up to three times)\n");
+    printf("-x      add symbol cross-reference to end of listing file\n");
+    printf("\n");
+}
+
+int main(int argc, char ** argv)
+{
+    std::string              archname;
+    std::vector<std::string> source_files;
+    std::string              object_file;
+    xlasm::opts_t            opts;
+    bool                     batch       = false;
+    uint32_t                 num_threads = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (argv[i][0] == '-')
+        {
+            switch (argv[i][1])
+            {
+                case 'a':
+                    if (argv[i][2] != 0)
+                        archname = &argv[i][2];
+                    else if (i + 1 < argc)
+                        archname = argv[++i];
+                    else
+                        fatal_error("Expected architecture name after -a option");
+                    break;
+
+                case 'b':
+                    if (argv[i][2] != 0)
+                    {
+                        if (sscanf(&argv[i][2], "%u", &opts.listing_bytes) != 1)
+                            fatal_error("Expected number after -b listing bytes option (8 per line)");
+                    }
+                    else if (i + 1 < argc)
+                    {
+                        if (sscanf(argv[++i], "%u", &opts.listing_bytes) != 1)
+                            fatal_error("Expected number after -b listing bytes option (8 per line)");
+                    }
+                    else
+                    {
+                        fatal_error("Expected number after -b listing bytes option (8 per line)");
+                    }
+
+
+                    opts.listing_bytes = (opts.listing_bytes + 7) & ~7U;
+                    if (opts.listing_bytes < 8)
+                        opts.listing_bytes = 8;
+                    break;
+
+                case 'c':
+                    opts.suppress_false_conditionals = true;
+                    break;
+
+                case 'd':
+                    if (argv[i][2] != 0)
+                    {
+                        opts.define_sym.push_back(&argv[i][2]);
+                    }
+                    else if (i + 1 < argc)
+                    {
+                        opts.define_sym.push_back(argv[++i]);
+                    }
+                    else
+                    {
+                        fatal_error("Expected symbol after -d define sym option");
+                    }
+                    break;
+
+                case 'i':
+                    if (argv[i][2] != 0)
+                    {
+                        opts.include_path.push_back(&argv[i][2]);
+                    }
+                    else if (i + 1 < argc)
+                    {
+                        opts.include_path.push_back(argv[++i]);
+                    }
+                    else
+                    {
+                        fatal_error("Expected path after -i include path option");
+                    }
+                    break;
+
+                case 'h':
+                case '?': {
+                    show_help();
+                    exit(EXIT_SUCCESS);
+                }
+                case 'm':
+                    opts.suppress_macro_expansion = true;
+                    break;
+
+                case 'n':
+                    opts.suppress_macro_name = true;
+                    break;
+
+                case 'j':
+                    if (argv[i][2] != 0)
+                    {
+                        if (sscanf(&argv[i][2], "%u", &num_threads) != 1)
+                            fatal_error("Expected number after -j batch threads option (0 for one per CPU)");
+                    }
+                    else if (i + 1 < argc)
+                    {
+                        if (sscanf(argv[++i], "%u", &num_threads) != 1)
+                            fatal_error("Expected number after -j batch threads option (0 for one per CPU)");
+                    }
+                    else
+                    {
+                        fatal_error("Expected number after -j batch threads option (0 for one per CPU)");
+                    }
+                    batch = true;
+                    break;
+
+                case 'k':
+                    opts.no_error_kill = true;
+                    break;
+
+                case 'l':
+                    opts.listing = true;
+                    break;
+
+                case 'o':
+                    if (argv[i][2] != 0)
+                    {
+                        object_file = &argv[i][2];
+                    }
+                    else if (i + 1 < argc)
+                    {
+                        object_file = argv[++i];
+                    }
+                    else
+                    {
+                        fatal_error("Expected filename after -o output file option");
+                    }
+                    break;
+
+                case 'q':
+                    opts.verbose = 0;
+                    break;
+
+                case 'v':
+                    opts.verbose++;
+                    break;
+
+                case 'x':
+                    opts.xref = true;
+                    break;
+
+                default:
+                    show_help();
+                    fatal_error("Unrecognized option -%c", argv[i][1]);
+                    break;
+            }
+
+            continue;
+        }
+        source_files.push_back(std::string(argv[i]));
+    }
+
+    if (opts.verbose > 1)
+    {
+        if (opts.verbose == 2)
+            printf("Verbose status messages enabled.\n");
+        else if (opts.verbose > 2)
+            printf("Verbose status and debugging messages enabled.\n");
+    }
+
+    if (archname.size() == 0)
+        archname = "copper";
+
+    Ixlarch * initialarch = Ixlarch::find_arch(archname);
+
+    if (initialarch == nullptr)
+    {
+        printf("Supported architectures (with variants and identifiers):\n");
+        for (auto & a : Ixlarch::architectures)
+        {
+            printf("  %s\n", a->variant_names());
+        }
+        printf("\n");
+
+        fatal_error("Unrecognized architecture \"%s\".", archname.c_str());
+    }
+
+    if (!source_files.size())
+    {
+        show_help();
+        fatal_error("No input file(s) specified");
+    }
+
+    if (batch)
+    {
+        if (source_files.size() > 1 && object_file.size() && object_file.find('%') == std::string::npos)
+            fatal_error("Batch mode output name \"%s\" needs %% (replaced by each input name)", object_file.c_str());
+
+        return assemble_batch(archname, source_files, object_file, opts, num_threads);
+    }
+
+    xlasm xl(archname);
+
+    int rc = xl.assemble(source_files, object_file, opts);
+
+    return rc;
+}
+
+// EOF
@@ -0,0 +1,92 @@
+// libxlasm.cpp - assemble in memory (see libxlasm.h)
+
+#include <algorithm>
+#include <stdlib.h>
+
+#include "libxlasm.h"
+
+static bool comp_section_addr(const xlasm_section_t & lhs, const xlasm_section_t & rhs)
+{
+    return (lhs.load_addr == rhs.load_addr) ? lhs.name < rhs.name : lhs.load_addr < rhs.load_addr;
+}
+
+static bool comp_symbol_name(const xlasm_symbol_t & lhs, const xlasm_symbol_t & rhs)
+{
+    return lhs.name < rhs.name;
+}
+
+int32_t xlasm_assemble(const std::vector<xlasm_buffer_t> & sources,
+                       const std::vector<xlasm_buffer_t> & includes,
+                       const xlasm::opts_t &               opts,
+                       xlasm_result_t &                    result,
+                       const std::string &                 architecture)
+{
+    result = xlasm_result_t();
+
+    if (Ixlarch::find_arch(architecture) == nullptr)
+    {
+        xlasm::diag_t d;
+        d.level   = xlasm::diag_t::FATAL;
+        d.line    = 0;
+        d.message = "Unrecognized architecture \"" + architecture + "\".";
+        result.diagnostics.push_back(d);
+        result.rc = xlasm::FATAL_EXIT_CODE;
+
+        return result.rc;
+    }
+
+    xlasm xl(architecture);
+
+    // all output goes to result (nothing printed or written)
+    xl.msg_out.file = nullptr;
+    xl.msg_out.text = &result.messages;
+    if (opts.listing)
+        xl.listing_file.text = &result.listing;
+
+    for (auto it = includes.begin(); it != includes.end(); ++it)
+        xl.add_source_text(it->name, it->text.data(), it->text.size());
+
+    std::vector<std::string> names;
+    for (auto it = sources.begin(); it != sources.end(); ++it)
+    {
+        xl.add_source_text(it->name, it->text.data(), it->text.size());
+        names.push_back(it->name);
+    }
+
+    result.rc            = xl.assemble(names, std::string(), opts);
+    result.error_count   = static_cast<int32_t>(xl.error_count);
+    result.warning_count = static_cast<int32_t>(xl.warning_count);
+    result.crc32         = xl.crc_value;
+    result.diagnostics.swap(xl.diagnostics);
+
+    for (auto it = xl.sections.begin(); it != xl.sections.end(); ++it)
+    {
+        if (!it->data.size())
+            continue;
+
+        xlasm_section_t sec;
+        sec.name      = it->name;
+        sec.load_addr = it->load_addr;
+        sec.flags     = it->flags;
+        sec.data.swap(it->data);
+        result.sections.push_back(std::move(sec));
+    }
+    std::sort(result.sections.begin(), result.sections.end(), comp_section_addr);
+
+    for (auto it = xl.symbols.begin(); it != xl.symbols.end(); ++it)
+    {
+        if (it->type == xlasm::symbol_t::UNDEFINED || it->type == xlasm::symbol_t::INTERNAL)
+            continue;
+
+        xlasm_symbol_t sym;
+        sym.name     = it->name;
+        sym.type     = it->type;
+        sym.value    = it->value;
+        sym.str      = it->str;
+        sym.exported = std::find(xl.exports.begin(), xl.exports.end(), it->name) != xl.exports.end();
+        result.symbols.push_back(std::move(sym));
+    }
+    std::sort(result.symbols.begin(), result.symbols.end(), comp_symbol_name);
+
+    return result.rc;
+}
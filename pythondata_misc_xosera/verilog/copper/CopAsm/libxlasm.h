@@ -0,0 +1,72 @@
+// libxlasm.h - CopAsm (XLAsm) assembler library interface
+//
+// Assembles source text held in memory and returns the generated section bytes, symbols and diagnostics in memory.
+// Nothing is printed and no output or listing files are written (only INCLUDE files not given as buffers and
+// INCBIN files are read from disk).  Each call uses its own assembler state and the built-in architectures are
+// registered once (thread-safe), so several assemblies can run concurrently in one process.
+//
+// Link with bin/libxlasm.a (built by the CopAsm Makefile).
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "xlasm.h"
+
+// named source text
+struct xlasm_buffer_t
+{
+    std::string name;        // file name used in diagnostics and listing (and to INCLUDE it)
+    std::string text;        // source text (lines ending with "\n" or "\r\n")
+};
+
+// generated section (as copasm would write it for the section's load address)
+struct xlasm_section_t
+{
+    std::string          name;
+    int64_t              load_addr;        // load address (in 16-bit words for copper)
+    uint32_t             flags;            // xlasm::section_t flags (e.g., NOLOAD_FLAG)
+    std::vector<uint8_t> data;             // big-endian 16-bit words for copper
+};
+
+// defined symbol (as shown in the listing cross-reference)
+struct xlasm_symbol_t
+{
+    std::string            name;
+    xlasm::symbol_t::sym_t type;
+    int64_t                value;
+    std::string            str;             // STRING symbol expression (or REGISTER name)
+    bool                   exported;        // named with EXPORT
+};
+
+struct xlasm_result_t
+{
+    int32_t                      rc;                 // EXIT_SUCCESS, EXIT_FAILURE or xlasm::FATAL_EXIT_CODE
+    int32_t                      error_count;
+    int32_t                      warning_count;
+    uint32_t                     crc32;              // CRC-32 of output (0 if no output)
+    std::vector<xlasm_section_t> sections;           // non-empty sections (sorted by load address)
+    std::vector<xlasm_symbol_t>  symbols;            // sorted by name
+    std::vector<xlasm::diag_t>   diagnostics;        // errors, warnings and notices (in order reported)
+    std::string                  messages;           // console text copasm would have printed
+    std::string                  listing;            // listing text (if opts.listing)
+
+    xlasm_result_t() noexcept
+            : rc(EXIT_FAILURE)
+            , error_count(0)
+            , warning_count(0)
+            , crc32(0)
+    {
+    }
+};
+
+// Assemble sources (in order, as one output like the copasm command line) using opts (include path, defines,
+// listing etc.).  Buffers in includes are used in place of files with the same name by INCLUDE.  Returns
+// result.rc (EXIT_SUCCESS when assembled with no errors).
+int32_t xlasm_assemble(const std::vector<xlasm_buffer_t> & sources,
+                       const std::vector<xlasm_buffer_t> & includes,
+                       const xlasm::opts_t &               opts,
+                       xlasm_result_t &                    result,
+                       const std::string &                 architecture = "copper");
@@ -16,6 +16,11 @@
 #endif
 
 #include <sys/stat.h>
+#if !defined(_MSC_VER)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include "xlasm.h"
 #include "xlasmexpr.h"
@@ -56,16 +61,6 @@ static bool hasEnding(const std::string & fullString, const std::string & ending
 }
 #endif
 
-static void rtrim(std::string & str, const std::string & ws)
-{
-    size_t found;
-    found = str.find_last_not_of(ws);
-    if (found != std::string::npos)
-        str.erase(found + 1);
-    else
-        str.clear();        // str is all whitespace
-}
-
 // using these to avoid some "strict" type conversion warnings with system version returning int
 char uppercase(char v)
 {
@@ -77,21 +72,6 @@ char lowercase(char v)
     return static_cast<char>(::tolower(v));
 }
 
-// output error and exit immediately
-void fatal_error(const char * msg, ...)
-{
-    va_list ap;
-    va_start(ap, msg);
-
-    printf(TERM_ERROR "FATAL ERROR: ");
-    vprintf(msg, ap);
-    printf(TERM_CLEAR "\n");
-
-    va_end(ap);
-
-    exit(10);
-}
-
 Ixlarch::~Ixlarch()
 {
 }
@@ -108,6 +88,8 @@ void Ixlarch::register_arch(Ixlarch * arch)
 
 Ixlarch * Ixlarch::find_arch(const std::string & architecture)
 {
+    static copper copperarch;        // built-in architecture (registered once on first use, thread-safe)
+
     for (auto & a : Ixlarch::architectures)
     {
         if (a->set_variant(architecture))
@@ -123,12 +105,15 @@ Ixlarch * Ixlarch::find_arch(const std::string & architecture)
 xlasm::xlasm(const std::string & architecture)
         : initial_variant(architecture)
         , arch(nullptr)
+        , sections(&names)
+        , include_cache(nullptr)
+        , macros(&names)
+        , symbols(&names)
         , total_size_generated(0)
         , last_size_generated(0)
         , bytes_optimized(0)
         , undefined_sym_count(0)
         , line_sec_addr(0)
-        , listing_file(nullptr)
         , last_diag_file(nullptr)
         , undefined_section(nullptr)
         , sym_defined(nullptr)
@@ -149,6 +134,7 @@ xlasm::xlasm(const std::string & architecture)
         , prev_virtual_line_num(0)
         , pass_count(0)
         , last_diag_line(0)
+        , symbol_generation(0)
         , line_sec_org(false)
         , suppress_line_list(false)
         , suppress_line_listsource(false)
@@ -156,7 +142,8 @@ xlasm::xlasm(const std::string & architecture)
         , force_exit_assembly(false)
 {
     //	std::random_device rd;		// non-deterministic generator for seed
-    random_seed = 42;        // rd();
+    random_seed  = 42;        // rd();
+    msg_out.file = stdout;
 }
 
 bool xlasm::dollar_hex()
@@ -167,6 +154,24 @@ bool xlasm::dollar_hex()
 constexpr xlasm::directive_t xlasm::directives_list[];
 
 int32_t xlasm::assemble(const std::vector<std::string> & in_files, const std::string & out_file, const opts_t & opts)
+{
+    int32_t rc = FATAL_EXIT_CODE;
+
+    try
+    {
+        rc = do_assemble(in_files, out_file, opts);
+    }
+    catch (const fatal_exit &)
+    {
+        // message already reported by fatal_error
+    }
+
+    listing_file.close();
+
+    return rc;
+}
+
+int32_t xlasm::do_assemble(const std::vector<std::string> & in_files, const std::string & out_file, const opts_t & opts)
 {
     if (!in_files.size())
     {
@@ -265,13 +270,13 @@ int32_t xlasm::assemble(const std::vector<std::string> & in_files, const std::st
 
         dprintf("File \"%s\" read into memory (" PR_DSIZET " lines, " PR_U64 " bytes).\n",
                 it->c_str(),
-                source_files[*it].orig_line.size(),
+                source_files[*it].lines.size(),
                 source_files[*it].file_size);
     }
 
     do_passes();
 
-    printf("%scopasm %s%s with %d warning%s and %d error%s%s\n",
+    msg_out.printf("%scopasm %s%s with %d warning%s and %d error%s%s\n",
            error_count ? "\n*** " : "",
            ((error_count && !opt.no_error_kill) || force_exit_assembly) ? "FAILED" : "completed",
            (error_count == 0 && !force_exit_assembly) ? " successfully" : "",
@@ -289,9 +294,9 @@ int32_t xlasm::do_passes()
 {
     next_section_index = 1;
 
-    if (opt.listing)
+    if (opt.listing && !listing_file)
     {
-        listing_file = fopen(listing_filename.c_str(), "wt");
+        listing_file.file = fopen(listing_filename.c_str(), "wt");
 
         if (!listing_file)
             fatal_error("Opening listing file \"%s\" error: %s\n", listing_filename.c_str(), strerror(errno));
@@ -316,9 +321,9 @@ int32_t xlasm::do_passes()
     arch->reset(this);
 
     // add special symbols
-    add_sym(".", symbol_t::INTERNAL, 0x00);
-    add_sym(".rand16", symbol_t::INTERNAL, 0x00);
-    add_sym(".RAND16", symbol_t::INTERNAL, 0x00);
+    add_sym(".", symbol_t::INTERNAL, symbol_t::SPECIAL_PC);
+    add_sym(".rand16", symbol_t::INTERNAL, symbol_t::SPECIAL_RAND16);
+    add_sym(".RAND16", symbol_t::INTERNAL, symbol_t::SPECIAL_RAND16);
 
     do
     {
@@ -351,7 +356,7 @@ int32_t xlasm::do_passes()
         {
             if (error_count)
             {
-                printf("Continuing despite errors (-k option).\n");
+                msg_out.printf("Continuing despite errors (-k option).\n");
             }
             continue;
         }
@@ -374,7 +379,7 @@ int32_t xlasm::do_passes()
     }
     else
     {
-        printf("No output generated.\n");
+        msg_out.printf("No output generated.\n");
     }
 
     return 0;
@@ -398,7 +403,7 @@ int32_t xlasm::pass_reset()
     std::vector<section_t *> secs;
     for (auto it = sections.begin(); it != sections.end(); ++it)
     {
-        auto & sec = it->second;
+        auto & sec = *it;
         if (!sec.data.size())
             continue;
 
@@ -452,12 +457,13 @@ int32_t xlasm::pass_reset()
     auto it = symbols.begin();
     while (it != symbols.end())
     {
-        auto & sym = it->second;
+        auto & sym = *it;
         if (sym.type == symbol_t::UNDEFINED /*  || sym.type == symbol_t::VARIABLE */)
         {
             //			dprintf("Erasing symbol \"%s\" (value: 0x" PR_X64 "/" PR_D64 " \"%s\")\n", sym.name.c_str(),
             // sym.value, sym.value, sym.str.c_str());
             it = symbols.erase(it);
+            symbol_generation++;
         }
         else
             ++it;
@@ -556,7 +562,7 @@ int32_t xlasm::check_undefined()
 {
     for (auto it = symbols.begin(); it != symbols.end(); ++it)
     {
-        auto & sym = it->second;
+        auto & sym = *it;
         if (sym.type == symbol_t::UNDEFINED)
         {
             ctxt.file = sym.file_first_referenced;
@@ -649,7 +655,7 @@ int32_t xlasm::process_output()
     // collect output
     for (auto it = sections.begin(); it != sections.end(); ++it)
     {
-        auto & sec = it->second;
+        auto & sec = *it;
         if (!sec.data.size())
             continue;
 
@@ -698,7 +704,7 @@ int32_t xlasm::process_output()
 
                 dprintf("%s", secline.c_str());
                 if (listing_file)
-                    fprintf(listing_file, "%s", secline.c_str());
+                    listing_file.puts(secline.c_str());
             }
 #endif
             cur_load_addr = it->load_addr + static_cast<int64_t>(it->data.size());
@@ -953,7 +959,7 @@ int32_t xlasm::process_output()
                     {
                         for (auto expsym : exports)
                         {
-                            symbol_t sym = symbols[expsym];
+                            symbol_t & sym = symbols[expsym];
                             if (sym.type != symbol_t::UNDEFINED)
                                 fprintf(out,
                                         "static const uint16_t %s__%s  __attribute__ ((unused)) = %6" PRId64
@@ -995,7 +1001,8 @@ int32_t xlasm::process_output()
                     assert(false);
             }
         }
-        fclose(out);
+        if (out)
+            fclose(out);
         out = nullptr;
     }
 
@@ -1020,7 +1027,7 @@ int32_t xlasm::process_file(source_t & f)
     ctxt.file                = &f;
 
     // iterate over all lines in file
-    for (ctxt.line = 0; ctxt.line < f.src_line.size(); ctxt.line++)
+    for (ctxt.line = 0; ctxt.line < f.lines.size(); ctxt.line++)
     {
         rc = process_line();
         if (rc)
@@ -1040,7 +1047,7 @@ int32_t xlasm::process_file(source_t & f)
     if (error_count >= MAXERROR_COUNT)
     {
         error("Exiting due to maximum error count (%d)", error_count);
-        exit(10);
+        throw fatal_exit();
     }
 
     if (func_section != nullptr)
@@ -1056,7 +1063,7 @@ int32_t xlasm::process_line()
 {
     int32_t rc = 0;
 
-    const std::vector<std::string> & tokens = ctxt.file->src_line[ctxt.line];
+    const token_line_t tokens = ctxt.file->line_tokens(ctxt.line);
 
     if (opt.verbose > 3 && tokens.size())
     {
@@ -1256,7 +1263,7 @@ int32_t xlasm::process_line_listing()
         }
         post_messages.clear();
         if (outline.size())
-            fputs(outline.c_str(), listing_file);
+            listing_file.puts(outline.c_str());
         return 0;
     }
 
@@ -1429,7 +1436,7 @@ int32_t xlasm::process_line_listing()
 
         if (!suppress_line_listsource)
         {
-            strprintf(outline, "\t%s", ctxt.file->orig_line[ctxt.line].c_str());
+            strprintf(outline, "\t%s", ctxt.file->lines[ctxt.line].text.c_str());
         }
         else
             strprintf(outline, "\t<alignment pad>");
@@ -1474,7 +1481,7 @@ int32_t xlasm::process_line_listing()
         }
         post_messages.clear();
 
-        fputs(outline.c_str(), listing_file);
+        listing_file.puts(outline.c_str());
     }
 
     sym_defined = nullptr;
@@ -1501,7 +1508,7 @@ int32_t xlasm::process_xref()
 
     for (auto it = symbols.begin(); it != symbols.end(); ++it)
     {
-        auto & sym = it->second;
+        auto & sym = *it;
 
         if (sym.type == symbol_t::INTERNAL)
             continue;
@@ -1518,7 +1525,7 @@ int32_t xlasm::process_xref()
 
     std::sort(sym_xref.begin(), sym_xref.end(), comp_xref_name);
 
-    fprintf(listing_file, "\n\nSymbols (sorted by name):\n\n");
+    listing_file.puts("\n\nSymbols (sorted by name):\n\n");
 
     for (auto it = std::begin(sym_xref); it != std::end(sym_xref); ++it)
     {
@@ -1540,12 +1547,12 @@ int32_t xlasm::process_xref()
             strprintf(outline, "\"%.64s\"", sym->str.c_str());
         strprintf(outline, "\n");
 
-        fputs(outline.c_str(), listing_file);
+        listing_file.puts(outline.c_str());
     }
 
     std::sort(std::begin(sym_xref), std::end(sym_xref), comp_xref_value);
 
-    fprintf(listing_file, "\n\nSymbols (sorted by value):\n\n");
+    listing_file.puts("\n\nSymbols (sorted by value):\n\n");
 
     for (auto it = std::begin(sym_xref); it != std::end(sym_xref); ++it)
     {
@@ -1567,17 +1574,17 @@ int32_t xlasm::process_xref()
             strprintf(outline, "\"%.64s\"", sym->str.c_str());
         strprintf(outline, "\n");
 
-        fputs(outline.c_str(), listing_file);
+        listing_file.puts(outline.c_str());
     }
 
     return 0;
 }
 
-int32_t xlasm::process_directive(uint32_t                         idx,
-                                 const std::string &              directive,
-                                 const std::string &              label,
-                                 size_t                           cur_token,
-                                 const std::vector<std::string> & tokens)
+int32_t xlasm::process_directive(uint32_t             idx,
+                                 const std::string &  directive,
+                                 const std::string &  label,
+                                 size_t               cur_token,
+                                 const token_line_t & tokens)
 {
     // macro directives first (only processed if current conditional true)
     if (ctxt.conditional.state)
@@ -1602,8 +1609,8 @@ int32_t xlasm::process_directive(uint32_t                         idx,
     // if currently defining a macro, only save other directives/opcodes for processing when macro is invoked
     if (ctxt.macrodef_ptr != nullptr)
     {
-        ctxt.macrodef_ptr->body.src_line.push_back(tokens);
-        ctxt.macrodef_ptr->body.file_size += ctxt.file->orig_line[ctxt.line].size();
+        ctxt.macrodef_ptr->body.add_line(ctxt.file->lines[ctxt.line].text, tokens);
+        ctxt.macrodef_ptr->body.file_size += ctxt.file->lines[ctxt.line].text.size();
 
         return 0;
     }
@@ -2000,24 +2007,8 @@ int32_t xlasm::process_directive(uint32_t                         idx,
             std::string basename = removeQuotes(tokens[cur_token]);
             std::string filename = basename;
 
-            source_t & f = source_files[basename];
-
-            int e = f.read_file(this, basename, filename);
-            if (e)
-            {
-                for (int i = 0; i < (int)opt.include_path.size(); i++)
-                {
-                    filename = opt.include_path[i] + std::string("/") + basename;
-                    int ie   = f.read_file(this, basename, filename);
-
-                    if (!ie)
-                    {
-                        e = ie;
-                        break;
-                    }
-                }
-            }
-
+            source_t * f = nullptr;
+            int        e = read_include(basename, filename, f);
             if (e)
                 fatal_error("%s:%d: Error reading %s file \"%s\": %s",
                             ctxt.file->name.c_str(),
@@ -2034,11 +2025,11 @@ int32_t xlasm::process_directive(uint32_t                         idx,
                 notice(2,
                        "Including file \"%s\" (" PR_DSIZET " lines, " PR_D64 " bytes)",
                        filename.c_str(),
-                       f.orig_line.size(),
-                       f.file_size);
+                       f->lines.size(),
+                       f->file_size);
             }
             context_stack.push(ctxt);
-            process_file(f);
+            process_file(*f);
             ctxt = context_stack.top();
             context_stack.pop();
             if (ctxt.pass == context_t::PASS_1 || opt.verbose > 2)
@@ -2207,6 +2198,7 @@ int32_t xlasm::process_directive(uint32_t                         idx,
             }
 
             symbols.erase(label);
+            symbol_generation++;
             notice(3, "%s %s symbol \"%s\"", directive.c_str(), ntype.c_str(), label.c_str());
 
             return 0;
@@ -2370,11 +2362,11 @@ int32_t xlasm::process_directive(uint32_t                         idx,
                       directive.c_str());
 
             bool moretokens = false;
-            for (auto it = ctxt.file->src_line.begin() + static_cast<ssize_t>(ctxt.line) + 1;
-                 it != ctxt.file->src_line.end();
+            for (auto it = ctxt.file->lines.begin() + static_cast<ssize_t>(ctxt.line) + 1;
+                 it != ctxt.file->lines.end();
                  ++it)
             {
-                if (it->size() != 0)
+                if (it->num_tokens != 0)
                 {
                     moretokens = true;
                     break;
@@ -2744,10 +2736,10 @@ int32_t xlasm::process_directive(uint32_t                         idx,
     return 0;
 }
 
-int32_t xlasm::process_section(const std::string &              directive,
-                               const std::string &              label,
-                               size_t                           cur_token,
-                               const std::vector<std::string> & tokens)
+int32_t xlasm::process_section(const std::string &  directive,
+                               const std::string &  label,
+                               size_t               cur_token,
+                               const token_line_t & tokens)
 {
     if (label.size())
     {
@@ -2953,12 +2945,12 @@ int32_t xlasm::align_output(size_t pot)
     return 0;
 }
 
-int64_t xlasm::eval_tokens(const std::string &              cmd,
-                           std::string &                    exprstr,
-                           size_t &                         cur_token,
-                           const std::vector<std::string> & tokens,
-                           int32_t                          expected_args,
-                           int64_t                          defval)
+int64_t xlasm::eval_tokens(const std::string &  cmd,
+                           std::string &        exprstr,
+                           size_t &             cur_token,
+                           const token_line_t & tokens,
+                           int32_t              expected_args,
+                           int64_t              defval)
 {
     int64_t result = defval;
 
@@ -3014,10 +3006,10 @@ int64_t xlasm::eval_tokens(const std::string &              cmd,
     return result;
 }
 
-bool xlasm::define_macro_begin(const std::string &              directive,
-                               const std::string &              label,
-                               size_t                           cur_token,
-                               const std::vector<std::string> & tokens)
+bool xlasm::define_macro_begin(const std::string &  directive,
+                               const std::string &  label,
+                               size_t               cur_token,
+                               const token_line_t & tokens)
 {
     if (ctxt.macrodef_ptr != nullptr)
     {
@@ -3134,10 +3126,10 @@ bool xlasm::define_macro_begin(const std::string &              directive,
     return 0;
 }
 
-bool xlasm::define_macro_end(const std::string &              directive,
-                             const std::string &              label,
-                             size_t                           cur_token,
-                             const std::vector<std::string> & tokens)
+bool xlasm::define_macro_end(const std::string &  directive,
+                             const std::string &  label,
+                             size_t               cur_token,
+                             const token_line_t & tokens)
 {
     if (ctxt.macrodef_ptr == nullptr)
     {
@@ -3160,15 +3152,14 @@ bool xlasm::define_macro_end(const std::string &              directive,
            "%s for MACRO \"%s\" (" PR_DSIZET " lines)",
            directive.c_str(),
            ctxt.macrodef_ptr->name.c_str(),
-           ctxt.macrodef_ptr->body.src_line.size());
+           ctxt.macrodef_ptr->body.lines.size());
 
 #if 1
-    int32_t mlinenum = 1;
-    for (auto md = ctxt.macrodef_ptr->body.src_line.begin(); md != ctxt.macrodef_ptr->body.src_line.end();
-         ++md, ++mlinenum)
+    for (uint32_t ml = 0; ml < ctxt.macrodef_ptr->body.lines.size(); ml++)
     {
-        std::string mline;
-        for (auto mt = (*md).begin(); mt != (*md).end(); ++mt)
+        token_line_t md = ctxt.macrodef_ptr->body.line_tokens(ml);
+        std::string  mline;
+        for (auto mt = md.begin(); mt != md.end(); ++mt)
         {
             if (mline.size())
                 mline += " ";
@@ -3176,7 +3167,7 @@ bool xlasm::define_macro_end(const std::string &              directive,
             mline += *mt;
             mline += "|";
         }
-        notice(3, "%6d: %s", mlinenum, mline.c_str());
+        notice(3, "%6u: %s", ml + 1, mline.c_str());
     }
 #endif
 
@@ -3185,7 +3176,7 @@ bool xlasm::define_macro_end(const std::string &              directive,
     return 0;
 }
 
-xlasm::source_t & xlasm::expand_macro(std::string & name, size_t cur_token, const std::vector<std::string> & tokens)
+xlasm::source_t & xlasm::expand_macro(std::string & name, size_t cur_token, const token_line_t & tokens)
 {
     macro_t & m = macros[name];
 
@@ -3307,7 +3298,8 @@ xlasm::source_t & xlasm::expand_macro(std::string & name, size_t cur_token, cons
         s.file_size  = m.body.file_size;
         s.line_start = m.body.line_start;
 
-        s.src_line = m.body.src_line;
+        s.lines  = m.body.lines;
+        s.tokens = m.body.tokens;
 
         std::string unique_str;
         strprintf(unique_str, "_%s_%d", m.name.c_str(), m.invoke_count);
@@ -3316,8 +3308,12 @@ xlasm::source_t & xlasm::expand_macro(std::string & name, size_t cur_token, cons
         bool        spammed = false;
         std::string sn;
         std::string mn;
-        for (auto lit = s.src_line.begin(); lit != s.src_line.end(); ++lit)
+        std::string tok;
+        for (auto lit = s.lines.begin(); lit != s.lines.end(); ++lit)
         {
+            auto line_begin = s.tokens.begin() + lit->first_token;
+            auto line_end   = line_begin + lit->num_tokens;
+
             // {
             // 	std::string fake_line;
 
@@ -3336,10 +3332,15 @@ xlasm::source_t & xlasm::expand_macro(std::string & name, size_t cur_token, cons
             // 	s.orig_line.push_back(fake_line);
             // 	dprintf("BEFORE: " PR_DSIZET ": %s\n", lit - s.src_line.begin(), fake_line.c_str());
             // }
-            for (auto tit = lit->begin(); tit != lit->end(); ++tit)
+            for (auto tit = line_begin; tit != line_end; ++tit)
             {
+                // only a token with a backslash can be changed (and then gets new text in the expanded source)
+                if (memchr(tit->c_str(), '\\', tit->size()) == nullptr)
+                    continue;
+
+                tok                 = *tit;
                 size_t search_start = 0;
-                bool   hasquotes    = (tit->size() && ((*tit)[0] == '\"' || (*tit)[0] == '\''));
+                bool   hasquotes    = (tok.size() && (tok[0] == '\"' || tok[0] == '\''));
 
                 uint32_t reps;
                 for (reps = 0; reps < MAXMACROREPS_WARNING; reps++)
@@ -3348,13 +3349,13 @@ xlasm::source_t & xlasm::expand_macro(std::string & name, size_t cur_token, cons
                     size_t replace_pos    = 0;
                     size_t replace_length = 0;
 
-                    if (search_start >= tit->size())
+                    if (search_start >= tok.size())
                         break;
 
-                    search_start = tit->find("\\", search_start);
+                    search_start = tok.find("\\", search_start);
 
                     // if no backslash or backslash at end, we are done
-                    if (search_start == std::string::npos || search_start + 1 >= tit->size())
+                    if (search_start == std::string::npos || search_start + 1 >= tok.size())
                         break;
 
                     if (reps == 0)
@@ -3362,27 +3363,27 @@ xlasm::source_t & xlasm::expand_macro(std::string & name, size_t cur_token, cons
                                "MACRO %s<%s>:" PR_DSIZET ": replacing arguments in: %s",
                                name.c_str(),
                                key.c_str(),
-                               lit - s.src_line.begin(),
-                               tit->c_str());
+                               lit - s.lines.begin(),
+                               tok.c_str());
 
                     // if two backslashes, search for next backslash
-                    if ((*tit)[search_start + 1] == '\\')
+                    if (tok[search_start + 1] == '\\')
                     {
                         search_start += 2;
                         continue;
                     }
 
-                    if ((*tit)[search_start + 1] == '@')        // '\@' unique-ifier?
+                    if (tok[search_start + 1] == '@')        // '\@' unique-ifier?
                     {
-                        tit->erase(search_start, 2);
-                        tit->insert(search_start, unique_str);
+                        tok.erase(search_start, 2);
+                        tok.insert(search_start, unique_str);
                         continue;
                     }
 
                     // is this a numeric parameter after backslash?
-                    if (isdigit((*tit)[search_start + 1]))
+                    if (isdigit(tok[search_start + 1]))
                     {
-                        const char * startptr = &(*tit)[search_start + 1];
+                        const char * startptr = &tok[search_start + 1];
                         char *       endptr   = nullptr;
                         parameter_idx         = strtoul(startptr, &endptr, 10);
                         replace_length        = static_cast<size_t>(endptr - startptr);
@@ -3398,13 +3399,13 @@ xlasm::source_t & xlasm::expand_macro(std::string & name, size_t cur_token, cons
                                 sn = "\\";
                                 sn += *ait;
                                 //								dprintf("Check for '%s' in '%s'...\n", sn.c_str(),
-                                //(*tit).c_str());
-                                size_t mp = tit->find(sn, search_start);
-                                if (mp != std::string::npos && (mp == 0 || (*tit)[mp - 1] != '\\'))
+                                //tok.c_str());
+                                size_t mp = tok.find(sn, search_start);
+                                if (mp != std::string::npos && (mp == 0 || tok[mp - 1] != '\\'))
                                 {
                                     //									dprintf("Found '%s' in '%s' at pos "
                                     // PR_DSIZET
-                                    //"\n",  sn.c_str(), tit->c_str(), mp);
+                                    //"\n",  sn.c_str(), tok.c_str(), mp);
                                     mn             = sn;
                                     parameter_idx  = static_cast<size_t>((ait - m.args.begin())) + 1;
                                     replace_length = ait->size();
@@ -3426,13 +3427,13 @@ xlasm::source_t & xlasm::expand_macro(std::string & name, size_t cur_token, cons
                     ///"...\n",
                     /// mn.c_str(), reptxt.c_str(), replace_pos, replace_length);
 
-                    tit->erase(replace_pos, replace_length + 1);
+                    tok.erase(replace_pos, replace_length + 1);
                     if (hasquotes)
-                        tit->insert(replace_pos, reQuote(reptxt));
+                        tok.insert(replace_pos, reQuote(reptxt));
                     else
-                        tit->insert(replace_pos, reptxt);
+                        tok.insert(replace_pos, reptxt);
 
-                    //					dprintf("Result '%s'...\n", tit->c_str());
+                    //					dprintf("Result '%s'...\n", tok.c_str());
                 }
 
                 if (reps >= MAXMACROREPS_WARNING && !spammed)
@@ -3442,6 +3443,8 @@ xlasm::source_t & xlasm::expand_macro(std::string & name, size_t cur_token, cons
                           MAXMACROREPS_WARNING);
                     spammed = true;
                 }
+
+                *tit = s.text.add(tok);
             }
 
             {
@@ -3452,16 +3455,16 @@ xlasm::source_t & xlasm::expand_macro(std::string & name, size_t cur_token, cons
 
                 // TODO: Not happy with this macro fake listing
                 size_t idx = 0;
-                for (auto tit = lit->begin(); tit != lit->end(); ++tit, idx++)
+                for (auto tit = line_begin; tit != line_end; ++tit, idx++)
                 {
                     if (idx == 0 && tit->back() != ':')
                         fake_line += " ";
                     fake_line += *tit;
-                    if (tit + 1 != lit->end() && idx < 2)
+                    if (tit + 1 != line_end && idx < 2)
                         fake_line += " ";
                 }
-                s.orig_line.push_back(fake_line);
-                //				dprintf("AFTER : " PR_DSIZET ": %s\n", lit - s.src_line.begin(), fake_line.c_str());
+                lit->text = s.text.add(fake_line);
+                //				dprintf("AFTER : " PR_DSIZET ": %s\n", lit - s.lines.begin(), fake_line.c_str());
             }
         }
     }
@@ -3478,15 +3481,19 @@ xlasm::source_t & xlasm::expand_macro(std::string & name, size_t cur_token, cons
 
 int64_t xlasm::symbol_value(xlasm * xl, const char * name, bool * undefined)
 {
-    int64_t     result = 0;
-    std::string sym_name(name);
+    string_id_t id = xl->names.intern(name, strlen(name));
+
+    return xl->resolved_symbol_value(xl->symbols.get(id), xl->names.str(id), undefined);
+}
 
-    symbol_t & sym = xl->symbols[sym_name];
+int64_t xlasm::resolved_symbol_value(symbol_t & sym, const token_t & sym_name, bool * undefined)
+{
+    int64_t result = 0;
 
     if (!sym.file_first_referenced)
     {
-        sym.file_first_referenced = xl->ctxt.file;
-        sym.line_first_referenced = xl->ctxt.line;
+        sym.file_first_referenced = ctxt.file;
+        sym.line_first_referenced = ctxt.line;
     }
     if (undefined)
         *undefined = false;
@@ -3494,16 +3501,16 @@ int64_t xlasm::symbol_value(xlasm * xl, const char * name, bool * undefined)
     if (sym.type == symbol_t::UNDEFINED)
     {
         if (!sym.name.size())
-            sym.name = name;
+            sym.name = sym_name;
 
         if (undefined)
             *undefined = true;
 
-        xl->undefined_sym_count++;
+        undefined_sym_count++;
     }
     else if (sym.type == symbol_t::INTERNAL)
     {
-        result = xl->lookup_special_symbol(sym_name);
+        result = lookup_special_symbol(sym);
     }
     else if (sym.type == symbol_t::STRING)
     {
@@ -3511,7 +3518,7 @@ int64_t xlasm::symbol_value(xlasm * xl, const char * name, bool * undefined)
 
         if (sym.str.size())
         {
-            if (!expr.evaluate(xl, sym.str.c_str(), &result))
+            if (!expr.evaluate(this, sym.str.c_str(), &result))
             {
                 if (undefined)
                     *undefined = true;
@@ -3519,14 +3526,16 @@ int64_t xlasm::symbol_value(xlasm * xl, const char * name, bool * undefined)
         }
         else
         {
-            if (xl->ctxt.pass == xlasm::context_t::PASS_2)
-                xl->warning(
-                    "Evaluating empty string in symbol \"%s\" as 0x" PR_X64 "/" PR_D64 "", name, result, result);
+            if (ctxt.pass == context_t::PASS_2)
+                warning("Evaluating empty string in symbol \"%s\" as 0x" PR_X64 "/" PR_D64 "",
+                        sym_name.c_str(),
+                        result,
+                        result);
         }
     }
     else if (sym.type == symbol_t::REGISTER)
     {
-        xl->error("Cannot use register \"%s\" as a value", name);
+        error("Cannot use register \"%s\" as a value", sym_name.c_str());
         if (undefined)
             *undefined = true;
     }
@@ -3555,11 +3564,11 @@ int32_t xlasm::lookup_register_symbol(const std::string & sym_name)
     if (result >= 0)
         return result;
 
-    auto sit = symbols.find(sym_name);
-    if (sit == symbols.end())
+    symbol_t * sit = symbols.find(sym_name);
+    if (sit == nullptr)
         return -1;
 
-    symbol_t & sym = sit->second;
+    symbol_t & sym = *sit;
 
     if (!sym.file_first_referenced)
     {
@@ -3587,50 +3596,40 @@ int32_t xlasm::lookup_register_symbol(const std::string & sym_name)
     return result;
 }
 
-int64_t xlasm::lookup_special_symbol(const std::string & sym_name)
+int64_t xlasm::lookup_special_symbol(const symbol_t & sym)
 {
-    if (sym_name == ".")
-    {
-        return ctxt.section->addr + static_cast<int64_t>(ctxt.section->data.size() >> 1);
-    }
-    else if (sym_name.compare(0, 5, ".rand") == 0 || sym_name.compare(0, 5, ".RAND") == 0)
+    switch (sym.value)
     {
-        uint32_t rngbits = 16;
+        case symbol_t::SPECIAL_PC:
+            return ctxt.section->addr + static_cast<int64_t>(ctxt.section->data.size() >> 1);
 
-        if (sym_name.compare(5, std::string::npos, "16") == 0)
-        {
-            rngbits = 16;
-        }
-        else
-        {
-            error("Unrecognized .RAND size \"%s\" (must be 16)?", sym_name.c_str());
+        case symbol_t::SPECIAL_RAND16: {
+            uint32_t rngbits = 16;
 
-            return 0;
-        }
+            // mix all 64-bits together as needed
 
-        // mix all 64-bits together as needed
+            uint64_t v    = 0;
+            uint64_t r    = static_cast<uint64_t>(rng());
+            uint64_t mask = rngbits > 64 ? (uint64_t{1} << rngbits) - 1 : uint64_t{~0U};
 
-        uint64_t v    = 0;
-        uint64_t r    = static_cast<uint64_t>(rng());
-        uint64_t mask = rngbits > 64 ? (uint64_t{1} << rngbits) - 1 : uint64_t{~0U};
+            for (uint32_t i = 0; i < 64; i += rngbits)
+            {
+                v += (r & mask);
+                v += (v >> rngbits);
+                v &= mask;
+                r >>= rngbits;
+            }
 
-        for (uint32_t i = 0; i < 64; i += rngbits)
-        {
-            v += (r & mask);
-            v += (v >> rngbits);
-            v &= mask;
-            r >>= rngbits;
+            return static_cast<int64_t>(v);
         }
-
-        return static_cast<int64_t>(v);
     }
 
-    error("Unrecognized special symbol \"%s\"?", sym_name.c_str());
+    error("Unrecognized special symbol \"%s\"?", sym.name.c_str());
 
     return 0;
 }
 
-std::string xlasm::token_message(size_t cur_token, const std::vector<std::string> & tokens)
+std::string xlasm::token_message(size_t cur_token, const token_line_t & tokens)
 {
     std::string msg;
 
@@ -3797,62 +3796,214 @@ std::string xlasm::reQuote(const std::string & str)
     return newstr;
 }
 
-int32_t xlasm::source_t::read_file(xlasm * xa, const std::string & n, const std::string & fn)
+void xlasm::text_arena_t::reserve(size_t bytes)
 {
-    if (file_size)
+    if (bytes > avail)
     {
-        //		dprintf("File '%s' has already been loaded\n", name.c_str());
-        assert(name == n);
-        return 0;
+        size_t chunk_size = bytes > CHUNK_SIZE ? bytes : static_cast<size_t>(CHUNK_SIZE);
+        chunks.emplace_back(new char[chunk_size]);
+        next  = chunks.back().get();
+        avail = chunk_size;
+    }
+}
+
+xlasm::token_t xlasm::text_arena_t::add(const char * s, size_t len)
+{
+    reserve(len + 1);
+
+    char * str = next;
+    memcpy(str, s, len);
+    str[len] = '\0';
+    next += len + 1;
+    avail -= len + 1;
+
+    return token_t(str, len);
+}
+
+uint32_t xlasm::string_pool_t::hash(const char * s, size_t len)
+{
+    uint32_t h = 2166136261U;        // FNV-1a
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= static_cast<uint8_t>(s[i]);
+        h *= 16777619U;
     }
+    return h;
+}
 
-    name = n;
+xlasm::string_id_t xlasm::string_pool_t::find(const char * s, size_t len) const
+{
+    if (strings.size() == 0)
+        return NO_ID;
 
-    FILE * fp = fopen(fn.c_str(), "r");
-    if (!fp)
+    uint32_t h    = hash(s, len);
+    size_t   mask = table.size() - 1;
+    for (size_t i = h & mask; table[i] != NO_ID; i = (i + 1) & mask)
     {
-        return errno;
+        string_id_t id = table[i];
+        if (hashes[id] == h && strings[id].len == len && memcmp(strings[id].str, s, len) == 0)
+            return id;
     }
 
-    char        line_buff[MAX_LINE_LENGTH] = {0};
-    std::string nline;
+    return NO_ID;
+}
+
+xlasm::string_id_t xlasm::string_pool_t::intern(const char * s, size_t len)
+{
+    string_id_t id = find(s, len);
+    if (id != NO_ID)
+        return id;
 
-    while (!ferror(fp) && fgets(line_buff, sizeof(line_buff) - 1, fp) != nullptr)
+    // keep table at most half full
+    if ((strings.size() + 1) * 2 > table.size())
     {
-        nline = line_buff;
-        file_size += nline.size();
-        rtrim(nline, " \r\n");
-        if (nline.size() < 3 || nline[0] != '#' || nline[1] != ' ' || (nline[2] < '0' && nline[2] > '9'))
+        table.assign(table.size() ? table.size() * 2 : 1024, NO_ID);
+        size_t mask = table.size() - 1;
+        for (string_id_t i = 0; i < strings.size(); i++)
         {
-            orig_line.push_back(nline);
+            size_t t = hashes[i] & mask;
+            while (table[t] != NO_ID)
+                t = (t + 1) & mask;
+            table[t] = i;
         }
     }
 
-    if (!feof(fp))
+    uint32_t h    = hash(s, len);
+    size_t   mask = table.size() - 1;
+    size_t   t    = h & mask;
+    while (table[t] != NO_ID)
+        t = (t + 1) & mask;
+
+    id       = static_cast<string_id_t>(strings.size());
+    table[t] = id;
+    strings.push_back(text.add(s, len));
+    hashes.push_back(h);
+
+    return id;
+}
+
+void xlasm::source_t::add_line(const token_t & line_text, const token_line_t & toks)
+{
+    line_t l;
+    l.text        = line_text;
+    l.first_token = static_cast<uint32_t>(tokens.size());
+    l.num_tokens  = static_cast<uint32_t>(toks.size());
+    tokens.insert(tokens.end(), toks.begin(), toks.end());
+    lines.push_back(l);
+}
+
+int32_t xlasm::source_t::read_file(xlasm * xa, const std::string & n, const std::string & fn)
+{
+    if (name.size())
     {
-        int e = errno;
+        //		dprintf("File '%s' has already been loaded\n", name.c_str());
+        assert(name == n);
+        return 0;
+    }
+
+    // memory-map the file (or read it all at once when it can't be mapped), lines are scanned in place and only the
+    // kept line text and token text is copied (into the text arena, so no per-line or per-token allocations)
+    const char *      data = nullptr;
+    size_t            size = 0;
+    std::vector<char> buffer;
+#if !defined(_MSC_VER)
+    void * map = MAP_FAILED;
+    {
+        int fd = open(fn.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return errno;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        {
+            size = static_cast<size_t>(st.st_size);
+            map  = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+    }
+
+    if (map != MAP_FAILED)
+    {
+        data = static_cast<const char *>(map);
+    }
+    else
+#endif
+    {
+        FILE * fp = fopen(fn.c_str(), "rb");
+        if (!fp)
+        {
+            return errno;
+        }
+
+        char   block[MAX_LINE_LENGTH];
+        size_t len;
+        while ((len = fread(block, 1, sizeof(block), fp)) != 0)
+            buffer.insert(buffer.end(), block, block + len);
+
+        if (ferror(fp))
+        {
+            int e = errno;
+            fclose(fp);
+            return e;
+        }
         fclose(fp);
-        return e;
+
+        data = buffer.data();
+        size = buffer.size();
     }
-    fclose(fp);
+
+    read_text(xa, n, data, size);
+
+#if !defined(_MSC_VER)
+    if (map != MAP_FAILED)
+        munmap(map, size);
+#endif
+
+    return 0;
+}
+
+// tokenize source text (from a file or a memory buffer)
+void xlasm::source_t::read_text(xlasm * xa, const std::string & n, const char * data, size_t size)
+{
+    name      = n;
+    file_size = size;
 
     // do preliminary processing on input file to make it more regular WRT whitespace and removing comments
-    std::vector<std::string> cooked_tokens;
-    std::string              token;
-    uint32_t                 ln = 0;
-    for (std::vector<std::string>::iterator it = orig_line.begin(); it != orig_line.end(); ++it, ln++)
+    std::string  token;        // token being cooked (can differ from source text, e.g., "label :" or missing quote)
+    const char * data_end = data + size;
+    for (const char * lp = data; lp < data_end;)
     {
+        const char * eol      = static_cast<const char *>(memchr(lp, '\n', static_cast<size_t>(data_end - lp)));
+        const char * line_ptr = lp;
+        lp                    = eol ? eol + 1 : data_end;
+
+        size_t line_len = static_cast<size_t>((eol ? eol : data_end) - line_ptr);
+        while (line_len && (line_ptr[line_len - 1] == ' ' || line_ptr[line_len - 1] == '\r'))
+            line_len--;
+
+        // skip C preprocessor line markers
+        if (line_len >= 3 && line_ptr[0] == '#' && line_ptr[1] == ' ')
+            continue;
+
+        line_t l;
+        l.text        = text.add(line_ptr, line_len);
+        l.first_token = static_cast<uint32_t>(tokens.size());
+        l.num_tokens  = 0;
+        lines.push_back(l);
+
         char inquotes   = 0;
         bool escape     = false;
         bool whitespace = false;
 
-        cooked_tokens.clear();
         token.clear();
 
-        if (it->c_str()[0] != '#')
+        const char * line_end = l.text.end();
+        if (l.text[0] != '#')
         {
             char c = 0, prev_c = 0;
-            for (std::string::iterator sit = it->begin(); sit != it->end(); ++sit)
+            for (const char * sit = l.text.begin(); sit != line_end; ++sit)
             {
                 c = *sit;
 
@@ -3863,7 +4014,7 @@ int32_t xlasm::source_t::read_file(xlasm * xa, const std::string & n, const std:
                         break;
 
                     // C++ style comment start
-                    if (c == '/' && (sit + 1 != it->end() && sit[1] == '/'))
+                    if (c == '/' && (sit + 1 != line_end && sit[1] == '/'))
                         break;
 
                     bool ws = (isspace(c) || c < ' ');
@@ -3887,7 +4038,7 @@ int32_t xlasm::source_t::read_file(xlasm * xa, const std::string & n, const std:
                         if (c != ':')
                         {
                             if (token.size())
-                                cooked_tokens.push_back(token);
+                                tokens.push_back(text.add(token));
                             token.clear();
                         }
                     }
@@ -3898,8 +4049,8 @@ int32_t xlasm::source_t::read_file(xlasm * xa, const std::string & n, const std:
                         // must be two char token
                         if (prev_c && strchr("!=<>&|*", prev_c) != nullptr)
                         {
-                            char s[3] = {prev_c, c, '\0'};
-                            cooked_tokens.push_back(s);
+                            char s[2] = {prev_c, c};
+                            tokens.push_back(text.add(s, 2));
                             prev_c = 0;
 
                             continue;
@@ -3907,11 +4058,11 @@ int32_t xlasm::source_t::read_file(xlasm * xa, const std::string & n, const std:
 
                         if (token.size())
                         {
-                            cooked_tokens.push_back(token);
+                            tokens.push_back(text.add(token));
                             token.clear();
                         }
 
-                        char next_c = ((sit + 1) != it->end()) ? sit[1] : '\0';
+                        char next_c = ((sit + 1) != line_end) ? sit[1] : '\0';
 
                         bool two_char = (c == '!' && next_c == '=') ||        // !=
                                         (c == '=' && next_c == '=') ||        // ==
@@ -3926,8 +4077,7 @@ int32_t xlasm::source_t::read_file(xlasm * xa, const std::string & n, const std:
                         // single char token
                         if (!two_char)
                         {
-                            char s[2] = {c, '\0'};
-                            cooked_tokens.push_back(s);
+                            tokens.push_back(text.add(&c, 1));
                             prev_c = 0;
                         }
                         else
@@ -3941,10 +4091,9 @@ int32_t xlasm::source_t::read_file(xlasm * xa, const std::string & n, const std:
                     // break up operator characters into separate tokens
                     if (strchr(",()[]{}#+-/^~%$", c) != nullptr)        // NOTE: removed @ for unique-ifier
                     {
-                        char s[2] = {c, '\0'};
                         if (token.size())
-                            cooked_tokens.push_back(token);
-                        cooked_tokens.push_back(s);
+                            tokens.push_back(text.add(token));
+                        tokens.push_back(text.add(&c, 1));
                         token.clear();
 
                         continue;
@@ -3961,7 +4110,7 @@ int32_t xlasm::source_t::read_file(xlasm * xa, const std::string & n, const std:
                         {
                             inquotes = 0;
                             token += c;
-                            cooked_tokens.push_back(token);
+                            tokens.push_back(text.add(token));
                             token.clear();
 
                             continue;
@@ -3988,42 +4137,132 @@ int32_t xlasm::source_t::read_file(xlasm * xa, const std::string & n, const std:
         if (inquotes)
         {
             token += inquotes;
-            source_t * old_file = xa->ctxt.file;
-            uint32_t   old_line = xa->ctxt.line;
-            xa->ctxt.file       = this;
-            xa->ctxt.line       = ln;
-            xa->warning("Missing ending quote added.\n");
-            xa->ctxt.file = old_file;
-            xa->ctxt.line = old_line;
+            missing_quote_lines.push_back(static_cast<uint32_t>(lines.size() - 1));
+            if (xa)
+                xa->warn_missing_quote(this, missing_quote_lines.back());
         }
 
         if (token.size())
-            cooked_tokens.push_back(token);
+            tokens.push_back(text.add(token));
+
+        lines.back().num_tokens = static_cast<uint32_t>(tokens.size()) - lines.back().first_token;
 
 #if 0
-		dprintf("" PR_D64 "=", cooked_tokens.size());
-		for (auto dit = cooked_tokens.begin(); dit != cooked_tokens.end(); ++dit)
+		dprintf("%u=", lines.back().num_tokens);
+		for (auto dit : line_tokens(static_cast<uint32_t>(lines.size() - 1)))
 		{
-			dprintf("[%s] ", dit->c_str());
+			dprintf("[%s] ", dit.c_str());
 		}
 		dprintf("\n");
 #endif
+    }
+}
 
-        src_line.push_back(cooked_tokens);
+// read and tokenize an INCLUDE file once for every assembly using this cache (a failed read is also remembered)
+int32_t xlasm::include_cache_t::read_file(const std::string & n, const std::string & fn, source_t *& f)
+{
+    entry_t * e;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::unique_ptr<entry_t> & ep = files[n + '\n' + fn];
+        if (!ep)
+            ep.reset(new entry_t());
+        e = ep.get();
     }
 
-    return 0;
+    std::lock_guard<std::mutex> lock(e->mutex);
+    if (!e->loaded)
+    {
+        e->error  = e->source.read_file(nullptr, n, fn);        // no assembly to warn, see read_include
+        e->loaded = true;
+    }
+    f = &e->source;
+
+    return e->error;
+}
+
+// find INCLUDE file basename (trying include path if needed) and read it (once), returns first read error (or 0)
+int32_t xlasm::read_include(const std::string & basename, std::string & filename, source_t *& f)
+{
+    auto sit = source_files.find(basename);
+    if (sit != source_files.end() && sit->second.name.size())        // already read (or added as source text)
+    {
+        f = &sit->second;
+        return 0;
+    }
+
+    auto cit = shared_files.find(basename);
+    if (cit != shared_files.end())
+    {
+        f = cit->second;
+        return 0;
+    }
+
+    int32_t e = 0;
+    for (size_t i = 0; i <= opt.include_path.size(); i++)
+    {
+        filename = i ? opt.include_path[i - 1] + std::string("/") + basename : basename;
+
+        int32_t ie;
+        if (include_cache)
+        {
+            ie = include_cache->read_file(basename, filename, f);
+        }
+        else
+        {
+            f  = &source_files[basename];
+            ie = f->read_file(this, basename, filename);
+        }
+
+        if (!ie)
+        {
+            if (include_cache)
+            {
+                shared_files[basename] = f;
+                for (auto line : f->missing_quote_lines)
+                    warn_missing_quote(f, line);
+            }
+            return 0;
+        }
+
+        if (!e)
+            e = ie;
+    }
+
+    return e;
+}
+
+// warn about a missing ending quote (added when source was tokenized) on line of source f
+void xlasm::warn_missing_quote(source_t * f, uint32_t line)
+{
+    source_t * old_file = ctxt.file;
+    uint32_t   old_line = ctxt.line;
+    ctxt.file           = f;
+    ctxt.line           = line;
+    warning("Missing ending quote added.\n");
+    ctxt.file = old_file;
+    ctxt.line = old_line;
+}
+
+// add source text held in memory, used instead of reading a file with this name (for inputs or includes)
+void xlasm::add_source_text(const std::string & name, const char * text, size_t size)
+{
+    source_t & f = source_files[name];
+    if (f.name.size())
+        f = source_t();
+    f.read_text(this, name, text, size);
 }
 
 void xlasm::diag_showline()
 {
     if (!last_diag_file)
         return;
-    printf("%s:%d: %s\n",
-           last_diag_file->name.c_str(),
-           last_diag_line + last_diag_file->line_start,
-           last_diag_file->orig_line[last_diag_line].c_str());
-    fflush(stdout);
+    msg_out.printf("%s:%d: %s\n",
+                   last_diag_file->name.c_str(),
+                   last_diag_line + last_diag_file->line_start,
+                   last_diag_file->lines[last_diag_line].text.c_str());
+    msg_out.flush();
     last_diag_file = nullptr;
 }
 
@@ -4034,12 +4273,49 @@ void xlasm::diag_flush()
         diag_showline();
     }
 
-    fflush(stdout);
+    msg_out.flush();
 
     last_diag_file = ctxt.file;
     last_diag_line = ctxt.line;
 }
 
+void xlasm::add_diag(diag_t::level_t level, const char * msg, va_list va)
+{
+    diagnostics.emplace_back();
+    diag_t & d = diagnostics.back();
+
+    d.level = level;
+    d.line  = 0;
+    if (ctxt.file && ctxt.file->name.size())
+    {
+        d.file = ctxt.file->name;
+        d.line = ctxt.line + ctxt.file->line_start;
+    }
+    if (ctxt.macroexp_ptr)
+        d.macro = ctxt.macroexp_ptr->name;
+    vstrprintf(d.message, msg, va);
+}
+
+// output error and abandon assembly (assemble returns FATAL_EXIT_CODE)
+void xlasm::fatal_error(const char * msg, ...)
+{
+    va_list ap;
+    va_start(ap, msg);
+
+    msg_out.printf(TERM_ERROR "FATAL ERROR: ");
+    msg_out.vprintf(msg, ap);
+    msg_out.printf(TERM_CLEAR "\n");
+    msg_out.flush();
+
+    va_end(ap);
+
+    va_start(ap, msg);
+    add_diag(diag_t::FATAL, msg, ap);
+    va_end(ap);
+
+    throw fatal_exit();
+}
+
 void xlasm::error(const char * msg, ...)
 {
     va_list ap;
@@ -4047,13 +4323,17 @@ void xlasm::error(const char * msg, ...)
 
     diag_flush();
 
-    printf("%s:%d: ", ctxt.file->name.c_str(), ctxt.line + ctxt.file->line_start);
-    printf(TERM_ERROR "ERROR: ");
+    msg_out.printf("%s:%d: ", ctxt.file->name.c_str(), ctxt.line + ctxt.file->line_start);
+    msg_out.printf(TERM_ERROR "ERROR: ");
     if (ctxt.macroexp_ptr)
-        printf("[in MACRO \"%s\"] ", ctxt.macroexp_ptr->name.c_str());
-    vprintf(msg, ap);
-    printf(TERM_CLEAR "\n");
+        msg_out.printf("[in MACRO \"%s\"] ", ctxt.macroexp_ptr->name.c_str());
+    msg_out.vprintf(msg, ap);
+    msg_out.printf(TERM_CLEAR "\n");
+
+    va_end(ap);
 
+    va_start(ap, msg);
+    add_diag(diag_t::ERROR, msg, ap);
     va_end(ap);
 
     if (ctxt.pass == context_t::PASS_2)
@@ -4071,7 +4351,7 @@ void xlasm::error(const char * msg, ...)
         va_end(ap);
     }
 
-    fflush(stdout);
+    msg_out.flush();
 
     error_count++;
 }
@@ -4087,15 +4367,19 @@ void xlasm::warning(const char * msg, ...)
     diag_flush();
 
     if (ctxt.file)
-        printf("%s:%d: ", ctxt.file->name.c_str(), ctxt.line + ctxt.file->line_start);
-    printf(TERM_WARN "WARNING: ");
+        msg_out.printf("%s:%d: ", ctxt.file->name.c_str(), ctxt.line + ctxt.file->line_start);
+    msg_out.printf(TERM_WARN "WARNING: ");
     if (ctxt.macroexp_ptr)
-        printf("[in MACRO \"%s\"] ", ctxt.macroexp_ptr->name.c_str());
-    vprintf(msg, ap);
-    printf(TERM_CLEAR "\n");
+        msg_out.printf("[in MACRO \"%s\"] ", ctxt.macroexp_ptr->name.c_str());
+    msg_out.vprintf(msg, ap);
+    msg_out.printf(TERM_CLEAR "\n");
 
     va_end(ap);
 
+    va_start(ap, msg);
+    add_diag(diag_t::WARNING, msg, ap);
+    va_end(ap);
+
     if (ctxt.pass == context_t::PASS_2)
     {
         std::string outmsg;
@@ -4111,7 +4395,7 @@ void xlasm::warning(const char * msg, ...)
         va_end(ap);
     }
 
-    fflush(stdout);
+    msg_out.flush();
 
     warning_count++;
 }
@@ -4130,15 +4414,19 @@ void xlasm::notice(int32_t level, const char * msg, ...)
     diag_flush();
 
     if (ctxt.file)
-        printf("%s:%d: ", ctxt.file->name.c_str(), ctxt.line + ctxt.file->line_start);
-    printf("NOTE: ");
+        msg_out.printf("%s:%d: ", ctxt.file->name.c_str(), ctxt.line + ctxt.file->line_start);
+    msg_out.printf("NOTE: ");
     if (ctxt.macroexp_ptr)
-        printf("[in MACRO \"%s\"] ", ctxt.macroexp_ptr->name.c_str());
-    vprintf(msg, ap);
-    printf("\n");
+        msg_out.printf("[in MACRO \"%s\"] ", ctxt.macroexp_ptr->name.c_str());
+    msg_out.vprintf(msg, ap);
+    msg_out.printf("\n");
 
     va_end(ap);
 
+    va_start(ap, msg);
+    add_diag(diag_t::NOTE, msg, ap);
+    va_end(ap);
+
     if (ctxt.pass == context_t::PASS_2)
     {
         std::string outmsg;
@@ -4154,7 +4442,7 @@ void xlasm::notice(int32_t level, const char * msg, ...)
         va_end(ap);
     }
 
-    fflush(stdout);
+    msg_out.flush();
 
     last_diag_file = nullptr;
 }
@@ -4251,11 +4539,10 @@ bool xlasm::check_truncation_unsigned(const std::string & cmd, int64_t v, uint32
 
 void xlasm::add_sym(const char * name, symbol_t::sym_t type, int64_t value)
 {
-    std::string n(name);
-    symbol_t &  sym = symbols[n];
+    symbol_t & sym = symbols[name];
     assert(sym.name.size() == 0);
 
-    sym.name    = n;
+    sym.name    = name;
     sym.type    = type;
     sym.value   = value;
     sym.section = ctxt.section;
@@ -4263,8 +4550,8 @@ void xlasm::add_sym(const char * name, symbol_t::sym_t type, int64_t value)
 
 void xlasm::remove_sym(const char * name)
 {
-    std::string n(name);
     symbols.erase(name);
+    symbol_generation++;
 }
 
 void vstrprintf(std::string & str, const char * fmt, va_list va)
@@ -4289,203 +4576,64 @@ void strprintf(std::string & str, const char * fmt, ...)
     va_end(ap);
 }
 
-static void show_help()
+void xlasm::output_t::puts(const char * str)
 {
-    printf("copasm - XarkLabs Xosera \"Slim Copper\" Assembler\n");
-    printf("         Copyright 2022 Xark - MIT Licensed\n");
-    printf("\n");
-    printf("Usage:  copasm [options] <input files ...> [-o output.fmt]\n");
-    printf("\n");
-    printf("-b      maximum bytes hex per listing line (8-64, default 8)\n");
-    printf("-c      suppress listing inside false conditional (.LISTCOND false)\n");
-    printf("-d sym  define <sym>[=expression]\n");
-    printf("-i      add default include search path (tried if include fails)\n");
-    printf("-k      no error-kill, continue assembly despite errors\n");
-    printf("-l      request listing file (uses output name with .lst)\n");
-    printf("-m      suppress macro expansion listing (.LISTMAC false)\n");
-    printf("-n      suppress macro name in listing (.MACNAME false)\n");
-    printf("-o      output file name (using extension format .c/.h or binary)\n");
-    printf("-q      quiet operation\n");
-    printf("-v      verbose operation (repeat up to three times)\n");
-    printf("-x      add symbol cross-reference to end of listing file\n");
-    printf("\n");
+    if (file)
+        fputs(str, file);
+    else if (text)
+        text->append(str);
 }
 
-int main(int argc, char ** argv)
+void xlasm::output_t::printf(const char * fmt, ...)
 {
-    std::string              archname;
-    std::vector<std::string> source_files;
-    std::string              object_file;
-    xlasm::opts_t            opts;
-
-    for (int i = 1; i < argc; i++)
-    {
-        if (argv[i][0] == '-')
-        {
-            switch (argv[i][1])
-            {
-                case 'a':
-                    if (argv[i][2] != 0)
-                        archname = &argv[i][2];
-                    else if (i + 1 < argc)
-                        archname = argv[++i];
-                    else
-                        fatal_error("Expected architecture name after -a option");
-                    break;
-
-                case 'b':
-                    if (argv[i][2] != 0)
-                    {
-                        if (sscanf(&argv[i][2], "%u", &opts.listing_bytes) != 1)
-                            fatal_error("Expected number after -b listing bytes option (8 per line)");
-                    }
-                    else if (i + 1 < argc)
-                    {
-                        if (sscanf(argv[++i], "%u", &opts.listing_bytes) != 1)
-                            fatal_error("Expected number after -b listing bytes option (8 per line)");
-                    }
-                    else
-                    {
-                        fatal_error("Expected number after -b listing bytes option (8 per line)");
-                    }
-
-
-                    opts.listing_bytes = (opts.listing_bytes + 7) & ~7U;
-                    if (opts.listing_bytes < 8)
-                        opts.listing_bytes = 8;
-                    break;
-
-                case 'c':
-                    opts.suppress_false_conditionals = true;
-                    break;
-
-                case 'd':
-                    if (argv[i][2] != 0)
-                    {
-                        opts.define_sym.push_back(&argv[i][2]);
-                    }
-                    else if (i + 1 < argc)
-                    {
-                        opts.define_sym.push_back(argv[++i]);
-                    }
-                    else
-                    {
-                        fatal_error("Expected symbol after -d define sym option");
-                    }
-                    break;
-
-                case 'i':
-                    if (argv[i][2] != 0)
-                    {
-                        opts.include_path.push_back(&argv[i][2]);
-                    }
-                    else if (i + 1 < argc)
-                    {
-                        opts.include_path.push_back(argv[++i]);
-                    }
-                    else
-                    {
-                        fatal_error("Expected path after -i include path option");
-                    }
-                    break;
-
-                case 'h':
-                case '?': {
-                    show_help();
-                    exit(EXIT_SUCCESS);
-                }
-                case 'm':
-                    opts.suppress_macro_expansion = true;
-                    break;
-
-                case 'n':
-                    opts.suppress_macro_name = true;
-                    break;
-
-                case 'k':
-                    opts.no_error_kill = true;
-                    break;
-
-                case 'l':
-                    opts.listing = true;
-                    break;
-
-                case 'o':
-                    if (argv[i][2] != 0)
-                    {
-                        object_file = &argv[i][2];
-                    }
-                    else if (i + 1 < argc)
-                    {
-                        object_file = argv[++i];
-                    }
-                    else
-                    {
-                        fatal_error("Expected filename after -o output file option");
-                    }
-                    break;
-
-                case 'q':
-                    opts.verbose = 0;
-                    break;
-
-                case 'v':
-                    opts.verbose++;
-                    break;
-
-                case 'x':
-                    opts.xref = true;
-                    break;
+    va_list ap;
+    va_start(ap, fmt);
 
-                default:
-                    show_help();
-                    fatal_error("Unrecognized option -%c", argv[i][1]);
-                    break;
-            }
+    vprintf(fmt, ap);
 
-            continue;
-        }
-        source_files.push_back(std::string(argv[i]));
-    }
+    va_end(ap);
+}
 
-    if (opts.verbose > 1)
+void xlasm::output_t::vprintf(const char * fmt, va_list va)
+{
+    if (file)
     {
-        if (opts.verbose == 2)
-            printf("Verbose status messages enabled.\n");
-        else if (opts.verbose > 2)
-            printf("Verbose status and debugging messages enabled.\n");
+        vfprintf(file, fmt, va);
     }
-
-    copper copperarch;
-
-    if (archname.size() == 0)
-        archname = "copper";
-
-    Ixlarch * initialarch = Ixlarch::find_arch(archname);
-
-    if (initialarch == nullptr)
+    else if (text)
     {
-        printf("Supported architectures (with variants and identifiers):\n");
-        for (auto & a : Ixlarch::architectures)
+        va_list va2;
+        va_copy(va2, va);
+
+        char buf[MAX_LINE_LENGTH];
+        int  len = vsnprintf(buf, sizeof(buf), fmt, va);
+        if (len >= 0 && static_cast<size_t>(len) < sizeof(buf))
         {
-            printf("  %s\n", a->variant_names());
+            text->append(buf, static_cast<size_t>(len));
+        }
+        else if (len >= 0)        // longer than a line, format again directly into text
+        {
+            size_t start = text->size();
+            text->resize(start + static_cast<size_t>(len) + 1);
+            vsnprintf(&(*text)[start], static_cast<size_t>(len) + 1, fmt, va2);
+            text->resize(start + static_cast<size_t>(len));
         }
-        printf("\n");
-
-        fatal_error("Unrecognized architecture \"%s\".", archname.c_str());
-    }
 
-    if (!source_files.size())
-    {
-        show_help();
-        fatal_error("No input file(s) specified");
+        va_end(va2);
     }
+}
 
-    xlasm xl(archname);
-
-    int rc = xl.assemble(source_files, object_file, opts);
+void xlasm::output_t::flush()
+{
+    if (file)
+        fflush(file);
+}
 
-    return rc;
+void xlasm::output_t::close()
+{
+    if (file && file != stdout)
+        fclose(file);
+    file = nullptr;
 }
 
 // EOF
@@ -4,7 +4,11 @@
 
 #include <cinttypes>
 #include <cstdarg>
+#include <cstdio>
+#include <cstring>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <random>
 #include <stack>
 #include <stdint.h>
@@ -39,8 +43,8 @@
 #define dprintf(x, ...)                                                                                                \
     if (opt.verbose)                                                                                                   \
     {                                                                                                                  \
-        printf(x, ##__VA_ARGS__);                                                                                      \
-        fflush(stdout);                                                                                                \
+        msg_out.printf(x, ##__VA_ARGS__);                                                                              \
+        msg_out.flush();                                                                                               \
     }                                                                                                                  \
     while (0)
 #else
@@ -49,11 +53,10 @@
 
 #define UNICODE_SUPPORT 0
 
-[[noreturn]] void fatal_error(const char * msg, ...) ATTRIBUTE((noreturn)) ATTRIBUTE((format(printf, 1, 2)));
-void              vstrprintf(std::string & str, const char * fmt, va_list va) ATTRIBUTE((format(printf, 2, 0)));
-void              strprintf(std::string & str, const char * fmt, ...) ATTRIBUTE((format(printf, 2, 3)));
-char              uppercase(char v);
-char              lowercase(char v);
+void vstrprintf(std::string & str, const char * fmt, va_list va) ATTRIBUTE((format(printf, 2, 0)));
+void strprintf(std::string & str, const char * fmt, ...) ATTRIBUTE((format(printf, 2, 3)));
+char uppercase(char v);
+char lowercase(char v);
 
 #define MAX_LINE_LENGTH 4096
 #define NUM_ELEMENTS(a) (sizeof(a) / sizeof(a[0]))
@@ -98,22 +101,512 @@ struct xlasm
         }
     };
 
+    // destination for console messages or listing text, a FILE or a string (when assembling in memory)
+    struct output_t
+    {
+        FILE *        file;
+        std::string * text;
+
+        output_t() noexcept
+                : file(nullptr)
+                , text(nullptr)
+        {
+        }
+        explicit operator bool() const
+        {
+            return file != nullptr || text != nullptr;
+        }
+        void puts(const char * str);
+        void printf(const char * fmt, ...) ATTRIBUTE((format(printf, 2, 3)));
+        void vprintf(const char * fmt, va_list va) ATTRIBUTE((format(printf, 2, 0)));
+        void flush();
+        void close();        // close file (unless stdout)
+    };
+
+    // diagnostic message (also kept for library users, see libxlasm.h)
+    struct diag_t
+    {
+        enum level_t
+        {
+            NOTE,
+            WARNING,
+            ERROR,
+            FATAL
+        };
+
+        level_t     level;
+        std::string file;         // source file name (empty if not from a source line)
+        uint32_t    line;         // source line number (1 based, 0 if no line)
+        std::string macro;        // name of MACRO being expanded (or empty)
+        std::string message;
+    };
+
+    // thrown by fatal_error to abandon the assembly (caught by assemble)
+    struct fatal_exit
+    {
+    };
+
+    // view of NUL terminated text in a text_arena_t (tokens are never copied into individual strings)
+    struct token_t
+    {
+        const char * str;
+        uint32_t     len;
+
+        token_t() noexcept
+                : str("")
+                , len(0)
+        {
+        }
+        token_t(const char * s, size_t l) noexcept
+                : str(s)
+                , len(static_cast<uint32_t>(l))
+        {
+        }
+
+        size_t size() const
+        {
+            return len;
+        }
+        const char * c_str() const
+        {
+            return str;
+        }
+        const char * begin() const
+        {
+            return str;
+        }
+        const char * end() const
+        {
+            return str + len;
+        }
+        char back() const
+        {
+            return str[len - 1];
+        }
+        char operator[](size_t i) const
+        {
+            return str[i];
+        }
+        operator std::string() const
+        {
+            return std::string(str, len);
+        }
+        bool operator==(const char * s) const
+        {
+            return strncmp(str, s, len) == 0 && s[len] == '\0';
+        }
+        bool operator==(const std::string & s) const
+        {
+            return s.size() == len && memcmp(str, s.data(), len) == 0;
+        }
+        bool operator!=(const char * s) const
+        {
+            return !(*this == s);
+        }
+        bool operator!=(const std::string & s) const
+        {
+            return !(*this == s);
+        }
+    };
+
+    // append-only storage for token and line text (text never moves until the arena is destroyed)
+    struct text_arena_t
+    {
+        enum
+        {
+            CHUNK_SIZE = 64 * 1024
+        };
+
+        std::vector<std::unique_ptr<char[]>> chunks;
+        char *                               next;         // next free byte in chunks.back()
+        size_t                               avail;        // free bytes in chunks.back()
+
+        text_arena_t() noexcept
+                : next(nullptr)
+                , avail(0)
+        {
+        }
+        void    reserve(size_t bytes);        // make sure next bytes will fit in current chunk
+        token_t add(const char * s, size_t len);
+        token_t add(const std::string & s)
+        {
+            return add(s.data(), s.size());
+        }
+    };
+
+    typedef uint32_t string_id_t;
+
+    // interned strings, each distinct string is stored once and identified by a small id (so symbol, macro and
+    // section tables hash and compare an id instead of a freshly built std::string on every lookup)
+    struct string_pool_t
+    {
+        enum : string_id_t
+        {
+            NO_ID = ~0U
+        };
+
+        std::vector<token_t>     strings;        // interned text (by id)
+        std::vector<uint32_t>    hashes;         // hash of interned text (by id)
+        std::vector<string_id_t> table;          // open addressing hash table of ids (power of two size)
+        text_arena_t             text;
+
+        string_id_t intern(const char * s, size_t len);           // return id of string (adding it if new)
+        string_id_t find(const char * s, size_t len) const;        // return id of string or NO_ID if not interned
+        const token_t & str(string_id_t id) const
+        {
+            return strings[id];
+        }
+        static uint32_t hash(const char * s, size_t len);
+    };
+
+    // fixed address records allocated in chunks (erased records are recycled instead of freed)
+    template<typename T>
+    struct record_arena_t
+    {
+        enum
+        {
+            CHUNK_RECORDS = 256
+        };
+
+        std::vector<std::unique_ptr<T[]>> chunks;
+        std::vector<T *>                  free_records;
+        size_t                            next;        // next unused record in chunks.back()
+
+        record_arena_t() noexcept
+                : next(CHUNK_RECORDS)
+        {
+        }
+        T * alloc()
+        {
+            if (free_records.size())
+            {
+                T * rec = free_records.back();
+                free_records.pop_back();
+                return rec;
+            }
+            if (next == CHUNK_RECORDS)
+            {
+                chunks.emplace_back(new T[CHUNK_RECORDS]);
+                next = 0;
+            }
+            return &chunks.back()[next++];
+        }
+        void free(T * rec)
+        {
+            *rec = T();
+            free_records.push_back(rec);
+        }
+    };
+
+    // table of records keyed by interned name id (open addressing with linear probing, erased entries leave a
+    // tombstone until the next rehash so erasing while iterating is safe)
+    template<typename T>
+    struct intern_map_t
+    {
+        enum : string_id_t
+        {
+            EMPTY     = string_pool_t::NO_ID,
+            TOMBSTONE = string_pool_t::NO_ID - 1
+        };
+
+        struct slot_t
+        {
+            string_id_t id;
+            T *         rec;
+        };
+
+        struct iterator
+        {
+            slot_t * cur;
+            slot_t * last;
+
+            iterator(slot_t * c, slot_t * l) noexcept
+                    : cur(c)
+                    , last(l)
+            {
+                skip();
+            }
+            void skip()
+            {
+                while (cur != last && cur->rec == nullptr)
+                    ++cur;
+            }
+            T & operator*() const
+            {
+                return *cur->rec;
+            }
+            T * operator->() const
+            {
+                return cur->rec;
+            }
+            iterator & operator++()
+            {
+                ++cur;
+                skip();
+                return *this;
+            }
+            bool operator!=(const iterator & rhs) const
+            {
+                return cur != rhs.cur;
+            }
+            bool operator==(const iterator & rhs) const
+            {
+                return cur == rhs.cur;
+            }
+        };
+
+        string_pool_t *     pool;
+        std::vector<slot_t> slots;              // power of two size
+        size_t              num_records;        // records in table
+        size_t              used;               // slots with records or tombstones
+        record_arena_t<T>   records;
+
+        explicit intern_map_t(string_pool_t * p) noexcept
+                : pool(p)
+                , num_records(0)
+                , used(0)
+        {
+        }
+
+        // find record (or nullptr), names not already interned can't be in the table
+        T * find(const char * s, size_t len)
+        {
+            string_id_t id = pool->find(s, len);
+            return id == string_pool_t::NO_ID ? nullptr : find_id(id);
+        }
+        T * find(const std::string & key)
+        {
+            return find(key.data(), key.size());
+        }
+        T * find(const token_t & key)
+        {
+            return find(key.str, key.len);
+        }
+        size_t count(const std::string & key)
+        {
+            return find(key) ? 1 : 0;
+        }
+
+        // find record, creating a default one if not present
+        T & operator[](const char * key)
+        {
+            return get(pool->intern(key, strlen(key)));
+        }
+        T & operator[](const std::string & key)
+        {
+            return get(pool->intern(key.data(), key.size()));
+        }
+        T & operator[](const token_t & key)
+        {
+            return get(pool->intern(key.str, key.len));
+        }
+
+        T * find_id(string_id_t id)
+        {
+            if (num_records == 0)
+                return nullptr;
+            size_t mask = slots.size() - 1;
+            for (size_t i = hash_id(id) & mask;; i = (i + 1) & mask)
+            {
+                if (slots[i].id == id)
+                    return slots[i].rec;
+                if (slots[i].id == EMPTY)
+                    return nullptr;
+            }
+        }
+        T & get(string_id_t id)
+        {
+            if ((used + 1) * 4 > slots.size() * 3)
+                rehash();
+            size_t   mask      = slots.size() - 1;
+            slot_t * tombstone = nullptr;
+            for (size_t i = hash_id(id) & mask;; i = (i + 1) & mask)
+            {
+                slot_t & slot = slots[i];
+                if (slot.id == id)
+                    return *slot.rec;
+                if (slot.id == TOMBSTONE && tombstone == nullptr)
+                    tombstone = &slot;
+                if (slot.id == EMPTY)
+                {
+                    if (tombstone == nullptr)
+                    {
+                        tombstone = &slot;
+                        used++;
+                    }
+                    tombstone->id  = id;
+                    tombstone->rec = records.alloc();
+                    num_records++;
+                    return *tombstone->rec;
+                }
+            }
+        }
+
+        size_t erase(const std::string & key)
+        {
+            string_id_t id = pool->find(key.data(), key.size());
+            if (id == string_pool_t::NO_ID || num_records == 0)
+                return 0;
+            size_t mask = slots.size() - 1;
+            for (size_t i = hash_id(id) & mask;; i = (i + 1) & mask)
+            {
+                if (slots[i].id == id)
+                {
+                    erase(iterator(&slots[i], slots.data() + slots.size()));
+                    return 1;
+                }
+                if (slots[i].id == EMPTY)
+                    return 0;
+            }
+        }
+        iterator erase(iterator it)
+        {
+            records.free(it.cur->rec);
+            it.cur->id  = TOMBSTONE;
+            it.cur->rec = nullptr;
+            num_records--;
+            ++it;
+            return it;
+        }
+        void clear()
+        {
+            for (auto it = slots.begin(); it != slots.end(); ++it)
+            {
+                if (it->rec)
+                    records.free(it->rec);
+                it->id  = EMPTY;
+                it->rec = nullptr;
+            }
+            num_records = 0;
+            used        = 0;
+        }
+
+        size_t size() const
+        {
+            return num_records;
+        }
+        iterator begin()
+        {
+            return iterator(slots.data(), slots.data() + slots.size());
+        }
+        iterator end()
+        {
+            return iterator(slots.data() + slots.size(), slots.data() + slots.size());
+        }
+
+    private:
+        static size_t hash_id(string_id_t id)
+        {
+            return static_cast<size_t>(id * 0x9E3779B1U);        // odd multiplier spreads sequential ids
+        }
+        void rehash()
+        {
+            size_t new_size = 256;
+            while (new_size * 3 < (num_records + 1) * 8)
+                new_size *= 2;
+            std::vector<slot_t> old(new_size, slot_t{EMPTY, nullptr});
+            old.swap(slots);
+            size_t mask = slots.size() - 1;
+            for (auto it = old.begin(); it != old.end(); ++it)
+            {
+                if (it->rec == nullptr)
+                    continue;
+                size_t i = hash_id(it->id) & mask;
+                while (slots[i].id != EMPTY)
+                    i = (i + 1) & mask;
+                slots[i] = *it;
+            }
+            used = num_records;
+        }
+    };
+
+    // view of the tokens of one source line
+    struct token_line_t
+    {
+        const token_t * first;
+        const token_t * last;
+
+        token_line_t(const token_t * f, const token_t * l) noexcept
+                : first(f)
+                , last(l)
+        {
+        }
+
+        const token_t * begin() const
+        {
+            return first;
+        }
+        const token_t * end() const
+        {
+            return last;
+        }
+        size_t size() const
+        {
+            return static_cast<size_t>(last - first);
+        }
+        const token_t & operator[](size_t i) const
+        {
+            return first[i];
+        }
+    };
+
+    struct line_t
+    {
+        token_t  text;               // unmolested original line (with no newline)
+        uint32_t first_token;        // index of first token in source_t tokens
+        uint32_t num_tokens;         // number of tokens in line
+    };
+
     struct source_t
     {
-        std::string                           name;
-        std::vector<std::string>              orig_line;        // unmolested original line (with no newline)
-        std::vector<std::vector<std::string>> src_line;         // broken up into vector of tokens per line
-        uint64_t                              file_size;
-        uint32_t                              line_start;
+        std::string           name;
+        std::vector<line_t>   lines;                      // source lines
+        std::vector<token_t>  tokens;                     // lines broken up into tokens (views into text)
+        std::vector<uint32_t> missing_quote_lines;        // lines with a missing ending quote added (for warnings)
+        text_arena_t          text;                       // line and token text for this source
+        uint64_t              file_size;
+        uint32_t              line_start;
 
         source_t() noexcept
                 : file_size(0)
                 , line_start(1)
         {
         }
+        token_line_t line_tokens(uint32_t l) const
+        {
+            const token_t * first = tokens.data() + lines[l].first_token;
+            return token_line_t(first, first + lines[l].num_tokens);
+        }
+        void    add_line(const token_t & line_text, const token_line_t & toks);
         int32_t read_file(xlasm *, const std::string & n, const std::string & fn);
+        void    read_text(xlasm *, const std::string & n, const char * data, size_t size);
+    };
+    typedef std::unordered_map<std::string, source_t>   source_map_t;
+    typedef std::unordered_map<std::string, source_t *> source_ptr_map_t;
+
+    // INCLUDE files shared by assemblies running concurrently (copasm batch mode), each file is read and tokenized
+    // once by the first assembly including it and is read-only after that
+    struct include_cache_t
+    {
+        struct entry_t
+        {
+            std::mutex mutex;
+            bool       loaded;
+            int32_t    error;        // errno from reading file (or 0)
+            source_t   source;
+
+            entry_t() noexcept
+                    : loaded(false)
+                    , error(0)
+            {
+            }
+        };
+
+        std::mutex                                                mutex;
+        std::unordered_map<std::string, std::unique_ptr<entry_t>> files;        // by INCLUDE name and file path
+
+        int32_t read_file(const std::string & n, const std::string & fn, source_t *& f);
     };
-    typedef std::unordered_map<std::string, source_t> source_map_t;
 
     struct symbol_t;
 
@@ -146,7 +639,7 @@ struct xlasm
         {
         }
     };
-    typedef std::unordered_map<std::string, section_t> section_map_t;
+    typedef intern_map_t<section_t> section_map_t;
 
     struct symbol_t
     {
@@ -162,6 +655,12 @@ struct xlasm
             NUM_SYM_TYPES
         };
 
+        enum special_t        // value of INTERNAL symbols
+        {
+            SPECIAL_PC,           // "." current address
+            SPECIAL_RAND16        // ".rand16" random 16-bit value
+        };
+
 
         sym_t       type;
         uint32_t    line_defined;
@@ -198,8 +697,52 @@ struct xlasm
             return symbol_t_abbrev[static_cast<size_t>(type)];
         }
     };
-    typedef std::unordered_map<std::string, symbol_t> symbol_map_t;
-    typedef std::vector<std::string>                  export_list_t;
+    typedef intern_map_t<symbol_t>   symbol_map_t;
+    typedef std::vector<std::string> export_list_t;
+
+    // expression compiled into postfix code by its first error free evaluation, so later evaluations (e.g., on the
+    // next pass) only look up symbol values again instead of re-parsing the text (see expression::evaluate)
+    struct expr_code_t
+    {
+        enum insn_type
+        {
+            PUSH_NUM,        // push value
+            PUSH_SYM,        // push value of symbol slots[arg]
+            EVAL_OP,         // evaluate operator expression::ops[arg]
+            CHECK            // if an operator failed, stop with brace balance arg at text offset value
+        };
+
+        struct insn_t
+        {
+            insn_type type;
+            int32_t   arg;
+            int64_t   value;
+        };
+
+        struct slot_t
+        {
+            string_id_t id;                    // interned symbol name
+            symbol_t *  sym;
+            uint32_t    generation;        // symbol_generation when sym was looked up
+            uint32_t    offset;            // offset of symbol in expression text
+        };
+
+        std::vector<insn_t> code;
+        std::vector<slot_t> slots;
+        size_t              last_offset;
+        bool                dollar_hex;
+        bool                valid;
+        bool                recording;
+
+        expr_code_t() noexcept
+                : last_offset(0)
+                , dollar_hex(false)
+                , valid(false)
+                , recording(false)
+        {
+        }
+    };
+    typedef std::unordered_map<std::string, expr_code_t> expr_cache_t;
 
     struct condition_t
     {
@@ -228,7 +771,7 @@ struct xlasm
         {
         }
     };
-    typedef std::unordered_map<std::string, macro_t> macro_map_t;
+    typedef intern_map_t<macro_t> macro_map_t;
 
     struct context_t
     {
@@ -269,7 +812,8 @@ struct xlasm
         MAXMACRO_STACK       = 1024,          // nested macro depth
         MAXMACROREPS_WARNING = 255,           // max parameters replacement iterations per line
         MAXFILL_BYTES        = 0xC00L,        // max size output by space or fill directive (safety check)
-        MAX_PASSES           = 10             // maximum number of assembler passes before optimization short-circuited
+        MAX_PASSES           = 10,            // maximum number of assembler passes before optimization short-circuited
+        FATAL_EXIT_CODE      = 10             // assemble return (and copasm exit) code after a fatal error
     };
 
     enum directive_index
@@ -346,11 +890,15 @@ struct xlasm
     opts_t                 opt;                    // assembly options
     context_t              ctxt;                   // current assembly context
     context_stack_t        context_stack;          // context stack for include files and macros
+    string_pool_t          names;                  // interned section, macro and symbol names
     section_map_t          sections;               // output sections
     source_map_t           source_files;           // map of source files (tokenized at read time)
+    source_ptr_map_t       shared_files;           // INCLUDE files used from include_cache (by INCLUDE name)
+    include_cache_t *      include_cache;          // shared INCLUDE files (optional, set before assemble)
     macro_map_t            macros;                 // defined macros
     source_map_t           expanded_macros;        // source fragments from expanded macros
     symbol_map_t           symbols;                // labels and other symbols
+    expr_cache_t           expr_cache;             // compiled expressions (by expression text)
     export_list_t          exports;
     condition_stack_t      condition_stack;         // stack for conditional assembly
     directive_map_t        directives;              // fast lookup of directives
@@ -360,6 +908,7 @@ struct xlasm
     std::string            listing_filename;        // listing filename
     std::list<std::string> pre_messages;
     std::list<std::string> post_messages;
+    std::vector<diag_t>    diagnostics;             // errors, warnings and notices reported (in order)
     std::mt19937_64        rng;
 
     int64_t     total_size_generated;
@@ -367,7 +916,8 @@ struct xlasm
     int64_t     bytes_optimized;
     int64_t     undefined_sym_count;
     int64_t     line_sec_addr;
-    FILE *      listing_file;
+    output_t    msg_out;           // console messages (stdout unless assembling in memory)
+    output_t    listing_file;      // listing output (when enabled)
     source_t *  last_diag_file;
     section_t * undefined_section;
     symbol_t *  sym_defined;
@@ -388,6 +938,7 @@ struct xlasm
     uint32_t    prev_virtual_line_num;
     uint32_t    pass_count;
     uint32_t    last_diag_line;
+    uint32_t    symbol_generation;        // incremented when symbols are erased (invalidates expr_code_t slots)
 
     bool line_sec_org;
     bool suppress_line_list;
@@ -400,8 +951,9 @@ struct xlasm
     // initialize all non-constructed members architecture
     xlasm(const std::string & architecture);
 
-    // external interface, gathers input and options
+    // external interface, gathers input and options (returns EXIT_SUCCESS, EXIT_FAILURE or FATAL_EXIT_CODE)
     int32_t assemble(const std::vector<std::string> & in_files, const std::string & out_file, const opts_t & opts);
+    int32_t do_assemble(const std::vector<std::string> & in_files, const std::string & out_file, const opts_t & opts);
 
     // internal functions
     int32_t do_passes();        // read input files into memory, iterate over files for all assembler passes
@@ -411,35 +963,35 @@ struct xlasm
     int32_t process_xref();
     int32_t process_output();
     int32_t process_labeldef(std::string label);        // define a "normal" label (i.e., set to current output address)
-    int32_t process_directive(uint32_t                         idx,
-                              const std::string &              directive,
-                              const std::string &              label,
-                              size_t                           cur_token,
-                              const std::vector<std::string> & tokens);
+    int32_t process_directive(uint32_t             idx,
+                              const std::string &  directive,
+                              const std::string &  label,
+                              size_t               cur_token,
+                              const token_line_t & tokens);
 
-    int32_t process_section(const std::string &              directive,
-                            const std::string &              label,
-                            size_t                           cur_token,
-                            const std::vector<std::string> & tokens);
+    int32_t process_section(const std::string &  directive,
+                            const std::string &  label,
+                            size_t               cur_token,
+                            const token_line_t & tokens);
 
     // helper functions
     int32_t     pass_reset();
     int32_t     check_undefined();
-    bool        define_macro_begin(const std::string &              directive,
-                                   const std::string &              label,
-                                   size_t                           cur_token,
-                                   const std::vector<std::string> & tokens);
-    bool        define_macro_end(const std::string &              directive,
-                                 const std::string &              label,
-                                 size_t                           cur_token,
-                                 const std::vector<std::string> & tokens);
-    source_t &  expand_macro(std::string & name, size_t cur_token, const std::vector<std::string> & tokens);
-    int64_t     eval_tokens(const std::string &              cmd,
-                            std::string &                    exprstr,
-                            size_t &                         cur_token,
-                            const std::vector<std::string> & tokens,
-                            int32_t                          expected_args,
-                            int64_t                          defval);
+    bool        define_macro_begin(const std::string &  directive,
+                                   const std::string &  label,
+                                   size_t               cur_token,
+                                   const token_line_t & tokens);
+    bool        define_macro_end(const std::string &  directive,
+                                 const std::string &  label,
+                                 size_t               cur_token,
+                                 const token_line_t & tokens);
+    source_t &  expand_macro(std::string & name, size_t cur_token, const token_line_t & tokens);
+    int64_t     eval_tokens(const std::string &  cmd,
+                            std::string &        exprstr,
+                            size_t &             cur_token,
+                            const token_line_t & tokens,
+                            int32_t              expected_args,
+                            int64_t              defval);
     bool        check_truncation(const std::string & cmd, int64_t v, uint32_t b, int32_t errwarnflag = 1);
     bool        check_truncation_signed(const std::string & cmd, int64_t v, uint32_t b, int32_t errwarnflag = 1);
     bool        check_truncation_unsigned(const std::string & cmd, int64_t v, uint32_t b, int32_t errwarnflag = 1);
@@ -450,7 +1002,7 @@ struct xlasm
     std::string reQuote(const std::string & str);
     std::string quotedToRaw(const std::string cmd, const std::string & str, bool null_terminate);
     int32_t     align_output(size_t pot);
-    int64_t     lookup_special_symbol(const std::string & sym_name);
+    int64_t     lookup_special_symbol(const symbol_t & sym);
     int32_t     lookup_register_symbol(const std::string & sym_name);
     void        add_sym(const char * name, symbol_t::sym_t type, int64_t value);
     void        remove_sym(const char * name);
@@ -459,12 +1011,19 @@ struct xlasm
     void        update_crc16(uint8_t x);
     void        update_crc32(uint8_t x);
 
+    void        add_diag(diag_t::level_t level, const char * msg, va_list va) ATTRIBUTE((format(printf, 3, 0)));
+    void        add_source_text(const std::string & name, const char * text, size_t size);
+    int32_t     read_include(const std::string & basename, std::string & filename, source_t *& f);
+    void        warn_missing_quote(source_t * f, uint32_t line);
+
+    [[noreturn]] void fatal_error(const char * msg, ...) ATTRIBUTE((noreturn)) ATTRIBUTE((format(printf, 2, 3)));
     void        error(const char * msg, ...) ATTRIBUTE((format(printf, 2, 3)));
     void        warning(const char * msg, ...) ATTRIBUTE((format(printf, 2, 3)));
     void        notice(int32_t level, const char * msg, ...) ATTRIBUTE((format(printf, 3, 4)));
-    std::string token_message(size_t cur_token, const std::vector<std::string> & tokens);
+    std::string token_message(size_t cur_token, const token_line_t & tokens);
     bool        dollar_hex();
 
+    int64_t        resolved_symbol_value(symbol_t & sym, const token_t & sym_name, bool * undefined = nullptr);
     static int64_t symbol_value(xlasm *      xl,
                                 const char * name,
                                 bool *       allow_undefined = nullptr);        // expression evaluation symbol lookup
@@ -487,19 +1046,19 @@ struct Ixlarch
                      xlasm * xl) = 0;        // clear architecture symbols (when switching to another architecture)
     virtual uint32_t check_directive(
         const std::string & directive) = 0;        // return directive index or xlasm::DIR_UNKNOWN if not recognized
-    virtual int32_t process_directive(xlasm *                          xl,
-                                      uint32_t                         idx,
-                                      const std::string &              directive,
-                                      const std::string &              label,
-                                      size_t                           cur_token,
-                                      const std::vector<std::string> & tokens) = 0;
-    virtual int32_t lookup_register(const std::string & name)                  = 0;
+    virtual int32_t process_directive(xlasm *                     xl,
+                                      uint32_t                    idx,
+                                      const std::string &         directive,
+                                      const std::string &         label,
+                                      size_t                      cur_token,
+                                      const xlasm::token_line_t & tokens) = 0;
+    virtual int32_t lookup_register(const std::string & name)             = 0;
     virtual int32_t check_opcode(const std::string & opcode) = 0;        // return opcode index or -1 if not recognized
-    virtual int32_t process_opcode(xlasm *                          xl,
-                                   int32_t                          idx,
-                                   std::string &                    opcode,
-                                   size_t                           cur_token,
-                                   const std::vector<std::string> & tokens) = 0;
+    virtual int32_t process_opcode(xlasm *                     xl,
+                                   int32_t                     idx,
+                                   std::string &               opcode,
+                                   size_t                      cur_token,
+                                   const xlasm::token_line_t & tokens) = 0;
 
     virtual bool is_big_endian()
     {
@@ -115,12 +115,12 @@ uint32_t copper::check_directive(const std::string & directive)
     return index;
 }
 
-int32_t copper::process_directive(xlasm *                          xl,
-                                  uint32_t                         idx,
-                                  const std::string &              directive,
-                                  const std::string &              label,
-                                  size_t                           cur_token,
-                                  const std::vector<std::string> & tokens)
+int32_t copper::process_directive(xlasm *                     xl,
+                                  uint32_t                    idx,
+                                  const std::string &         directive,
+                                  const std::string &         label,
+                                  size_t                      cur_token,
+                                  const xlasm::token_line_t & tokens)
 {
     (void)xl;
     (void)idx;
@@ -154,11 +154,11 @@ int32_t copper::lookup_register(const std::string & n)
     return -1;
 }
 
-int32_t copper::process_opcode(xlasm *                          xl,
-                               int32_t                          idx,
-                               std::string &                    opcode,
-                               size_t                           cur_token,
-                               const std::vector<std::string> & tokens)
+int32_t copper::process_opcode(xlasm *                     xl,
+                               int32_t                     idx,
+                               std::string &               opcode,
+                               size_t                      cur_token,
+                               const xlasm::token_line_t & tokens)
 {
     // make keyword uppercase to stand out in error messages
     std::transform(opcode.begin(), opcode.end(), opcode.begin(), uppercase);
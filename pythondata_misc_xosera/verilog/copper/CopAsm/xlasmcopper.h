@@ -18,18 +18,18 @@ struct copper : public Ixlarch
     void              deactivate(xlasm * xl) override;
     int32_t           lookup_register(const std::string & opcode) override;
     int32_t           check_opcode(const std::string & opcode) override;
-    int32_t           process_opcode(xlasm *                          xl,
-                                     int32_t                          idx,
-                                     std::string &                    opcode,
-                                     size_t                           cur_token,
-                                     const std::vector<std::string> & tokens) override;
+    int32_t           process_opcode(xlasm *                     xl,
+                                     int32_t                     idx,
+                                     std::string &               opcode,
+                                     size_t                      cur_token,
+                                     const xlasm::token_line_t & tokens) override;
     uint32_t          check_directive(const std::string & directive) override;
-    int32_t           process_directive(xlasm *                          xl,
-                                        uint32_t                         idx,
-                                        const std::string &              directive,
-                                        const std::string &              label,
-                                        size_t                           cur_token,
-                                        const std::vector<std::string> & tokens) override;
+    int32_t           process_directive(xlasm *                     xl,
+                                        uint32_t                    idx,
+                                        const std::string &         directive,
+                                        const std::string &         label,
+                                        size_t                      cur_token,
+                                        const xlasm::token_line_t & tokens) override;
 
 
     bool support_dollar_hex() override
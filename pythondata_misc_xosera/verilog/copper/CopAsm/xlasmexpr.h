@@ -97,13 +97,15 @@ class expression
         int64_t (*eval)(expression * exp, int64_t a1, int64_t a2);
     };
 
-    xlasm *             xl;
-    const struct op_s * opstack[MAXOPSTACK];
-    int64_t             numstack[MAXNUMSTACK];
-    int32_t             nopstack;
-    int32_t             nnumstack;
-    int32_t             brace_balance;
-    int32_t             errorcode;
+    xlasm *              xl;
+    xlasm::expr_code_t * rec;              // expression code being recorded (or nullptr)
+    bool                 rec_check;        // recorded an operator that can fail since last CHECK
+    const struct op_s *  opstack[MAXOPSTACK];
+    int64_t              numstack[MAXNUMSTACK];
+    int32_t              nopstack;
+    int32_t              nnumstack;
+    int32_t              brace_balance;
+    int32_t              errorcode;
 
 public:
     void eval_error(int error, const char * fmt, ...) ATTRIBUTE((format(printf, 3, 4)))
@@ -454,10 +456,65 @@ private:
         return numstack[--nnumstack];
     }
 
+    // pop operator arguments and push result (recording operator when compiling expression)
+    void eval_op(const struct op_s * op)
+    {
+        int64_t n1, n2, n3;
+
+        if (op->unary == 1)
+        {
+            n1 = pop_numstack();
+            push_numstack(op->eval(this, n1, 0));
+        }
+        else if (op->unary == 2)
+        {
+            n1 = pop_numstack();
+            n2 = pop_numstack();
+            push_numstack(op->eval(this, n2, n1));
+        }
+        else if (op->unary == 3)
+        {
+            assert(op->op == OP_TERNARY);
+            n1 = pop_numstack();
+            n2 = pop_numstack();
+            n3 = pop_numstack();
+            push_numstack(eval_cond(this, n3, n2, n1));        // special case for ?: ternary op
+        }
+        else
+        {
+            return;
+        }
+
+        if (rec)
+        {
+            record(xlasm::expr_code_t::EVAL_OP, static_cast<int32_t>(op - ops), 0);
+            if (op->eval == eval_div || op->eval == eval_mod)
+                rec_check = true;
+        }
+    }
+
+    void record(xlasm::expr_code_t::insn_type type, int32_t arg, int64_t value)
+    {
+        xlasm::expr_code_t::insn_t insn;
+        insn.type  = type;
+        insn.arg   = arg;
+        insn.value = value;
+        rec->code.push_back(insn);
+    }
+
+    // record stop point for an operator error (evaluation stops after operators evaluated by one parsing step)
+    void record_check(size_t offset)
+    {
+        if (rec && rec_check)
+        {
+            record(xlasm::expr_code_t::CHECK, brace_balance, static_cast<int64_t>(offset));
+            rec_check = false;
+        }
+    }
+
     void shunt_op(const struct op_s * op)
     {
         const struct op_s * pop;
-        int64_t             n1, n2, n3;
 
         exp_dprintf("operator %s\n", op->op_str);
 
@@ -476,24 +533,7 @@ private:
                 if (!pop)
                     return;
 
-                if (pop->unary == 1)
-                {
-                    n1 = pop_numstack();
-                    push_numstack(pop->eval(this, n1, 0));
-                }
-                else if (pop->unary == 2)
-                {
-                    n1 = pop_numstack();
-                    n2 = pop_numstack();
-                    push_numstack(pop->eval(this, n2, n1));
-                }
-                else if (pop->unary == 3)
-                {
-                    n1 = pop_numstack();
-                    n2 = pop_numstack();
-                    n3 = pop_numstack();
-                    push_numstack(eval_cond(this, n3, n2, n1));
-                }
+                eval_op(pop);
             }
 
             pop = pop_opstack();
@@ -512,24 +552,7 @@ private:
                 if (!pop)
                     return;
 
-                if (pop->unary == 1)
-                {
-                    n1 = pop_numstack();
-                    push_numstack(pop->eval(this, n1, 0));
-                }
-                else if (pop->unary == 2)
-                {
-                    n1 = pop_numstack();
-                    n2 = pop_numstack();
-                    push_numstack(pop->eval(this, n2, n1));
-                }
-                else if (pop->unary == 3)
-                {
-                    n1 = pop_numstack();
-                    n2 = pop_numstack();
-                    n3 = pop_numstack();
-                    push_numstack(eval_cond(this, n3, n2, n1));
-                }
+                eval_op(pop);
             }
         }
         else if (op->assoc == ASSOC_LEFT)
@@ -540,43 +563,19 @@ private:
                 if (!pop)
                     return;
 
-                if (pop->unary == 1)
-                {
-                    n1 = pop_numstack();
-                    push_numstack(pop->eval(this, n1, 0));
-                }
-                else if (pop->unary == 2)
-                {
-                    n1 = pop_numstack();
-                    n2 = pop_numstack();
-                    push_numstack(pop->eval(this, n2, n1));
-                }
-                else if (pop->unary == 3)
-                {
-                    n1 = pop_numstack();
-                    n2 = pop_numstack();
-                    n3 = pop_numstack();
-                    push_numstack(eval_cond(this, n3, n2, n1));
-                }
+                eval_op(pop);
             }
         }
 
         push_opstack(op);
     }
 
-public:
-    bool evaluate(xlasm *     xl_,
-                  std::string expression,
-                  int64_t *   result,
-                  size_t *    last_offset     = nullptr,
-                  bool        allow_undefined = true)
+    bool parse(const std::string & expression, int64_t * result, size_t * last_offset, bool allow_undefined)
     {
         struct op_s         startop = {"X", 1, OP_DUMMY, 0, ASSOC_NONE, 0, nullptr}; /* Dummy operator to mark TOS */
         const struct op_s * op      = nullptr;
-        int64_t             n1, n2, n3;
-        const struct op_s * lastop = &startop;
+        const struct op_s * lastop  = &startop;
 
-        xl            = xl_;
         errorcode     = 0;
         brace_balance = 0;
         nopstack      = 0;
@@ -630,6 +629,7 @@ public:
                     assert(op->op == OP_LPAREN);
                     shunt_op(op);
                 }
+                record_check(static_cast<size_t>(expr - expression.c_str()) + 1);
 
                 lastop = op;
 
@@ -678,6 +678,8 @@ public:
 
                 push_numstack(v);
                 lastop = nullptr;
+                if (rec)
+                    record(xlasm::expr_code_t::PUSH_NUM, 0, v);
 
                 // for loop will still increment, so back off one
                 if (oexpr != expr)
@@ -707,8 +709,11 @@ public:
                 }
                 strncpy(symname, expr, symlen);
 
-                bool    undefined = false;
-                int64_t v         = xl->symbol_value(xl, symname, &undefined);
+                bool                 undefined = false;
+                xlasm::string_id_t   sym_id    = xl->names.intern(symname, strlen(symname));
+                xlasm::symbol_t &    sym       = xl->symbols.get(sym_id);
+                const xlasm::token_t sym_name  = xl->names.str(sym_id);
+                int64_t              v         = xl->resolved_symbol_value(sym, sym_name, &undefined);
                 exp_dprintf("parsed sym '%s' v = 0x%llx\n", symname, v);
 
                 if (!allow_undefined && undefined)
@@ -719,6 +724,16 @@ public:
 
                 push_numstack(v);
                 lastop = nullptr;
+                if (rec)
+                {
+                    xlasm::expr_code_t::slot_t slot;
+                    slot.id         = sym_id;
+                    slot.sym        = &sym;
+                    slot.generation = xl->symbol_generation;
+                    slot.offset     = static_cast<uint32_t>(expr - expression.c_str());
+                    rec->slots.push_back(slot);
+                    record(xlasm::expr_code_t::PUSH_SYM, static_cast<int32_t>(rec->slots.size() - 1), 0);
+                }
 
                 expr += symlen - 1;
                 continue;
@@ -743,25 +758,8 @@ public:
             if (!op)
                 break;
 
-            if (op->unary == 1)
-            {
-                n1 = pop_numstack();
-                push_numstack(op->eval(this, n1, 0));
-            }
-            else if (op->unary == 2)
-            {
-                n1 = pop_numstack();
-                n2 = pop_numstack();
-                push_numstack(op->eval(this, n2, n1));
-            }
-            else if (op->unary == 3)
-            {
-                assert(op->op == OP_TERNARY);
-                n1 = pop_numstack();
-                n2 = pop_numstack();
-                n3 = pop_numstack();
-                push_numstack(eval_cond(this, n3, n2, n1));        // special case for ?: ternary op
-            }
+            eval_op(op);
+            record_check(static_cast<size_t>(expr - expression.c_str()));
         }
         if (!errorcode && nnumstack != 1)
         {
@@ -771,8 +769,120 @@ public:
 
         if (last_offset != nullptr)
             *last_offset = static_cast<size_t>((expr - expression.c_str()));
+        if (rec)
+            rec->last_offset = static_cast<size_t>((expr - expression.c_str()));
+        *result = numstack[0];
+
+        return errorcode ? false : true;
+    }
+
+    // evaluate recorded expression code, results and diagnostics are the same as parsing expression text again
+    bool run(const std::string &  expression,
+             xlasm::expr_code_t & code,
+             int64_t *            result,
+             size_t *             last_offset,
+             bool                 allow_undefined)
+    {
+        errorcode = 0;
+        nnumstack = 0;
+        *result   = 0;        // default
+
+        for (auto it = code.code.begin(); it != code.code.end(); ++it)
+        {
+            switch (it->type)
+            {
+                case xlasm::expr_code_t::PUSH_NUM:
+                    push_numstack(it->value);
+                    break;
+
+                case xlasm::expr_code_t::PUSH_SYM: {
+                    xlasm::expr_code_t::slot_t & slot = code.slots[static_cast<size_t>(it->arg)];
+
+                    // look up symbol again if any symbol was erased since
+                    if (slot.generation != xl->symbol_generation)
+                    {
+                        slot.sym        = &xl->symbols.get(slot.id);
+                        slot.generation = xl->symbol_generation;
+                    }
+
+                    bool    undefined = false;
+                    int64_t v         = xl->resolved_symbol_value(*slot.sym, xl->names.str(slot.id), &undefined);
+
+                    if (!allow_undefined && undefined)
+                    {
+                        eval_error(0x10C, "Use of undefined symbol: %.32s", expression.c_str() + slot.offset);
+                        return false;
+                    }
+
+                    push_numstack(v);
+                }
+                break;
+
+                case xlasm::expr_code_t::EVAL_OP:
+                    eval_op(&ops[it->arg]);
+                    break;
+
+                case xlasm::expr_code_t::CHECK:
+                    if (errorcode)
+                    {
+                        if (it->arg > 0)
+                        {
+                            eval_error(0x10C, "Open parenthesis '(' with no closing ')'");
+                            return false;
+                        }
+
+                        if (last_offset != nullptr)
+                            *last_offset = static_cast<size_t>(it->value);
+                        *result = numstack[0];
+
+                        return false;
+                    }
+                    break;
+            }
+        }
+
+        if (last_offset != nullptr)
+            *last_offset = code.last_offset;
         *result = numstack[0];
 
         return errorcode ? false : true;
     }
+
+public:
+    // evaluate expression, using code compiled by a previous error free evaluation of the same text when possible
+    bool evaluate(xlasm *     xl_,
+                  std::string expression,
+                  int64_t *   result,
+                  size_t *    last_offset     = nullptr,
+                  bool        allow_undefined = true)
+    {
+        xl        = xl_;
+        rec       = nullptr;
+        rec_check = false;
+
+        // literal parsing depends on architecture (dollar_hex), so no code is cached until one is set
+        if (xl->arch == nullptr)
+            return parse(expression, result, last_offset, allow_undefined);
+
+        xlasm::expr_code_t & code = xl->expr_cache[expression];
+        if (code.valid && code.dollar_hex == xl->dollar_hex())
+            return run(expression, code, result, last_offset, allow_undefined);
+
+        if (code.recording)        // recursive evaluation of same text (via STRING symbol)
+            return parse(expression, result, last_offset, allow_undefined);
+
+        code.code.clear();
+        code.slots.clear();
+        code.dollar_hex = xl->dollar_hex();
+        code.recording  = true;
+        rec             = &code;
+
+        bool ok = parse(expression, result, last_offset, allow_undefined);
+
+        rec            = nullptr;
+        code.recording = false;
+        code.valid     = ok;
+
+        return ok;
+    }
 };
@@ -8,7 +8,10 @@
 #if !defined(HOST_SPI_H)
 #define HOST_SPI_H
 
+#if !defined(SIM_SPI)        // SPI_TRANSPORT=sim uses sim_spi.cpp (Xosera Verilator simulation)
 #include <ftdi.h>
+#endif
+#include <stddef.h>
 #include <stdint.h>
 
 // Thanks to https://github.com/YosysHQ/icestorm/tree/master/iceprog
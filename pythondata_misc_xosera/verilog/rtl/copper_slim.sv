@@ -174,6 +174,7 @@ assign          ram_read_data       = copmem_rd_data_i;
 /* verilator lint_off UNUSEDSIGNAL */
 logic           op_valid;
 word_t          opcode;
+copp_addr_t     op_addr;            // copper address of opcode (for simulation profiling)
 word_t          op_imm;
 word_t          op_src;
 word_t          op_dest;
@@ -298,6 +299,7 @@ always_ff @(posedge clk) begin
 `ifndef SYNTHESIS
                     op_valid        <= 1'b1;
                     opcode          <= ram_read_data;
+                    op_addr         <= cop_PC - 1'b1;                       // PC was incremented when read
                     op_imm          <= 'X;
                     op_src          <= 'X;
                     op_dest         <= 'X;
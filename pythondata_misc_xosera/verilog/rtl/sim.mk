@@ -71,6 +71,9 @@ endif
 
 VERILOG_DEFS := -D$(VIDEO_MODE)
 
+# extra Verilator sim options (e.g., VRUN_ARGS="-script mytest.txt" to replace compiled in bus test_data)
+VRUN_ARGS ?=
+
 # monochrome + color attribute byte
 #VRUN_TESTDATA ?= -u ../testdata/raw/space_shuttle_color_640x480.raw
 
@@ -140,6 +143,7 @@ LOGS	:= sim/logs
 YOSYS_CONFIG := yosys-config
 TECH_LIB := $(shell $(YOSYS_CONFIG) --datdir/ice40/cells_sim.v)
 VLT_CONFIG := sim/ice40_config.vlt
+VLT_PROFILE := sim/xosera_profile.vlt
 
 # Icarus Verilog
 IVERILOG := iverilog
@@ -147,33 +151,83 @@ VVP := vvp
 IVERILOG_ARGS := -g2012 -I$(SRCDIR) -Wall -l $(TECH_LIB)
 
 # Verilator C++ definitions and options
-SDL_RENDER := 1
+# SDL_RENDER=0 builds "headless" without SDL (frames saved as PPM or raw RGB444, see -f option)
+SDL_RENDER ?= 1
 ifeq ($(strip $(SDL_RENDER)),1)
 LDFLAGS := -LDFLAGS "$(shell sdl2-config --libs) -lSDL2_image"
 SDL_CFLAGS := $(shell sdl2-config --cflags)
 endif
-# Note: Using -Os seems to provide the fastest compile+run simulation iteration time
+# Verilator model threads (1 = single-threaded, see vsim_mt target)
+VTHREADS ?= 1
+ifneq ($(strip $(VTHREADS)),1)
+VTHREADS_ARGS := --threads $(VTHREADS)
+endif
+# Verilator optimization level
+VOPT ?= -O3
+# C++ optimization for Verilator model (empty uses Verilator default of -Os, e.g. VOPT_FAST=-O3, "make vbench" O3
+# flavor measures the difference)
+VOPT_FAST ?=
+ifneq ($(strip $(VOPT_FAST)),)
+VMAKE_ARGS := OPT_FAST="$(VOPT_FAST)"
+endif
+# set TRACE=0 to build without FST waveform tracing
+TRACE ?= 1
+ifeq ($(strip $(TRACE)),1)
+VTRACE_ARGS := --trace
+endif
+# set SAVABLE=1 to build with Verilator --savable (enables -save/-restore simulation snapshots)
+SAVABLE ?= 0
+ifeq ($(strip $(SAVABLE)),1)
+VSAVABLE_ARGS := --savable
+endif
+# set PROFILE=1 to make internal RTL signals sampled by profiling options public (-trace vram:, -vprof, -cprof,
+# -blitbench, -wav_taps, -latency, -backdoor XR memory), listed in $(VLT_PROFILE) so other builds are optimized the same as without the options
+PROFILE ?= 0
+ifeq ($(strip $(PROFILE)),1)
+VPROFILE_VLT := $(VLT_PROFILE)
+VPROFILE_ARGS := $(VLT_PROFILE) -DSIM_PROFILE
+endif
+# set SPI=1 to simulate sim/xosera_spi_sim.sv (spi_target.sv and the iCEBreaker SPI_INTERFACE command bridge around
+# xosera_main) for -spi co-simulation, built as V$(VTOP) with the same bus ports
+SPI ?= 0
+VSIM_TOP := $(VTOP)
+ifeq ($(strip $(SPI)),1)
+VSIM_TOP := xosera_spi_sim
+VSPI_SRC := sim/$(VSIM_TOP).sv
+# spi_target.sv is only built for ICEBREAKER
+DEFINES += -DICEBREAKER -DSPI_INTERFACE
+endif
 # Linux gcc needs -Wno-maybe-uninitialized
-CFLAGS		:= -CFLAGS "-std=c++14 -Wall -Wextra -Werror -fomit-frame-pointer -Wno-deprecated-declarations -Wno-unused-but-set-variable -Wno-sign-compare -Wno-unused-parameter -Wno-unused-variable -Wno-bool-operation -Wno-int-in-bool-context -D$(VIDEO_MODE) -DSDL_RENDER=$(SDL_RENDER) -DBUS_INTERFACE=$(BUS_INTERFACE) $(SDL_CFLAGS)"
+CFLAGS		:= -CFLAGS "-std=c++14 -Wall -Wextra -Werror -fomit-frame-pointer -Wno-deprecated-declarations -Wno-unused-but-set-variable -Wno-sign-compare -Wno-unused-parameter -Wno-unused-variable -Wno-bool-operation -Wno-int-in-bool-context -D$(VIDEO_MODE) -DSDL_RENDER=$(SDL_RENDER) -DBUS_INTERFACE=$(BUS_INTERFACE) -DSIM_THREADS=$(VTHREADS) -DSIM_SAVABLE=$(SAVABLE) -DSIM_PROFILE=$(PROFILE) -DSIM_SPI=$(SPI) -DSIM_AUDIO=$(AUDIO) -DSIM_PF_B=$(if $(strip $(PF_B)),1,0) $(SDL_CFLAGS)"
+
+# Verilator output directory (separate directory for each build flavor)
+VOBJDIR ?= sim/obj_dir
 
 # Verilator tool (used for lint and simulation)
 VERILATOR := verilator
-VERILATOR_ARGS := --sv --language 1800-2012 --timing -I$(SRCDIR) -v $(TECH_LIB) $(VLT_CONFIG) -Mdir sim/obj_dir -Wall --trace-fst -Wno-DECLFILENAME -Wno-PINCONNECTEMPTY -Wno-STMTDLY -Wno-fatal
+VERILATOR_ARGS := --sv --language 1800-2012 --timing -I$(SRCDIR) -v $(TECH_LIB) $(VLT_CONFIG) -Mdir $(VOBJDIR) -Wall --trace-fst -Wno-DECLFILENAME -Wno-PINCONNECTEMPTY -Wno-STMTDLY -Wno-fatal
 
 # Verillator C++ source driver
 CSRC := sim/xosera_sim.cpp
 
-# copper asm source
-COPSRC := $(addsuffix .vsim.h,$(basename $(wildcard sim/*.casm)))
+# binary event log decoder (for sim -evlog option)
+EVLOG := sim/xosera_evlog
+
+# memory snapshot compare (for sim -memsnap option)
+MEMDIFF := sim/xosera_memdiff
+
+# bus script predefined names (for sim -script option)
+SCRIPT_SYMS := sim/xosera_m68k_defs_syms.h
+
+# copper asm source, assembled into each build's $(VOBJDIR)/sim (output depends on VIDEO_MODE COPASMOPT)
+COPSRC := $(addprefix $(VOBJDIR)/,$(addsuffix .vsim.h,$(basename $(wildcard sim/*.casm))))
 
 # default build native simulation executable
 all: $(RESET_COPMEM) $(COPASM) vsim isim
 .PHONY: all
 
-$(COPSRC): $(COPASM)
-
 # build native simulation executable
-vsim: $(COPASM) $(RESET_COPMEM) $(VLT_CONFIG) sim/obj_dir/V$(VTOP) sim.mk
+vsim: $(COPASM) $(RESET_COPMEM) $(VLT_CONFIG) $(VOBJDIR)/V$(VTOP) $(EVLOG) $(MEMDIFF) sim.mk
 	@echo === Verilator simulation configured for: $(VIDEO_MODE) ===
 	@echo Completed building Verilator simulation, use \"make vrun\" to run.
 .PHONY: vsim
@@ -185,12 +239,185 @@ isim: $(COPASM) $(RESET_COPMEM) $(VLT_CONFIG) sim/$(TBTOP) sim.mk
 .PHONY: isim
 
 # run Verilator to build and run native simulation executable
-vrun: $(RESET_COPMEM) $(VLT_CONFIG) sim/obj_dir/V$(VTOP) sim.mk
+vrun: $(RESET_COPMEM) $(VLT_CONFIG) $(VOBJDIR)/V$(VTOP) sim.mk
 	@mkdir -p $(LOGS)
-	sim/obj_dir/V$(VTOP) $(VRUN_TESTDATA)
+	$(VOBJDIR)/V$(VTOP) $(VRUN_ARGS) $(VRUN_TESTDATA)
 .PHONY: vrun
 
 
+# build headless native simulation executable (no SDL)
+vsim_headless:
+	$(MAKE) -f sim.mk SDL_RENDER=0 VOBJDIR=sim/obj_dir_headless vsim
+.PHONY: vsim_headless
+
+# build and run headless native simulation executable (no SDL)
+vrun_headless:
+	$(MAKE) -f sim.mk SDL_RENDER=0 VOBJDIR=sim/obj_dir_headless vrun
+.PHONY: vrun_headless
+
+# build profiling native simulation executable (internal RTL signals public for profiling options)
+vsim_profile:
+	$(MAKE) -f sim.mk PROFILE=1 VOBJDIR=sim/obj_dir_profile vsim
+.PHONY: vsim_profile
+
+# build and run profiling native simulation executable
+vrun_profile:
+	$(MAKE) -f sim.mk PROFILE=1 VOBJDIR=sim/obj_dir_profile vrun
+.PHONY: vrun_profile
+
+# build SPI target native simulation executable (for -spi co-simulation)
+vsim_spi:
+	$(MAKE) -f sim.mk SPI=1 VOBJDIR=sim/obj_dir_spi vsim
+.PHONY: vsim_spi
+
+# build and run SPI target native simulation executable
+vrun_spi:
+	$(MAKE) -f sim.mk SPI=1 VOBJDIR=sim/obj_dir_spi vrun
+.PHONY: vrun_spi
+
+# build multi-threaded native simulation executable
+MT_THREADS ?= 4
+vsim_mt:
+	$(MAKE) -f sim.mk VTHREADS=$(MT_THREADS) VOBJDIR=sim/obj_dir_mt vsim
+.PHONY: vsim_mt
+
+# build and run multi-threaded native simulation executable
+vrun_mt:
+	$(MAKE) -f sim.mk VTHREADS=$(MT_THREADS) VOBJDIR=sim/obj_dir_mt vrun
+.PHONY: vrun_mt
+
+# build and run simulation flavors (headless, no images) to compare "Simulation throughput" results
+VBENCH_FLAVORS ?= base notrace O3 mt
+vbench:
+	@mkdir -p $(LOGS)
+	for flavor in $(VBENCH_FLAVORS); do
+		case $$flavor in
+			base)		opts="" ;;
+			notrace)	opts="TRACE=0" ;;
+			O3)		opts="TRACE=0 VOPT_FAST=-O3" ;;
+			mt)		opts="TRACE=0 VTHREADS=$(MT_THREADS)" ;;
+			*)		echo "unknown vbench flavor $$flavor"; exit 1 ;;
+		esac
+		$(MAKE) -f sim.mk SDL_RENDER=0 VOBJDIR=sim/obj_dir_bench_$$flavor $$opts vsim >/dev/null
+		echo "=== vbench $$flavor: $$opts"
+		sim/obj_dir_bench_$$flavor/V$(VTOP) -f none $(VRUN_TESTDATA) | grep "^Simulation"
+	done
+.PHONY: vbench
+
+# build and run headless blitter benchmark sweep for each video mode (sim/logs/xosera_vsim_blitbench_<mode>.csv)
+VBLIT_MODES ?= MODE_640x480 MODE_848x480
+vblitbench:
+	@mkdir -p $(LOGS)
+	for mode in $(VBLIT_MODES); do
+		$(MAKE) -f sim.mk SDL_RENDER=0 TRACE=0 PROFILE=1 VIDEO_MODE=$$mode VOBJDIR=sim/obj_dir_blit_$$mode vsim >/dev/null
+		echo "=== vblitbench $$mode"
+		sim/obj_dir_blit_$$mode/V$(VTOP) -f none -blitbench | sed -n '/^Blitter words/,/^Blitter benchmark saved/p'
+	done
+.PHONY: vblitbench
+
+# build and run headless SPI target co-simulation with xvid_spi "-b" bitmap upload for each MAX_SEND:FLUSH_QUEUE
+VSPI_SWEEP ?= 16:12 64:60 256:252 1024:1020
+VSPI_COSIM ?= /xosera_vspibench
+# tenths of a second to wait for the simulation shared memory before starting xvid_spi
+VSPI_WAIT ?= 300
+vspibench:
+	@mkdir -p $(LOGS)
+	$(MAKE) -f sim.mk SDL_RENDER=0 TRACE=0 SPI=1 VOBJDIR=sim/obj_dir_spibench vsim >/dev/null
+	for sweep in $(VSPI_SWEEP); do
+		CCFLAGS="-DMAX_SEND=$${sweep%%:*} -DFLUSH_QUEUE=$${sweep##*:} -DDEBUG_HEXDUMP=0" \
+			$(MAKE) -B -C ../xvid_spi SPI_TRANSPORT=sim >/dev/null
+		echo "=== vspibench MAX_SEND:FLUSH_QUEUE $$sweep"
+		rm -f /dev/shm$(VSPI_COSIM)
+		sim/obj_dir_spibench/V$(VTOP) -f none -cosim $(VSPI_COSIM) -spi >$(LOGS)/xosera_vspibench.txt &
+		sim_pid=$$!
+		for i in $$(seq $(VSPI_WAIT)); do
+			[ -s /dev/shm$(VSPI_COSIM) ] && break
+			sleep 0.1
+		done
+		if ! [ -s /dev/shm$(VSPI_COSIM) ] || ! (cd ../xvid_spi && XOSERA_COSIM=$(VSPI_COSIM) ./xvid_spi -b >/dev/null); then
+			echo "vspibench: simulation not ready or xvid_spi failed"
+			kill $$sim_pid 2>/dev/null || true
+			wait $$sim_pid || true
+			exit 1
+		fi
+		wait $$sim_pid
+		grep "^SPI throughput" $(LOGS)/xosera_vspibench.txt
+	done
+.PHONY: vspibench
+
+# build headless simulation for each of VFARM_MODES with each of VFARM_FEATURES in parallel, then run each of
+# VFARM_SCRIPTS (REG_xxx() text or .bin, "default" uses compiled in bus test_data) on every model, up to MAX_CPUS
+# jobs at once.  Files shared by all models are made before the parallel builds, and each model assembles the copper
+# test programs for its mode in its own VOBJDIR.  Each job runs in its own sim/logs/farm/<mode>_<features>_<script>/rtl
+# directory (so logs and images are not shared).  A job passes when the simulation exits successfully (set VFARM_CHECK
+# to a golden frame directory to also -check frames, or VFARM_CHECK_OPT=-check_update to create them).  Results with
+# throughput are collected in sim/logs/farm/xosera_vsim_farm.txt.
+VFARM_MODES ?= MODE_640x480 MODE_848x480
+VFARM_FEATURES ?= full noaudio nopfb
+VFARM_SCRIPTS ?= default
+VFARM_TESTDATA ?= $(VRUN_TESTDATA)
+VFARM_CHECK ?=
+VFARM_CHECK_OPT ?= -check
+vfarm:
+	rm -rf $(LOGS)/farm
+	mkdir -p $(LOGS)/farm
+	farm_wait() { while (( $$(jobs -rp | wc -l) >= $(MAX_CPUS) )); do wait -n || true; done }
+	$(MAKE) -f sim.mk $(VLT_CONFIG) $(SCRIPT_SYMS) $(EVLOG) $(MEMDIFF) >/dev/null
+	for mode in $(VFARM_MODES); do
+		for feat in $(VFARM_FEATURES); do
+			case $$feat in
+				full)		opts="AUDIO=4 PF_B=true" ;;
+				noaudio)	opts="AUDIO=0 PF_B=true" ;;
+				nopfb)		opts="AUDIO=4 PF_B=" ;;
+				min)		opts="AUDIO=0 PF_B=" ;;
+				*)		echo "unknown vfarm feature set $$feat"; exit 1 ;;
+			esac
+			model=$${mode}_$$feat
+			mkdir -p $(LOGS)/farm/$$model
+			echo "=== vfarm build $$model: $$opts"
+			farm_wait
+			( $(MAKE) -f sim.mk SDL_RENDER=0 TRACE=0 VIDEO_MODE=$$mode $$opts VOBJDIR=sim/obj_dir_farm_$$model vsim \
+				>$(LOGS)/farm/$$model/build.log 2>&1 || echo "FAIL $$model(build) - - - -" >$(LOGS)/farm/$$model/result.txt ) &
+		done
+	done
+	wait
+	testdata=""
+	for arg in $(VFARM_TESTDATA); do
+		[[ -e $$arg ]] && arg=$$(realpath $$arg)
+		testdata+=" $$arg"
+	done
+	for mode in $(VFARM_MODES); do
+		for feat in $(VFARM_FEATURES); do
+			model=$${mode}_$$feat
+			[[ -e $(LOGS)/farm/$$model/result.txt ]] && continue
+			for script in $(VFARM_SCRIPTS); do
+				name=$$(basename $$script)
+				job=$${model}_$${name%.*}
+				run=$(LOGS)/farm/$$job/rtl
+				mkdir -p $$run/sim/logs
+				ln -s $(current_dir)/*.mem $(current_dir)/tilesets $$run/
+				ln -s $$(realpath ../testdata) $(LOGS)/farm/$$job/testdata
+				args="-f none"
+				[[ $$script == default ]] || args+=" -script $$(realpath $$script)"
+				[[ -z "$(VFARM_CHECK)" ]] || args+=" $(VFARM_CHECK_OPT) $(abspath $(VFARM_CHECK))/$$job"
+				echo "=== vfarm run $$job: $$args"
+				farm_wait
+				( cd $$run
+				  result=PASS
+				  $(current_dir)/sim/obj_dir_farm_$$model/V$(VTOP) $$args $$testdata >sim/logs/stdout.txt 2>&1 || result=FAIL
+				  tput=$$(sed -n 's/^Simulation throughput: \([0-9]*\) pixel clocks\/sec, \([0-9.]*\) frames\/sec, \([0-9.]*\)% of real-time (\([0-9.]*\) sec.*/\1 \2 \3 \4/p' sim/logs/stdout.txt)
+				  echo "$$result $$job $${tput:-- - - -}" >../result.txt ) &
+			done
+		done
+	done
+	wait
+	awk 'BEGIN { printf "%-4s %-40s %12s %10s %10s %9s\n", "", "job", "clocks/sec", "frames/sec", "real-time%", "wall-sec" }
+	  { printf "%-4s %-40s %12s %10s %10s %9s\n", $$1, $$2, $$3, $$4, $$5, $$6 ; if ($$1 == "PASS") pass++ ; else fail++ }
+	  END { printf "=== vfarm: %d passed, %d failed (logs in $(LOGS)/farm/<job>)\n", pass, fail }' \
+	  $(LOGS)/farm/*/result.txt | tee $(LOGS)/farm/xosera_vsim_farm.txt
+	! grep -q "^FAIL" $(LOGS)/farm/*/result.txt
+.PHONY: vfarm
+
 # run Verilator to build and run native simulation executable
 irun: $(RESET_COPMEM) $(VLT_CONFIG) sim/$(TBTOP) sim.mk
 	@mkdir -p $(LOGS)
@@ -206,6 +433,38 @@ $(VLT_CONFIG):
 	@echo >>$(VLT_CONFIG) lint_off -rule UNDRIVEN   -file \"$(TECH_LIB)\"
 	@echo >>$(VLT_CONFIG) lint_off -rule GENUNNAMED -file \"$(TECH_LIB)\"
 
+# internal RTL signals sampled by profiling options (PROFILE=1 builds only)
+$(VLT_PROFILE): sim.mk
+	@echo >$(VLT_PROFILE)
+	@echo >>$(VLT_PROFILE) \`verilator_config
+	@echo >>$(VLT_PROFILE) public -module \"vram_arb\" -var \"vgen_sel_i\"
+	@echo >>$(VLT_PROFILE) public -module \"vram_arb\" -var \"regs_sel_i\"
+	@echo >>$(VLT_PROFILE) public -module \"vram_arb\" -var \"blit_sel_i\"
+	@echo >>$(VLT_PROFILE) public -module \"vram_arb\" -var \"blit_ack_o\"
+	@echo >>$(VLT_PROFILE) public -module \"vram_arb\" -var \"vram_wr\"
+	@echo >>$(VLT_PROFILE) public -module \"vram_arb\" -var \"vram_addr\"
+	@echo >>$(VLT_PROFILE) public -module \"video_gen\" -var \"audio_vram_req\"
+	@echo >>$(VLT_PROFILE) public -module \"video_gen\" -var \"audio_vram_sel\"
+	@echo >>$(VLT_PROFILE) public -module \"copper_slim\" -var \"xr_wr_ack_i\"
+	@echo >>$(VLT_PROFILE) public -module \"copper_slim\" -var \"h_count_i\"
+	@echo >>$(VLT_PROFILE) public -module \"copper_slim\" -var \"v_count_i\"
+	@echo >>$(VLT_PROFILE) public -module \"copper_slim\" -var \"cop_IR\"
+	@echo >>$(VLT_PROFILE) public -module \"copper_slim\" -var \"wait_hv_flag\"
+	@echo >>$(VLT_PROFILE) public -module \"copper_slim\" -var \"wait_for_v\"
+	@echo >>$(VLT_PROFILE) public -module \"copper_slim\" -var \"xr_wr_en\"
+	@echo >>$(VLT_PROFILE) public -module \"copper_slim\" -var \"cop_reset\"
+	@echo >>$(VLT_PROFILE) public -module \"copper_slim\" -var \"cop_ex_state\"
+	@echo >>$(VLT_PROFILE) public -module \"copper_slim\" -var \"op_addr\"
+	@echo >>$(VLT_PROFILE) public -module \"blitter_slim\" -var \"blit_busy_o\"
+	@echo >>$(VLT_PROFILE) public -module \"blitter_slim\" -var \"xreg_blit_queued\"
+	@echo >>$(VLT_PROFILE) public -module \"audio_mixer_slim\" -var \"chan_val\"
+	@echo >>$(VLT_PROFILE) public -module \"reg_interface\" -var \"xr_rd\"
+	@echo >>$(VLT_PROFILE) public -module \"reg_interface\" -var \"vram_rd\"
+	@echo >>$(VLT_PROFILE) public -module \"xosera_main\" -var \"intr_mask\"
+	@echo >>$(VLT_PROFILE) public -module \"xosera_main\" -var \"intr_status\"
+	@echo >>$(VLT_PROFILE) public -module \"xosera_main\" -var \"intr_trigger\"
+	@echo >>$(VLT_PROFILE) public_flat_rw -module \"xrmem_arb\" -var \"sim_xr_*\"
+
 # assemble casm into mem file
 cop_init:  $(COPASM) $(RESET_COP)
 	@mkdir -p $(@D)
@@ -214,16 +473,39 @@ cop_init:  $(COPASM) $(RESET_COP)
 cop_clean:
 	rm -f $(addsuffix .lst,$(basename $(RESET_COP))) $(addsuffix .mem,$(basename $(RESET_COP)))
 
+# assemble all copper files with one batch mode copasm (grouped target needs GNU make 4.3 or later, older make
+# uses the per-file pattern rule below)
+ifneq ($(filter-out 3.% 4.0% 4.1% 4.2%,$(MAKE_VERSION)),)
+$(COPSRC) &: $(wildcard sim/*.casm) $(COPASM)
+	@mkdir -p $(VOBJDIR)/sim
+	$(COPASM) -j $(MAX_CPUS) $(COPASMOPT) -l -i $(XOSERA_M68K_API) -o $(VOBJDIR)/%.vsim.h $(filter %.casm,$^)
+endif
+
 # assembler copper file
-%.vsim.h : %.casm
+$(VOBJDIR)/%.vsim.h : %.casm
 	@mkdir -p $(@D)
 	$(COPASM) $(COPASMOPT) -l -i $(XOSERA_M68K_API) -o $@ $<
 
-# use Verilator to build native simulation executable
-sim/obj_dir/V$(VTOP): $(VLT_CONFIG) $(CSRC) $(INC) $(SRC) $(RESET_COPMEM) $(COPSRC) sim.mk
+# use Verilator to build native simulation executable (removing copper output older builds left in sim/, which
+# would be included instead of $(VOBJDIR)/sim)
+$(VOBJDIR)/V$(VTOP): $(VLT_CONFIG) $(VPROFILE_VLT) $(CSRC) $(EVLOG).h sim/xosera_memsnap.h $(SCRIPT_SYMS) $(INC) $(SRC) $(VSPI_SRC) $(RESET_COPMEM) $(COPSRC) sim.mk
 	@mkdir -p $(@D)
-	$(VERILATOR) $(VERILATOR_ARGS) -O3 --cc --exe --trace $(DEFINES) $(CFLAGS) $(LDFLAGS) --top-module $(VTOP) $(SRC) $(current_dir)/$(CSRC)
-	cd sim/obj_dir && make -f V$(VTOP).mk
+	@rm -f sim/*.vsim.h
+	$(VERILATOR) $(VERILATOR_ARGS) $(VOPT) --cc --exe $(VTRACE_ARGS) $(VTHREADS_ARGS) $(VSAVABLE_ARGS) $(VPROFILE_ARGS) $(DEFINES) $(CFLAGS) -CFLAGS "-I$(current_dir)/$(VOBJDIR)/sim" $(LDFLAGS) --top-module $(VSIM_TOP) --prefix V$(VTOP) $(SRC) $(VSPI_SRC) $(current_dir)/$(CSRC)
+	cd $(VOBJDIR) && make -f V$(VTOP).mk $(VMAKE_ARGS)
+
+# every xosera_m68k_defs.h object-like #define with a value (X_CASTU16 is a cast, ROSCO_M68K only names are guarded)
+$(SCRIPT_SYMS): $(XOSERA_M68K_API)/xosera_m68k_defs.h sim.mk
+	awk '$$1 == "#define" && $$2 ~ /^[A-Za-z_][A-Za-z0-9_]*$$/ && NF > 2 && $$3 !~ /^\/\// && $$2 != "X_CASTU16" && !seen[$$2]++ \
+	  { printf "#if defined(%s)\nSCRIPT_SYM(%s);\n#endif\n", $$2, $$2 }' $< >$@
+
+# build host event log decoder
+$(EVLOG): $(EVLOG).cpp $(EVLOG).h sim.mk
+	$(CXX) -std=c++14 -O2 -Wall -Wextra -Werror -o $@ $<
+
+# build host memory snapshot compare
+$(MEMDIFF): $(MEMDIFF).cpp sim/xosera_memsnap.h sim.mk
+	$(CXX) -std=c++14 -O2 -Wall -Wextra -Werror -o $@ $<
 
 # use Icarus Verilog to build vvp simulation executable
 sim/$(TBTOP): $(INC) sim/$(TBTOP).sv $(SRC) $(RESET_COPMEM) $(COPASM) sim.mk
@@ -233,7 +515,7 @@ sim/$(TBTOP): $(INC) sim/$(TBTOP).sv $(SRC) $(RESET_COPMEM) $(COPASM) sim.mk
 
 # delete all targets that will be re-generated
 clean:
-	rm -rf sim/obj_dir $(VLT_CONFIG) sim/$(TBTOP) sim/*.vsim.h sim/*.lst
+	rm -rf sim/obj_dir sim/obj_dir_* $(VLT_CONFIG) $(VLT_PROFILE) sim/$(TBTOP) $(EVLOG) $(MEMDIFF) $(SCRIPT_SYMS) sim/*.vsim.h sim/*.lst
 .PHONY: clean
 
 # prevent make from deleting any intermediate files
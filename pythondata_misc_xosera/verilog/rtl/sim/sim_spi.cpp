@@ -0,0 +1,93 @@
+// sim_spi.cpp - host SPI routines for Xosera Verilator simulation (host_spi and xvid_spi, in place of ftdi_spi.cpp)
+//
+// vim: set et ts=4 sw=4
+//
+// Copyright (c) 2020 Xark - https://hackaday.io/Xark
+//
+// See top-level LICENSE file for license information. (Hint: MIT)
+//
+// Build with "make SPI_TRANSPORT=sim" and run simulation with "-cosim /xosera_cosim -spi" (or set XOSERA_COSIM to
+// the shared memory name used).  SPI bytes are clocked into the simulated SPI target at the simulation -spi_div
+// rate.  host_spi_close() ends the simulation.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ftdi_spi.h"
+#include "xosera_cosim.h"
+
+unsigned int      chunksize;        // set on open to the maximum size that can be sent/received per call
+static xcosim_t * sim_cs;           // attached simulation shared memory
+
+static void host_spi_cleanup()
+{
+    if (sim_cs != nullptr)
+    {
+        xcosim_detach(sim_cs);
+        sim_cs = nullptr;
+    }
+}
+
+// NOTE: cs = false to select (active low)
+void host_spi_cs(bool cs)
+{
+    if (sim_cs != nullptr && !xcosim_spi_cs(sim_cs, cs))
+    {
+        fprintf(stderr, "host_spi_cs: simulation ended\n");
+        host_spi_cleanup();
+        exit(EXIT_FAILURE);
+    }
+}
+
+int host_spi_xfer_bytes(size_t num, uint8_t * inout)
+{
+    if (num < 1)
+    {
+        return -1;
+    }
+
+    if (sim_cs == nullptr || !xcosim_spi_xfer(sim_cs, static_cast<uint32_t>(num), inout))
+    {
+        fprintf(stderr, "host_spi_xfer_bytes: simulation ended\n");
+        host_spi_cleanup();
+        exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
+
+int host_spi_open()
+{
+    const char * name = getenv("XOSERA_COSIM");
+    if (name == nullptr)
+    {
+        name = "/xosera_cosim";
+    }
+
+    printf("Attaching to Xosera simulation \"%s\"...", name);
+    fflush(stdout);
+    if ((sim_cs = xcosim_attach(name)) == nullptr)
+    {
+        return -1;
+    }
+    chunksize = 4096;
+
+    atexit(host_spi_cleanup);
+
+    printf("Success.\n");
+
+    return 0;
+}
+
+int host_spi_close()
+{
+    if (sim_cs != nullptr)
+    {
+        xcosim_spi_cs(sim_cs, true);
+        xcosim_put(sim_cs, 0xffff);        // REG_END
+    }
+    host_spi_cleanup();
+
+    return 0;
+}
@@ -0,0 +1,238 @@
+// xosera_cosim.h - Xosera Verilator simulation shared-memory co-simulation bus
+//
+// vim: set et ts=4 sw=4
+//
+// Shared by xosera_sim.cpp (-cosim <name> option creates POSIX shared memory <name>) and host programs that drive
+// the simulated bus (C or C++, link with -lrt on older glibc).
+//
+// The host queues bus test_data words (same encoding as sim -script ".bin" files, see REG_BH/REG_BL/REG_RW in
+// xosera_sim.cpp) in the request ring and the simulation issues them in order on the bus.  Each read word (bit 15
+// set) returns one byte (bus_data_o) in the response ring, in request order (this includes the SYS_CTRL read that
+// starts REG_WAIT_BLIT_READY/REG_WAIT_BLIT_DONE).  Writes never wait for the simulation, so a host can queue many
+// words before reading responses (batch and pipeline, instead of a round-trip per access).  REG_END (0xffff) ends
+// the simulation.
+//
+// With the simulation -spi option, the host instead queues XCOSIM_SPI_CS and XCOSIM_SPI_BYTE words (see
+// xcosim_spi_cs/xcosim_spi_xfer) that are clocked into the SPI target, and each SPI byte returns one CIPO byte.
+//
+// The simulation -record <file> option saves the host words (with the pixel clock they were issued) and the read
+// bytes returned, and -replay <file> issues them again at the same times without a host (see xcosim_rec_t).
+//
+// Example:
+//
+//  xcosim_t * cs = xcosim_attach("/xosera_cosim");
+//  xcosim_reg_write(cs, XM_WR_ADDR, 0x1000);
+//  xcosim_reg_write(cs, XM_DATA, 0x1234);
+//  uint16_t v = xcosim_reg_read(cs, XM_SYS_CTRL);        // waits for queued writes and this read
+//  xcosim_put(cs, 0xffff);                               // REG_END
+
+#if !defined(XOSERA_COSIM_H)
+#define XOSERA_COSIM_H
+
+#include <fcntl.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define XCOSIM_MAGIC      0x4d49534f43534f58ULL        // "XOSCOSIM" (little-endian)
+#define XCOSIM_VERSION    1
+#define XCOSIM_RING_WORDS 65536                        // request and response ring size (power of two)
+
+#define XCOSIM_SPI_CS   0x4100        // -spi: | 1 to de-select (CS high), | 0 to select (CS low)
+#define XCOSIM_SPI_BYTE 0x4000        // -spi: | byte to send, returns received byte
+
+enum
+{
+    XCOSIM_WAITING = 0,        // shared memory created, simulation not started
+    XCOSIM_RUNNING = 1,        // simulation running (bus idle when request ring is empty)
+    XCOSIM_ENDED   = 2,        // simulation ended (no more responses)
+};
+
+// -record file: xcosim_rec_header_t then xcosim_rec_t entries (XCOSIM_REC_WORDS followed by value request words)
+#define XCOSIM_REC_MAGIC   0x4345524f43534f58ULL        // "XOSCOREC" (little-endian)
+#define XCOSIM_REC_VERSION 1
+
+enum
+{
+    XCOSIM_REC_WORDS = 1,        // request words taken from ring (one batch)
+    XCOSIM_REC_READ  = 2,        // read byte returned in response ring
+};
+
+typedef struct xcosim_rec_header
+{
+    uint64_t magic;          // XCOSIM_REC_MAGIC
+    uint32_t version;        // XCOSIM_REC_VERSION
+    uint32_t spi_div;        // -spi pixel clocks per SPI bit (0 if words were bus test_data)
+} xcosim_rec_header_t;
+
+typedef struct xcosim_rec
+{
+    uint64_t time;            // pixel clock
+    uint16_t type;            // XCOSIM_REC_xxx
+    uint16_t value;           // number of words following (XCOSIM_REC_WORDS) or byte (XCOSIM_REC_READ)
+    uint32_t reserved;
+} xcosim_rec_t;
+
+// shared memory layout (ring indices are free-running, accessed with __atomic builtins so header works for C and C++)
+typedef struct xcosim
+{
+    uint64_t magic;            // XCOSIM_MAGIC
+    uint32_t version;          // XCOSIM_VERSION
+    uint32_t ring_words;       // XCOSIM_RING_WORDS
+    uint32_t sim_state;        // XCOSIM_xxx (simulation)
+    uint32_t req_head;         // next request word to write (host)
+    uint32_t req_tail;         // next request word to issue (simulation)
+    uint32_t rsp_head;         // next response to write (simulation)
+    uint32_t rsp_tail;         // next response to read (host)
+    uint32_t intr;             // bus_intr_o level (simulation)
+    uint32_t intr_count;       // bus_intr_o rising edges (simulation)
+    uint32_t reserved;
+    uint64_t sim_time;         // main_time (half pixel clocks) when simulation last looked at request ring
+    uint16_t req[XCOSIM_RING_WORDS];
+    uint8_t  rsp[XCOSIM_RING_WORDS];
+} xcosim_t;
+
+// host: attach to shared memory created by simulation -cosim <name> option (NULL on error)
+static inline xcosim_t * xcosim_attach(const char * name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0)
+    {
+        perror("xcosim_attach shm_open failed");
+        return NULL;
+    }
+    void * mem = mmap(NULL, sizeof(xcosim_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED)
+    {
+        perror("xcosim_attach mmap failed");
+        return NULL;
+    }
+    xcosim_t * cs = (xcosim_t *)mem;
+    if (cs->magic != XCOSIM_MAGIC || cs->version != XCOSIM_VERSION || cs->ring_words != XCOSIM_RING_WORDS)
+    {
+        fprintf(stderr, "xcosim_attach \"%s\" is not a version %d Xosera co-simulation\n", name, XCOSIM_VERSION);
+        munmap(mem, sizeof(xcosim_t));
+        return NULL;
+    }
+    return cs;
+}
+
+static inline void xcosim_detach(xcosim_t * cs)
+{
+    munmap(cs, sizeof(xcosim_t));
+}
+
+static inline int xcosim_ended(xcosim_t * cs)
+{
+    return __atomic_load_n(&cs->sim_state, __ATOMIC_ACQUIRE) == XCOSIM_ENDED;
+}
+
+// host: queue bus test_data words (waits while request ring is full), returns 0 if simulation ended
+static inline int xcosim_put_words(xcosim_t * cs, const uint16_t * words, uint32_t count)
+{
+    uint32_t head = __atomic_load_n(&cs->req_head, __ATOMIC_RELAXED);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        while (head - __atomic_load_n(&cs->req_tail, __ATOMIC_ACQUIRE) >= XCOSIM_RING_WORDS)
+        {
+            __atomic_store_n(&cs->req_head, head, __ATOMIC_RELEASE);        // publish queued words before waiting
+            if (xcosim_ended(cs))
+            {
+                return 0;
+            }
+            sched_yield();
+        }
+        cs->req[head & (XCOSIM_RING_WORDS - 1)] = words[i];
+        head++;
+    }
+    __atomic_store_n(&cs->req_head, head, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static inline int xcosim_put(xcosim_t * cs, uint16_t word)
+{
+    return xcosim_put_words(cs, &word, 1);
+}
+
+// host: wait for next read response byte, returns -1 if simulation ended
+static inline int xcosim_get(xcosim_t * cs)
+{
+    uint32_t tail = __atomic_load_n(&cs->rsp_tail, __ATOMIC_RELAXED);
+    while (__atomic_load_n(&cs->rsp_head, __ATOMIC_ACQUIRE) == tail)
+    {
+        if (xcosim_ended(cs) && __atomic_load_n(&cs->rsp_head, __ATOMIC_ACQUIRE) == tail)
+        {
+            return -1;
+        }
+        sched_yield();
+    }
+    uint8_t byte = cs->rsp[tail & (XCOSIM_RING_WORDS - 1)];
+    __atomic_store_n(&cs->rsp_tail, tail + 1, __ATOMIC_RELEASE);
+    return byte;
+}
+
+// host: queue register word write (even byte then odd byte, like a 68K MOVEP.W)
+static inline int xcosim_reg_write(xcosim_t * cs, int reg, uint16_t value)
+{
+    uint16_t words[2] = {(uint16_t)((reg << 8) | (value >> 8)), (uint16_t)(((reg | 0x10) << 8) | (value & 0xff))};
+    return xcosim_put_words(cs, words, 2);
+}
+
+// host: read register word (waits for all queued requests and the read), returns -1 if simulation ended
+static inline int32_t xcosim_reg_read(xcosim_t * cs, int reg)
+{
+    uint16_t words[2] = {(uint16_t)((reg | 0x80) << 8), (uint16_t)((reg | 0x90) << 8)};
+    if (!xcosim_put_words(cs, words, 2))
+    {
+        return -1;
+    }
+    int msb = xcosim_get(cs);
+    int lsb = xcosim_get(cs);
+    return (msb < 0 || lsb < 0) ? -1 : ((msb << 8) | lsb);
+}
+
+// host: set SPI CS (-spi), deselect = 0 to select
+static inline int xcosim_spi_cs(xcosim_t * cs, int deselect)
+{
+    return xcosim_put(cs, XCOSIM_SPI_CS | (deselect ? 1 : 0));
+}
+
+// host: send num SPI bytes (-spi) and replace them with bytes received, returns 0 if simulation ended (responses
+// are read after each 256 byte chunk, so any num fits in the rings)
+static inline int xcosim_spi_xfer(xcosim_t * cs, uint32_t num, uint8_t * buffer)
+{
+    uint16_t words[256];
+    for (uint32_t i = 0; i < num; i += 256)
+    {
+        uint32_t n = (num - i) < 256 ? (num - i) : 256;
+        for (uint32_t j = 0; j < n; j++)
+        {
+            words[j] = XCOSIM_SPI_BYTE | buffer[i + j];
+        }
+        if (!xcosim_put_words(cs, words, n))
+        {
+            return 0;
+        }
+        for (uint32_t j = 0; j < n; j++)
+        {
+            int byte = xcosim_get(cs);
+            if (byte < 0)
+            {
+                return 0;
+            }
+            buffer[i + j] = (uint8_t)byte;
+        }
+    }
+    return 1;
+}
+
+// host: bus_intr_o rising edge count (compare with previous count to detect new interrupts)
+static inline uint32_t xcosim_intr_count(xcosim_t * cs)
+{
+    return __atomic_load_n(&cs->intr_count, __ATOMIC_ACQUIRE);
+}
+
+#endif        // XOSERA_COSIM_H
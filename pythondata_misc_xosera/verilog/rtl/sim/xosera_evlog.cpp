@@ -0,0 +1,129 @@
+// xosera_evlog.cpp - decode Xosera Verilator simulation binary event log
+//
+// vim: set et ts=4 sw=4
+//
+// Usage: xosera_evlog [sim/logs/xosera_vsim_events.bin] [output.log]
+//
+// Renders event records written by the simulation -evlog option as the same text that xosera_sim.cpp writes to
+// xosera_vsim.log without -evlog (keep formats below in sync with xosera_sim.cpp).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xosera_evlog.h"
+
+static const char * reg_name[] = {"XM_SYS_CTRL ",
+                                  "XM_INT_CTRL ",
+                                  "XM_TIMER    ",
+                                  "XM_RD_XADDR ",
+                                  "XM_WR_XADDR ",
+                                  "XM_XDATA    ",
+                                  "XM_RD_INCR  ",
+                                  "XM_RD_ADDR  ",
+                                  "XM_WR_INCR  ",
+                                  "XM_WR_ADDR  ",
+                                  "XM_DATA     ",
+                                  "XM_DATA_2   ",
+                                  "XM_PIXEL_X  ",
+                                  "XM_PIXEL_Y  ",
+                                  "XM_UART",
+                                  "XM_FEATURE  "};
+
+int main(int argc, char ** argv)
+{
+    const char * in_name  = argc > 1 ? argv[1] : "sim/logs/xosera_vsim_events.bin";
+    const char * out_name = argc > 2 ? argv[2] : nullptr;
+
+    FILE * ifp = fopen(in_name, "rb");
+    if (ifp == nullptr)
+    {
+        fprintf(stderr, "Reading event log \"%s\" error ", in_name);
+        perror("fopen failed");
+        exit(EXIT_FAILURE);
+    }
+    FILE * ofp = stdout;
+    if (out_name != nullptr && (ofp = fopen(out_name, "w")) == nullptr)
+    {
+        fprintf(stderr, "Creating \"%s\" error ", out_name);
+        perror("fopen failed");
+        exit(EXIT_FAILURE);
+    }
+
+    evlog_record_t rec;
+    if (fread(&rec, sizeof(rec), 1, ifp) != 1 || rec.type != EV_FILE || rec.time != EVLOG_MAGIC ||
+        rec.addr != sizeof(evlog_record_t) || rec.data != EVLOG_VERSION)
+    {
+        fprintf(stderr, "\"%s\" is not a version %u Xosera simulation event log\n", in_name, EVLOG_VERSION);
+        exit(EXIT_FAILURE);
+    }
+
+    unsigned long num_events = 0;
+    while (fread(&rec, sizeof(rec), 1, ifp) == 1)
+    {
+        int reg_num = rec.arg & 0xf;
+        int bytesel = (rec.arg >> 4) & 1;
+
+        num_events++;
+        switch (rec.type)
+        {
+            case EV_TEXT: {
+                // text bytes follow in whole records
+                uint32_t len = rec.data;
+                for (uint32_t i = 0; i < len; i += sizeof(rec))
+                {
+                    if (fread(&rec, sizeof(rec), 1, ifp) != 1)
+                    {
+                        fprintf(stderr, "\"%s\" truncated text record\n", in_name);
+                        exit(EXIT_FAILURE);
+                    }
+                    fwrite(&rec, 1, len - i < sizeof(rec) ? len - i : sizeof(rec), ofp);
+                }
+                break;
+            }
+            case EV_REG_WR:
+                fprintf(ofp,
+                        "[@t=%8lu] Write Reg %s (#%02x.%s) <= %s%02x%s\n",
+                        static_cast<unsigned long>(rec.time),
+                        reg_name[reg_num],
+                        reg_num,
+                        bytesel ? "L" : "H",
+                        bytesel ? "__" : "",
+                        rec.data,
+                        bytesel ? "" : "__");
+                break;
+            case EV_REG_RD:
+                fprintf(ofp,
+                        "[@t=%8lu] Read  Reg %s (#%02x.%s) => %s%02x%s\n",
+                        static_cast<unsigned long>(rec.time),
+                        reg_name[reg_num],
+                        reg_num,
+                        bytesel ? "L" : "H",
+                        bytesel ? "__" : "",
+                        rec.data,
+                        bytesel ? "" : "__");
+                break;
+            case EV_VRAM_WR:
+                fprintf(ofp, " => regs write VRAM[0x%04x]<=0x%04x\n", rec.addr, rec.data);
+                break;
+            case EV_VRAM_RD:
+                fprintf(ofp, " <= regs read VRAM[0x%04x]=>0x%04x\n", rec.addr, rec.data);
+                break;
+            case EV_INTR:
+                fprintf(ofp, "[@t=%8lu FPGA INTERRUPT]\n", static_cast<unsigned long>(rec.time));
+                break;
+            default:
+                fprintf(stderr, "\"%s\" unknown event type %u at record %lu\n", in_name, rec.type, num_events);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    fclose(ifp);
+    if (ofp != stdout)
+    {
+        fclose(ofp);
+    }
+    fprintf(stderr, "Decoded %lu events from \"%s\"\n", num_events, in_name);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,39 @@
+// xosera_evlog.h - Xosera Verilator simulation binary event log format
+//
+// vim: set et ts=4 sw=4
+//
+// Shared by xosera_sim.cpp (-evlog option writes sim/logs/xosera_vsim_events.bin) and xosera_evlog.cpp (decodes the
+// events back to the xosera_vsim.log text format).
+
+#if !defined(XOSERA_EVLOG_H)
+#define XOSERA_EVLOG_H
+
+#include <stdint.h>
+
+static const uint64_t EVLOG_MAGIC   = 0x474f4c5645534f58ULL;        // "XOSEVLOG" (little-endian)
+static const uint32_t EVLOG_VERSION = 1;
+
+enum
+{
+    EV_FILE    = 0,        // first record: time = EVLOG_MAGIC, addr = record size, data = EVLOG_VERSION
+    EV_TEXT    = 1,        // log text: data = byte length, followed by (length + 15) / 16 records of text bytes
+    EV_REG_WR  = 2,        // bus register write: arg = register | bytesel << 4, data = byte
+    EV_REG_RD  = 3,        // bus register read: arg = register | bytesel << 4, data = byte
+    EV_VRAM_WR = 4,        // register interface VRAM write: addr, data = word
+    EV_VRAM_RD = 5,        // register interface VRAM read: addr, data = word
+    EV_INTR    = 6,        // bus interrupt output asserted
+};
+
+// fixed-size event record (written in host byte order)
+struct evlog_record_t
+{
+    uint64_t time;        // main_time (half pixel clocks)
+    uint8_t  type;        // EV_xxx
+    uint8_t  arg;
+    uint16_t addr;
+    uint32_t data;
+};
+
+static_assert(sizeof(evlog_record_t) == 16, "evlog_record_t must be 16 bytes");
+
+#endif        // XOSERA_EVLOG_H
@@ -0,0 +1,215 @@
+// xosera_memdiff.cpp - compare two Xosera Verilator simulation memory snapshots
+//
+// vim: set et ts=4 sw=4
+//
+// Usage: xosera_memdiff [-g <gap>] [-v] <before.bin> <after.bin>
+//
+// Reports the changed address ranges in each memory region of two snapshots written by the simulation -memsnap
+// option (or REG_SNAPSHOT() in bus test_data or SIGUSR1), see xosera_memsnap.h.  Changed words closer than <gap>
+// words (default 8) are reported as one range, -v also lists each changed word.  Exits with 1 if any word changed
+// or a region is not in both snapshots with the same address and size (like cmp).
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "xosera_memsnap.h"
+
+struct snapshot_t
+{
+    const char *             name;
+    const uint8_t *          mem;
+    size_t                   size;
+    const memsnap_header_t * hdr;
+    const memsnap_region_t * regions;
+};
+
+static void open_snapshot(snapshot_t & snap, const char * name)
+{
+    int         fd = open(name, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        fprintf(stderr, "Reading memory snapshot \"%s\" error ", name);
+        perror("open failed");
+        exit(EXIT_FAILURE);
+    }
+    snap.name = name;
+    snap.size = static_cast<size_t>(st.st_size);
+    void * mem =
+        snap.size >= sizeof(memsnap_header_t) ? mmap(nullptr, snap.size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mem == MAP_FAILED)
+    {
+        fprintf(stderr, "\"%s\" is not a Xosera simulation memory snapshot\n", name);
+        exit(EXIT_FAILURE);
+    }
+    snap.mem     = static_cast<const uint8_t *>(mem);
+    snap.hdr     = reinterpret_cast<const memsnap_header_t *>(snap.mem);
+    snap.regions = reinterpret_cast<const memsnap_region_t *>(snap.mem + sizeof(memsnap_header_t));
+
+    if (snap.hdr->magic != MEMSNAP_MAGIC || snap.hdr->version != MEMSNAP_VERSION ||
+        snap.hdr->num_regions > MEMSNAP_MAX_REGIONS ||
+        sizeof(memsnap_header_t) + snap.hdr->num_regions * sizeof(memsnap_region_t) > snap.size)
+    {
+        fprintf(stderr, "\"%s\" is not a version %u Xosera simulation memory snapshot\n", name, MEMSNAP_VERSION);
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t r = 0; r < snap.hdr->num_regions; r++)
+    {
+        if (static_cast<size_t>(snap.regions[r].offset) + snap.regions[r].words * sizeof(uint16_t) > snap.size)
+        {
+            fprintf(stderr, "\"%s\" truncated region \"%.16s\"\n", name, snap.regions[r].name);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static const memsnap_region_t * find_region(const snapshot_t & snap, const char * name)
+{
+    for (uint32_t r = 0; r < snap.hdr->num_regions; r++)
+    {
+        if (strncmp(snap.regions[r].name, name, sizeof(snap.regions[r].name)) == 0)
+        {
+            return &snap.regions[r];
+        }
+    }
+    return nullptr;
+}
+
+static const uint16_t * region_words(const snapshot_t & snap, const memsnap_region_t * r)
+{
+    return reinterpret_cast<const uint16_t *>(snap.mem + r->offset);
+}
+
+int main(int argc, char ** argv)
+{
+    uint32_t gap     = 8;
+    bool     verbose = false;
+    int      nextarg = 1;
+
+    while (nextarg < argc && argv[nextarg][0] == '-')
+    {
+        if (strcmp(argv[nextarg], "-v") == 0)
+        {
+            verbose = true;
+        }
+        else if (strcmp(argv[nextarg], "-g") == 0 && nextarg + 1 < argc)
+        {
+            gap = static_cast<uint32_t>(strtoul(argv[++nextarg], nullptr, 0));
+        }
+        else
+        {
+            break;
+        }
+        nextarg++;
+    }
+    if (argc - nextarg != 2)
+    {
+        fprintf(stderr, "Usage: xosera_memdiff [-g <gap>] [-v] <before.bin> <after.bin>\n");
+        exit(EXIT_FAILURE);
+    }
+
+    snapshot_t a, b;
+    open_snapshot(a, argv[nextarg]);
+    open_snapshot(b, argv[nextarg + 1]);
+
+    printf("A: \"%s\" #%u (%.32s) frame %d @t=%lu\n",
+           a.name,
+           a.hdr->snap_num,
+           a.hdr->why,
+           a.hdr->frame,
+           static_cast<unsigned long>(a.hdr->time));
+    printf("B: \"%s\" #%u (%.32s) frame %d @t=%lu\n",
+           b.name,
+           b.hdr->snap_num,
+           b.hdr->why,
+           b.hdr->frame,
+           static_cast<unsigned long>(b.hdr->time));
+
+    unsigned long total_changed  = 0;
+    unsigned long regions_differ = 0;        // regions missing from A or B (or different address/size)
+    for (uint32_t r = 0; r < a.hdr->num_regions; r++)
+    {
+        const memsnap_region_t * ra = &a.regions[r];
+        const memsnap_region_t * rb = find_region(b, ra->name);
+        if (rb == nullptr || rb->words != ra->words || rb->addr != ra->addr)
+        {
+            printf("%-12.16s not in B (or different size)\n", ra->name);
+            regions_differ++;
+            continue;
+        }
+
+        const uint16_t * wa      = region_words(a, ra);
+        const uint16_t * wb      = region_words(b, rb);
+        uint32_t         changed = 0;
+        uint32_t         i       = 0;
+        while (i < ra->words)
+        {
+            if (wa[i] == wb[i])
+            {
+                i++;
+                continue;
+            }
+
+            // extend range while next change is within gap words
+            uint32_t start = i;
+            uint32_t last  = i;
+            uint32_t count = 0;
+            for (; i < ra->words && i - last <= gap; i++)
+            {
+                if (wa[i] != wb[i])
+                {
+                    last = i;
+                    count++;
+                }
+            }
+            i = last + 1;
+            changed += count;
+            printf("%-12.16s 0x%04x-0x%04x %5u of %5u words changed\n",
+                   ra->name,
+                   ra->addr + start,
+                   ra->addr + last,
+                   count,
+                   last - start + 1);
+            if (verbose)
+            {
+                for (uint32_t j = start; j <= last; j++)
+                {
+                    if (wa[j] != wb[j])
+                    {
+                        printf("    0x%04x: 0x%04x => 0x%04x\n", ra->addr + j, wa[j], wb[j]);
+                    }
+                }
+            }
+        }
+        if (changed == 0)
+        {
+            printf("%-12.16s unchanged (%u words)\n", ra->name, ra->words);
+        }
+        total_changed += changed;
+    }
+    for (uint32_t r = 0; r < b.hdr->num_regions; r++)
+    {
+        if (find_region(a, b.regions[r].name) == nullptr)
+        {
+            printf("%-12.16s not in A\n", b.regions[r].name);
+            regions_differ++;
+        }
+    }
+    printf("%lu words changed", total_changed);
+    if (regions_differ != 0)
+    {
+        printf(", %lu regions not in both snapshots", regions_differ);
+    }
+    printf("\n");
+
+    munmap(const_cast<uint8_t *>(a.mem), a.size);
+    munmap(const_cast<uint8_t *>(b.mem), b.size);
+
+    return (total_changed || regions_differ) ? 1 : EXIT_SUCCESS;
+}
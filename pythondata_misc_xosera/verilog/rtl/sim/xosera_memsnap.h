@@ -0,0 +1,45 @@
+// xosera_memsnap.h - Xosera Verilator simulation memory snapshot file format
+//
+// vim: set et ts=4 sw=4
+//
+// Shared by xosera_sim.cpp (-memsnap option, REG_SNAPSHOT() bus test_data marker or SIGUSR1 write
+// sim/logs/xosera_vsim_memsnap_<n>.bin) and xosera_memdiff.cpp (reports changed regions between two snapshots).
+//
+// A snapshot file is a header, a table of regions and then each region's 16-bit memory words (in host byte order, so
+// a file can be memory-mapped and used directly).  Each snapshot is also listed in sim/logs/xosera_vsim_memsnap.txt.
+
+#if !defined(XOSERA_MEMSNAP_H)
+#define XOSERA_MEMSNAP_H
+
+#include <stdint.h>
+
+static const uint64_t MEMSNAP_MAGIC       = 0x50414e534d534f58ULL;        // "XOSMSNAP" (little-endian)
+static const uint32_t MEMSNAP_VERSION     = 1;
+static const uint32_t MEMSNAP_MAX_REGIONS = 16;
+
+// file header (followed by num_regions memsnap_region_t)
+struct memsnap_header_t
+{
+    uint64_t magic;              // MEMSNAP_MAGIC
+    uint32_t version;            // MEMSNAP_VERSION
+    uint32_t num_regions;        // memsnap_region_t entries following header
+    uint64_t time;               // main_time (half pixel clocks)
+    int32_t  frame;              // frame number
+    uint32_t snap_num;           // snapshot sequence number in this simulation run
+    char     why[32];            // trigger (e.g., "frame 3", "REG_SNAPSHOT", "SIGUSR1"), NUL terminated
+};
+
+// memory region (words at byte offset from start of file)
+struct memsnap_region_t
+{
+    char     name[16];        // memory name (e.g., "vram", "colormem_A"), NUL terminated
+    uint32_t addr;            // VRAM or XR address of first word
+    uint32_t words;           // number of 16-bit words
+    uint32_t offset;          // file byte offset of first word
+    uint32_t reserved;
+};
+
+static_assert(sizeof(memsnap_header_t) == 64, "memsnap_header_t must be 64 bytes");
+static_assert(sizeof(memsnap_region_t) == 32, "memsnap_region_t must be 32 bytes");
+
+#endif        // XOSERA_MEMSNAP_H
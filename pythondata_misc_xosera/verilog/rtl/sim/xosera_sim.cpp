@@ -5,23 +5,99 @@
 // Thanks to Dan "drr" Rodrigues for the amazing icestation-32 project which
 // has a nice example of how to use Verilator with Yosys and SDL.  This code
 // was created starting with that (so drr gets most of the credit).
-
+//
+// Command line options (before optional test_data words):
+//  -n                      no SDL window (and no frame images unless -f given)
+//  -b                      enable bus test_data
+//  -w                      wait for RETURN before closing SDL window
+//  -u <file>[@<off>[:<len>]] upload file data (at REG_UPLOAD in test_data), optional byte offset and length
+//  -script <file>          bus test_data script (text REG_xxx() list or ".bin" words) instead of compiled in (implies -b)
+//  -f <png|ppm|raw|none>   frame image format (png needs SDL_RENDER)
+//  -save <file>            save snapshot (needs SAVABLE=1 build), at -save_frame or -save_index (default frame 1)
+//  -save_frame <n>         save snapshot at start of frame <n>
+//  -save_index <n>         save snapshot when bus test_data index reaches <n>
+//  -restore <file>         restore snapshot and continue (use same -u uploads, -fastbus and -backdoor as saved run)
+//  -vprof                  profile VRAM arbitration (needs PROFILE=1 build, sim/logs/xosera_vsim_vram_prof.csv/.json
+//                          and _heatmap.ppm)
+//  -cprof                  profile copper execution (needs PROFILE=1 build, sim/logs/xosera_vsim_copper_hist.txt,
+//                          _lines.csv, _timeline.csv)
+//  -cprof_lst <file>       CopAsm listing (copasm -l) for -cprof histogram source lines (can be repeated, implies -cprof)
+//  -cprof_frame <n>        frame for -cprof per-scanline timeline (default 1)
+//  -wav                    capture audio PDM outputs as PCM (sim/logs/xosera_vsim_audio.wav)
+//  -wav_rate <hz>          -wav sample rate (default 48000, implies -wav)
+//  -wav_taps               also capture mixer channel samples (needs PROFILE=1 build,
+//                          sim/logs/xosera_vsim_audio_taps.wav, implies -wav)
+//  -latency               log interrupt (signal to bus_intr_o, pending to INT_CTRL ack) and XM_DATA/XM_XDATA read
+//                          (MEM_WAIT) latency histograms at end of simulation (needs PROFILE=1 build)
+//  -memsnap <n>[-<n>]      save VRAM/XR memory snapshot at end of frame(s) (sim/logs/xosera_vsim_memsnap_<n>.bin, can be
+//                          repeated), also saved at REG_SNAPSHOT() in bus test_data or on SIGUSR1 (see xosera_memdiff)
+//  -check <dir>            compare visible pixel hash of each frame with <dir>/golden.txt, only mismatched frames saved
+//                          (with _mask image of differing pixels), exit with failure after -check_max mismatches
+//  -check_update <dir>     save golden frame hashes and raw frames from this run to <dir> (for -check)
+//  -check_max <n>          -check mismatched frames before stopping (default 1)
+//  -evlog                  log to binary sim/logs/xosera_vsim_events.bin via writer thread (decode with sim/xosera_evlog)
+//  -fastbus                bus test_data strobes at minimum spacing (TIMING-RELAXED, waits out pending VRAM/XR access)
+//  -backdoor               REG_UPLOAD data written directly to VRAM/XR memory, then next address (and odd last byte)
+//                          written over bus (TIMING-RELAXED, setup phases only, XR memory needs PROFILE=1 build)
+//  -cosim <name>           bus test_data words from host process via shared memory <name> (see xosera_cosim.h)
+//  -record <file>          save -cosim host words (with pixel clock taken) and read bytes returned to <file>
+//  -replay <file>          issue -record host words again at the recorded pixel clocks (no host), compare reads
+//  -replay_gap <clocks>    -replay shortens idle gaps between host words longer than <clocks> pixel clocks
+//  -replay_lenient         -replay only reports read mismatches (e.g. timing dependent reads with -replay_gap)
+//  -spi                    -cosim host words drive SPI target pins (needs SPI=1 build, xvid_spi/host_spi built
+//                          with SPI_TRANSPORT=sim)
+//  -spi_div <n>            -spi pixel clocks per SPI bit (default for 2 MHz SCK, like ftdi_spi.cpp)
+//  -spi_gap <usec>         -spi host turnaround per transaction for throughput report (default 1000)
+//  -blitbench              run blitter benchmark sweep instead of test_data (needs PROFILE=1 build,
+//                          sim/logs/xosera_vsim_blitbench_<mode>.csv)
+//  -trace <trigger>        only dump trace (needs TRACE=1 build) in windows around trigger (can be repeated):
+//                            frame:<n>[-<n>]  line:<n>[-<n>][@<frame>]  reg:<XM_reg|num>  intr  vram:<addr>[-<addr>]
+//                            (vram needs PROFILE=1 build)
+//  -trace_pre <lines>      also keep <lines> scanlines of trace before each trigger window (pre-trigger ring)
+//  -trace_post <lines>     scanlines to keep dumping after reg/intr/vram trigger event (default 16)
+
+#include <limits.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "../../xosera_m68k_api/xosera_m68k_defs.h"
 #include "video_mode_defs.h"
+#include "xosera_cosim.h"
+#include "xosera_evlog.h"
+#include "xosera_memsnap.h"
 
 #include "verilated.h"
 
 #include "Vxosera_main.h"
+#include "Vxosera_main__Syms.h"        // all module classes (parameterized XR memories have generated class names)
+#if SIM_AUDIO
+#include "Vxosera_main_audio_mixer_slim.h"
+#endif
 
 #include "Vxosera_main_colormem.h"
+#include "Vxosera_main_copper_slim.h"
+#include "Vxosera_main_reg_interface.h"
+#include "Vxosera_main_video_gen.h"
 #include "Vxosera_main_vram.h"
 #include "Vxosera_main_vram_arb.h"
 #include "Vxosera_main_xosera_main.h"
+#if SIM_SPI
+#include "Vxosera_main_xosera_spi_sim.h"
+#endif
 #include "Vxosera_main_xrmem_arb.h"
 
 #define USE_FST 1
@@ -30,13 +106,41 @@
 #else
 #include "verilated_vcd_c.h"        // for VM_TRACE
 #endif
+#if SDL_RENDER
 #include <SDL.h>        // for SDL_RENDER
 #include <SDL_image.h>
+#endif
+#if SIM_SAVABLE
+#include "verilated_save.h"        // for -save/-restore (needs Verilator --savable)
+#endif
 
 #define LOGDIR "sim/logs/"
 
+#if !defined(SIM_THREADS)
+#define SIM_THREADS 1        // Verilator model threads (set by sim.mk)
+#endif
+#if !defined(SIM_AUDIO)
+#define SIM_AUDIO 0        // EN_AUDIO channels (set by sim.mk)
+#endif
+#if !defined(SIM_PF_B)
+#define SIM_PF_B 1        // EN_PF_B playfield B (set by sim.mk)
+#endif
+#if !defined(SIM_PROFILE)
+#define SIM_PROFILE 0        // PROFILE=1 internal RTL signals public for profiling options (set by sim.mk)
+#endif
+#if !defined(SIM_SPI)
+#define SIM_SPI 0        // SPI=1 sim/xosera_spi_sim.sv top with SPI target for -spi (set by sim.mk)
+#endif
+
+#if SIM_SPI
+#define XOSERA_MAIN(top) ((top)->xosera_spi_sim->xosera_main)        // xosera_main inside SPI sim top
+#else
+#define XOSERA_MAIN(top) ((top)->xosera_main)
+#endif
+
+#define NUM_ELEMENTS(a) (sizeof(a) / sizeof(a[0]))
+
 #define MAX_TRACE_FRAMES 30        // video frames to dump to VCD file (and then screen-shot and exit)
-#define MAX_UPLOADS      8         // maximum number of "payload" uploads
 
 // Current simulation time (64-bit unsigned)
 vluint64_t main_time         = 0;
@@ -48,19 +152,164 @@ bool          sim_render = SDL_RENDER;
 bool          sim_bus    = BUS_INTERFACE;
 bool          wait_close = false;
 
+// frame image output format (-f option)
+enum
+{
+    FRAME_NONE,        // no frame images (pixels not captured unless rendering)
+    FRAME_PNG,         // PNG via SDL_image (SDL_RENDER builds only)
+    FRAME_PPM,         // binary PPM (P6) 8-bit RGB
+    FRAME_RAW,         // raw 16-bit big-endian 0x0RGB words (same format as Xosera colormem)
+};
+int  frame_format = SDL_RENDER ? FRAME_PNG : FRAME_PPM;
+bool sim_capture  = false;        // true if pixels are written to frame_buffer
+
 bool vsync_detect = false;
 bool vtop_detect  = false;
 bool hsync_detect = false;
 
-int          num_uploads;
-int          next_upload;
-const char * upload_name[MAX_UPLOADS];
-uint8_t *    upload_payload[MAX_UPLOADS];
-int          upload_size[MAX_UPLOADS];
-uint8_t      upload_buffer[128 * 1024];
+// memory snapshot requests (saved by MemSnapshot in main loop)
+const char *          memsnap_why;           // set by REG_SNAPSHOT() bus test_data marker
+volatile sig_atomic_t memsnap_signal;        // set by SIGUSR1
+
+struct upload_t
+{
+    std::string     name;          // file name
+    size_t          offset;        // byte offset in file
+    size_t          length;        // byte length (0 for rest of file)
+    const uint8_t * payload;       // memory-mapped file data (at offset, paged in as it is uploaded)
+    int             size;          // upload byte count
+};
+
+std::vector<upload_t> uploads;
 
 uint16_t last_read_val;
 
+// ARGB8888 frame (including offscreen border), given to SDL as a texture once per frame and saved as image
+uint32_t frame_buffer[TOTAL_HEIGHT][TOTAL_WIDTH];
+
+// Asynchronous binary event log (-evlog option)
+//
+// Per-clock log events (bus register access, register interface VRAM access and interrupt) are stored as fixed-size
+// binary records in a single-producer/single-consumer lock-free ring and other log text is copied in as text records
+// (so order is kept). A writer thread drains the ring to sim/logs/xosera_vsim_events.bin, use sim/xosera_evlog to
+// decode it to the xosera_vsim.log text format.
+class EventLog
+{
+    static const size_t RING_RECORDS = 1 << 18;        // must be power of two
+    static const size_t RING_MASK    = RING_RECORDS - 1;
+
+    evlog_record_t *    ring;
+    std::atomic<size_t> head;        // next record to write (only changed by sim thread)
+    std::atomic<size_t> tail;        // next record to drain (only changed by writer thread)
+    std::atomic<bool>   stop;
+    std::thread         writer;
+    FILE *              fp;
+    uint64_t            stalls;        // times sim waited for a full ring
+
+    void drain()
+    {
+        for (;;)
+        {
+            size_t t = tail.load(std::memory_order_relaxed);
+            size_t h = head.load(std::memory_order_acquire);
+            if (t == h)
+            {
+                if (stop.load(std::memory_order_acquire) && head.load(std::memory_order_acquire) == t)
+                {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+            size_t start = t & RING_MASK;
+            size_t n     = std::min(h - t, RING_RECORDS - start);
+            fwrite(&ring[start], sizeof(evlog_record_t), n, fp);
+            tail.store(t + n, std::memory_order_release);
+        }
+    }
+
+public:
+    EventLog()
+        : ring(nullptr)
+        , head(0)
+        , tail(0)
+        , stop(false)
+        , fp(nullptr)
+        , stalls(0)
+    {
+    }
+
+    void init(const char * name)
+    {
+        if ((fp = fopen(name, "wb")) == nullptr)
+        {
+            fprintf(stderr, "Creating event log \"%s\" error ", name);
+            perror("fopen failed");
+            exit(EXIT_FAILURE);
+        }
+        ring = new evlog_record_t[RING_RECORDS];
+        put(EV_FILE, EVLOG_MAGIC, 0, sizeof(evlog_record_t), EVLOG_VERSION);
+        writer = std::thread(&EventLog::drain, this);
+    }
+
+    // add record (waits if ring is full, so events are never dropped)
+    void put(const evlog_record_t & rec)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= RING_RECORDS)
+        {
+            stalls++;
+            while (h - tail.load(std::memory_order_acquire) >= RING_RECORDS)
+            {
+                std::this_thread::yield();
+            }
+        }
+        ring[h & RING_MASK] = rec;
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    void put(uint8_t type, uint64_t time, uint8_t arg, uint16_t addr, uint32_t data)
+    {
+        evlog_record_t rec = {time, type, arg, addr, data};
+        put(rec);
+    }
+
+    // add log text (as EV_TEXT record followed by text bytes in 16 byte records)
+    void text(const char * str)
+    {
+        size_t len = strlen(str);
+        put(EV_TEXT, main_time, 0, 0, static_cast<uint32_t>(len));
+        for (size_t i = 0; i < len; i += sizeof(evlog_record_t))
+        {
+            evlog_record_t rec;
+            memset(&rec, 0, sizeof(rec));
+            memcpy(&rec, str + i, std::min(len - i, sizeof(rec)));
+            put(rec);
+        }
+    }
+
+    // stop writer thread after ring is drained and close file
+    void finish()
+    {
+        if (fp == nullptr)
+        {
+            return;
+        }
+        stop.store(true, std::memory_order_release);
+        writer.join();
+        fclose(fp);
+        fp = nullptr;
+        delete[] ring;
+        ring = nullptr;
+        if (stalls)
+        {
+            fprintf(stderr, "Event log ring was full %lu times (sim waited for writer)\n", stalls);
+        }
+    }
+};
+
+EventLog * evlog;        // non-null if -evlog (log output goes to binary event log)
+
 static FILE * logfile;
 static char   log_buff[16384];
 
@@ -70,7 +319,14 @@ static void log_printf(const char * fmt, ...)
     va_start(args, fmt);
     vsnprintf(log_buff, sizeof(log_buff), fmt, args);
     fputs(log_buff, stdout);
-    fputs(log_buff, logfile);
+    if (evlog != nullptr)
+    {
+        evlog->text(log_buff);
+    }
+    else
+    {
+        fputs(log_buff, logfile);
+    }
     va_end(args);
 }
 
@@ -79,188 +335,1007 @@ static void logonly_printf(const char * fmt, ...)
     va_list args;
     va_start(args, fmt);
     vsnprintf(log_buff, sizeof(log_buff), fmt, args);
-    fputs(log_buff, logfile);
+    if (evlog != nullptr)
+    {
+        evlog->text(log_buff);
+    }
+    else
+    {
+        fputs(log_buff, logfile);
+    }
     va_end(args);
 }
 
-class BusInterface
+// Shared-memory co-simulation bus (-cosim <name> option)
+//
+// Another local process queues bus test_data words in a POSIX shared memory ring (see xosera_cosim.h) and they are
+// issued by BusInterface in place of test_data (the bus idles while the ring is empty). Read bytes are returned in a
+// response ring and bus_intr_o is forwarded as a level and rising edge count.
+//
+// With -record <file> each batch of host words is saved with the pixel clock it was taken (and each returned read
+// byte), and -replay <file> issues the batches again at the same pixel clocks with no host (or shared memory), so a
+// session replays deterministically and the read bytes are compared with the recording.  -replay_gap <clocks>
+// shortens longer idle gaps between batches (reads that depend on timing may then differ, and fail the run unless
+// -replay_lenient is also given).
+class CoSimBridge
 {
-    const int   BUS_START_TIME = 1000000;        // after init
-    const float BUS_CLOCK_DIV  = 5;              // min 5
+    static const uint32_t RING_MASK = XCOSIM_RING_WORDS - 1;
 
-    static const char * reg_name[];
-    enum
+    struct replay_batch_t
     {
-        BUS_START,
-        BUS_HOLD,
-        BUS_STROBEOFF,
-        BUS_END
+        uint64_t time;         // pixel clock words were taken
+        size_t   first;        // index in replay_words
+        size_t   count;
     };
 
-    bool    enable;
-    int64_t last_time;
-    int     state;
-    int     index;
-    bool    wait_vsync;
-    bool    wait_hsync;
-    bool    wait_vtop;
-    bool    wait_blit;
-    bool    data_upload;
-    int     data_upload_mode;
-    int     data_upload_num;
-    int     data_upload_count;
-    int     data_upload_index;
-
-    static int      test_data_len;
-    static uint16_t test_data[32768];
+    const char * name;
+    xcosim_t *   shm;
+    bool         last_intr;
+    uint64_t     num_words;
+    uint64_t     num_reads;
+    uint64_t     num_batches;
+
+    FILE *                      record_fp;        // -record
+    const char *                replay_name;      // -replay
+    std::vector<replay_batch_t> replay_batches;
+    std::vector<uint16_t>       replay_words;
+    std::vector<uint8_t>        replay_reads;
+    size_t                      batch_index;
+    size_t                      read_index;
+    uint64_t                    replay_gap;        // -replay_gap (0 for recorded timing)
+    uint64_t                    time_offset;       // idle pixel clocks removed by -replay_gap
+    uint64_t                    mismatches;        // replay read bytes different from recording
+    bool                        lenient;           // -replay_lenient (mismatches don't fail)
+
+    void record(uint16_t type, uint16_t value, const uint16_t * words = nullptr)
+    {
+        xcosim_rec_t rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.time  = main_time / 2;
+        rec.type  = type;
+        rec.value = value;
+        fwrite(&rec, sizeof(rec), 1, record_fp);
+        if (type == XCOSIM_REC_WORDS)
+        {
+            fwrite(words, sizeof(uint16_t), value, record_fp);
+        }
+    }
 
-public:
-public:
-    void set_cmdline_data(int argc, char ** argv, int & nextarg)
+    // -replay: next recorded batch if its time has come (after removing idle gap longer than -replay_gap)
+    size_t replay_fetch(uint16_t * words, size_t max)
     {
-        size_t len = 0;
-        for (int i = nextarg; i < argc && len < sizeof(test_data); i++)
+        if (batch_index >= replay_batches.size())
         {
-            char * endptr = nullptr;
-            int    value  = static_cast<int>(strtoul(argv[i], &endptr, 0) & 0x1fffUL);
-            if (endptr != nullptr && *endptr == '\0')
+            if (!done)
             {
-                test_data[len] = value;
-                len++;
+                logonly_printf("[@t=%8lu] Replay ended (no REG_END in recording)\n", main_time);
+                done = true;
             }
-            else
+            return 0;
+        }
+        replay_batch_t & b   = replay_batches[batch_index];
+        uint64_t         now = main_time / 2;
+        uint64_t         due = b.time - time_offset;
+        if (now < due)
+        {
+            if (replay_gap != 0 && due - now > replay_gap)
             {
-                break;
+                time_offset += due - now - replay_gap;
+            }
+            return 0;
+        }
+        size_t n = std::min(b.count, max);
+        memcpy(words, &replay_words[b.first], n * sizeof(uint16_t));
+        b.first += n;
+        b.count -= n;
+        if (b.count == 0)
+        {
+            batch_index++;
+        }
+        num_words += n;
+        num_batches++;
+        return n;
+    }
+
+    // -replay: compare read byte with recording
+    void replay_respond(uint8_t byte)
+    {
+        if (read_index >= replay_reads.size() || replay_reads[read_index] != byte)
+        {
+            if (mismatches < 16)
+            {
+                if (read_index < replay_reads.size())
+                {
+                    log_printf("[@t=%8lu] Replay read #%lu 0x%02x, recorded 0x%02x\n",
+                               main_time,
+                               read_index + 1,
+                               byte,
+                               replay_reads[read_index]);
+                }
+                else
+                {
+                    log_printf("[@t=%8lu] Replay read #%lu 0x%02x, not in recording\n", main_time, read_index + 1, byte);
+                }
             }
+            mismatches++;
         }
+        read_index++;
+        num_reads++;
+    }
+
+public:
+    CoSimBridge()
+        : name(nullptr)
+        , shm(nullptr)
+        , last_intr(false)
+        , num_words(0)
+        , num_reads(0)
+        , num_batches(0)
+        , record_fp(nullptr)
+        , replay_name(nullptr)
+        , batch_index(0)
+        , read_index(0)
+        , replay_gap(0)
+        , time_offset(0)
+        , mismatches(0)
+        , lenient(false)
+    {
+    }
 
-        if (len != 0)
+    void init(const char * shm_name)
+    {
+        name   = shm_name;
+        int fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (fd < 0 || ftruncate(fd, sizeof(xcosim_t)) != 0)
+        {
+            fprintf(stderr, "Creating co-simulation shared memory \"%s\" error ", name);
+            perror("shm_open failed");
+            exit(EXIT_FAILURE);
+        }
+        void * mem = mmap(nullptr, sizeof(xcosim_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED)
         {
-            test_data_len = len;
+            perror("Co-simulation shared memory mmap failed");
+            exit(EXIT_FAILURE);
         }
+        shm             = static_cast<xcosim_t *>(mem);
+        shm->version    = XCOSIM_VERSION;
+        shm->ring_words = XCOSIM_RING_WORDS;
+        __atomic_store_n(&shm->sim_state, XCOSIM_RUNNING, __ATOMIC_RELEASE);
+        __atomic_store_n(&shm->magic, XCOSIM_MAGIC, __ATOMIC_RELEASE);        // valid for xcosim_attach
+        log_printf("Co-simulation bus waiting for host on shared memory \"%s\" (xcosim_attach)\n", name);
     }
 
-    void init(Vxosera_main * top, bool _enable)
+    // -record host words and read bytes to file (spi_div 0 for bus test_data words)
+    void init_record(const char * file_name, int spi_div)
     {
-        enable            = _enable;
-        index             = 0;
-        state             = BUS_START;
-        wait_vsync        = false;
-        wait_hsync        = false;
-        wait_vtop         = false;
-        wait_blit         = false;
-        data_upload       = false;
-        data_upload_mode  = 0;
-        data_upload_num   = 0;
-        data_upload_count = 0;
-        data_upload_index = 0;
-        top->bus_cs_n_i   = 1;
+        if ((record_fp = fopen(file_name, "wb")) == nullptr)
+        {
+            fprintf(stderr, "Creating bus recording \"%s\" error ", file_name);
+            perror("fopen failed");
+            exit(EXIT_FAILURE);
+        }
+        xcosim_rec_header_t hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.magic   = XCOSIM_REC_MAGIC;
+        hdr.version = XCOSIM_REC_VERSION;
+        hdr.spi_div = static_cast<uint32_t>(spi_div);
+        fwrite(&hdr, sizeof(hdr), 1, record_fp);
+        logonly_printf("Recording co-simulation bus to \"%s\"\n", file_name);
     }
 
-    void process(Vxosera_main * top)
+    // -replay recorded host words (instead of shared memory), returns recorded -spi_div (or 0)
+    int init_replay(const char * file_name, uint64_t gap, bool _lenient)
     {
-        char tempstr[256];
-        // bus test
-        if (enable && main_time >= BUS_START_TIME)
+        FILE * fp = fopen(file_name, "rb");
+        if (fp == nullptr)
         {
-            if (wait_vsync)
+            fprintf(stderr, "Reading bus recording \"%s\" error ", file_name);
+            perror("fopen failed");
+            exit(EXIT_FAILURE);
+        }
+        xcosim_rec_header_t hdr;
+        if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || hdr.magic != XCOSIM_REC_MAGIC ||
+            hdr.version != XCOSIM_REC_VERSION)
+        {
+            fprintf(stderr, "\"%s\" is not a version %d Xosera bus recording\n", file_name, XCOSIM_REC_VERSION);
+            exit(EXIT_FAILURE);
+        }
+        xcosim_rec_t rec;
+        while (fread(&rec, sizeof(rec), 1, fp) == 1)
+        {
+            if (rec.type == XCOSIM_REC_WORDS)
             {
-                if (vsync_detect)
+                replay_batch_t b;
+                b.time  = rec.time;
+                b.first = replay_words.size();
+                b.count = rec.value;
+                replay_words.resize(b.first + b.count);
+                if (fread(&replay_words[b.first], sizeof(uint16_t), b.count, fp) != b.count)
                 {
-                    logonly_printf("[@t=%8lu  ... VSYNC arrives]\n", main_time);
-                    wait_vsync   = false;
-                    vsync_detect = false;
+                    break;
                 }
-                return;
+                replay_batches.push_back(b);
+            }
+            else if (rec.type == XCOSIM_REC_READ)
+            {
+                replay_reads.push_back(static_cast<uint8_t>(rec.value));
             }
+        }
+        if (!feof(fp))
+        {
+            fprintf(stderr, "Bus recording \"%s\" truncated or corrupt\n", file_name);
+            exit(EXIT_FAILURE);
+        }
+        fclose(fp);
+        replay_name = file_name;
+        replay_gap  = gap;
+        lenient     = _lenient;
+        log_printf("Replaying bus recording \"%s\" (%lu batches, %lu %s words, %lu reads",
+                   file_name,
+                   replay_batches.size(),
+                   replay_words.size(),
+                   hdr.spi_div ? "SPI" : "bus",
+                   replay_reads.size());
+        if (gap != 0)
+        {
+            log_printf(", idle gaps over %lu pixel clocks shortened", gap);
+        }
+        log_printf(")\n");
+        return static_cast<int>(hdr.spi_div);
+    }
 
-            if (wait_vtop)
+    // copy up to max queued request words (all the host has queued, as one batch), returns count
+    size_t fetch(uint16_t * words, size_t max)
+    {
+        if (replay_name != nullptr)
+        {
+            return replay_fetch(words, max);
+        }
+        __atomic_store_n(&shm->sim_time, main_time, __ATOMIC_RELAXED);
+        uint32_t tail = __atomic_load_n(&shm->req_tail, __ATOMIC_RELAXED);
+        uint32_t head = __atomic_load_n(&shm->req_head, __ATOMIC_ACQUIRE);
+        size_t   n    = std::min(static_cast<size_t>(head - tail), max);
+        for (size_t i = 0; i < n; i++)
+        {
+            words[i] = shm->req[(tail + i) & RING_MASK];
+        }
+        __atomic_store_n(&shm->req_tail, tail + static_cast<uint32_t>(n), __ATOMIC_RELEASE);
+        if (n)
+        {
+            num_words += n;
+            num_batches++;
+            if (record_fp != nullptr)
             {
-                if (vtop_detect)
-                {
-                    logonly_printf("[@t=%8lu  ... VSYNC end arrives]\n", main_time);
-                    wait_vtop   = false;
-                    vtop_detect = false;
-                }
-                return;
+                record(XCOSIM_REC_WORDS, static_cast<uint16_t>(n), words);
             }
+        }
+        return n;
+    }
 
-            if (wait_hsync)
+    // return read byte to host (waits if host has not read earlier responses)
+    void respond(uint8_t byte)
+    {
+        if (replay_name != nullptr)
+        {
+            replay_respond(byte);
+            return;
+        }
+        if (record_fp != nullptr)
+        {
+            record(XCOSIM_REC_READ, byte);
+        }
+        uint32_t head = __atomic_load_n(&shm->rsp_head, __ATOMIC_RELAXED);
+        while (head - __atomic_load_n(&shm->rsp_tail, __ATOMIC_ACQUIRE) >= XCOSIM_RING_WORDS)
+        {
+            if (done)        // ctrl-c
             {
-                if (hsync_detect)
-                {
-                    logonly_printf("[@t=%8lu  ... HSYNC arrives]\n", main_time);
-                    wait_hsync = false;
-                }
                 return;
             }
+            std::this_thread::yield();
+        }
+        shm->rsp[head & RING_MASK] = byte;
+        __atomic_store_n(&shm->rsp_head, head + 1, __ATOMIC_RELEASE);
+        num_reads++;
+    }
 
-            int64_t bus_time = (main_time - BUS_START_TIME) / BUS_CLOCK_DIV;
-
-            if (bus_time >= last_time)
+    // forward bus_intr_o (each pixel clock)
+    inline void cycle(Vxosera_main * top)
+    {
+        bool intr = top->bus_intr_o;
+        if (intr != last_intr && shm != nullptr)
+        {
+            __atomic_store_n(&shm->intr, intr, __ATOMIC_RELEASE);
+            if (intr)
             {
-                last_time = bus_time + 1;
+                __atomic_fetch_add(&shm->intr_count, 1, __ATOMIC_RELEASE);
+            }
+            last_intr = intr;
+        }
+    }
 
-                // logonly_printf("%5d >= %5d [@bt=%lu] INDEX=%9d 0x%04x%s\n",
-                //                bus_time,
-                //                last_time,
-                //                main_time,
-                //                index,
-                //                test_data[index],
-                //                data_upload ? " UPLOAD" : "");
+    // returns false if -replay read bytes did not match recording (without -replay_lenient)
+    bool finish()
+    {
+        if (replay_name != nullptr)
+        {
+            log_printf("Bus replay: %lu words in %lu batches, %lu of %lu reads, %lu read mismatches, %lu idle pixel "
+                       "clocks removed\n",
+                       num_words,
+                       num_batches,
+                       num_reads,
+                       replay_reads.size(),
+                       mismatches,
+                       time_offset);
+            replay_name = nullptr;
+            return mismatches == 0 || lenient;
+        }
+        if (shm == nullptr)
+        {
+            return true;
+        }
+        if (record_fp != nullptr)
+        {
+            fclose(record_fp);
+            record_fp = nullptr;
+        }
+        __atomic_store_n(&shm->sim_time, main_time, __ATOMIC_RELAXED);
+        __atomic_store_n(&shm->sim_state, XCOSIM_ENDED, __ATOMIC_RELEASE);
+        log_printf("Co-simulation bus: %lu words in %lu batches (%.1f words/batch), %lu read bytes returned\n",
+                   num_words,
+                   num_batches,
+                   num_batches ? static_cast<double>(num_words) / num_batches : 0.0,
+                   num_reads);
+        munmap(shm, sizeof(xcosim_t));
+        shm_unlink(name);
+        shm = nullptr;
+        return true;
+    }
+};
 
-                // REG_END
-                if (!data_upload && test_data[index] == 0xffff)
+CoSimBridge * cosim;        // non-null if -cosim or -replay (bus test_data words come from host process or recording)
+
+// SPI co-simulation (-spi option, with -cosim, needs SPI=1 build)
+//
+// Host XCOSIM_SPI_CS/XCOSIM_SPI_BYTE words (from xvid_spi or host_spi built with SPI_TRANSPORT=sim) are clocked out
+// as SPI mode 0 signals at -spi_div pixel clocks per bit into the sim/xosera_spi_sim.sv SPI pins (spi_target.sv and
+// the xosera_iceb.sv SPI_INTERFACE command bridge, which drives the xosera_main bus inputs).  CIPO bytes are returned
+// to the host and SPI throughput is reported.
+class SpiTarget
+{
+    enum
+    {
+        SPI_IDLE,
+        SPI_CS,          // CS change (one bit time of setup/hold)
+        SPI_BYTE,        // shifting byte
+    };
+
+    std::vector<uint16_t> ops;        // host words
+    size_t                op_index;
+    int                   bit_div;          // pixel clocks per SPI bit
+    uint32_t              gap_us;           // modeled host turnaround per transaction (for report)
+    int                   state;
+    int                   clocks;           // clocks into current bit (or CS change)
+    int                   bit;
+    uint8_t               tx;
+    uint8_t               rx;
+
+    // initiator (host) outputs
+    bool sck;
+    bool copi;
+    bool cs_n;
+
+    uint64_t num_bytes;
+    uint64_t num_transactions;
+    uint64_t busy_clocks;        // clocks with SPI bytes or CS changes in progress (not waiting for host)
+
+    // host side SPI initiator (mode 0, MSB first, CIPO sampled on rising SCK)
+    void initiator(bool cipo)
+    {
+        if (state == SPI_IDLE)
+        {
+            if (op_index >= ops.size())
+            {
+                ops.resize(4096);
+                ops.resize(cosim->fetch(ops.data(), ops.size()));
+                op_index = 0;
+                if (ops.empty())
                 {
-                    logonly_printf("[@t=%8lu] REG_END hit\n", main_time);
-                    done      = true;
-                    enable    = false;
-                    last_time = bus_time - 1;
-                    logonly_printf("%5d >= new last_time = %5d\n", bus_time, last_time);
                     return;
                 }
-                // REG_WAITVSYNC
-                if (!data_upload && test_data[index] == 0xfffe)
+            }
+            uint16_t op = ops[op_index++];
+            clocks      = 0;
+            if ((op & 0xff00) == XCOSIM_SPI_CS)
+            {
+                cs_n = op & 1;
+                num_transactions += !cs_n;
+                state = SPI_CS;
+            }
+            else if ((op & 0xff00) == XCOSIM_SPI_BYTE)
+            {
+                tx    = op & 0xff;
+                rx    = 0;
+                bit   = 0;
+                state = SPI_BYTE;
+            }
+            else if (op == 0xffff)        // REG_END (from host_spi_close)
+            {
+                logonly_printf("[@t=%8lu] REG_END hit\n", main_time);
+                done = true;
+                return;
+            }
+            else
+            {
+                logonly_printf("[@t=%8lu] -spi ignored non-SPI host word 0x%04x\n", main_time, op);
+                return;
+            }
+        }
+
+        busy_clocks++;
+        if (state == SPI_CS)
+        {
+            if (++clocks >= bit_div)
+            {
+                state = SPI_IDLE;
+            }
+            return;
+        }
+
+        copi = (tx >> (7 - bit)) & 1;
+        if (clocks == bit_div / 2)
+        {
+            sck = true;
+            rx  = (rx << 1) | cipo;
+        }
+        if (++clocks >= bit_div)
+        {
+            sck    = false;
+            clocks = 0;
+            if (++bit == 8)
+            {
+                cosim->respond(rx);
+                num_bytes++;
+                state = SPI_IDLE;
+            }
+        }
+    }
+
+public:
+    SpiTarget()
+        : op_index(0)
+        , bit_div(4)
+        , gap_us(0)
+        , state(SPI_IDLE)
+        , clocks(0)
+        , bit(0)
+        , tx(0)
+        , rx(0)
+        , sck(false)
+        , copi(false)
+        , cs_n(true)
+        , num_bytes(0)
+        , num_transactions(0)
+        , busy_clocks(0)
+    {
+    }
+
+    void init(int div, uint32_t gap)
+    {
+        if (div < 4)
+        {
+            printf("-spi_div %d too fast (spi_target needs >= 4 pixel clocks per SPI bit)\n", div);
+            exit(EXIT_FAILURE);
+        }
+        bit_div = div;
+        gap_us  = gap;
+        log_printf("SPI co-simulation: %d pixel clocks per SPI bit (%.03f MHz SCK)\n", div, PIXEL_CLOCK_MHZ / div);
+    }
+
+    // drive SPI pins (before rising edge eval)
+    void cycle(Vxosera_main * top)
+    {
+#if SIM_SPI
+        initiator(top->spi_cipo_o);
+
+        top->spi_sel_i  = 1;
+        top->spi_sck_i  = sck;
+        top->spi_copi_i = copi;
+        top->spi_cs_n_i = cs_n;
+#endif
+    }
+
+    void finish()
+    {
+        double busy_secs = busy_clocks / (PIXEL_CLOCK_MHZ * 1000000.0);
+        double gap_secs  = busy_secs + num_transactions * (gap_us / 1000000.0);
+        log_printf("SPI throughput: %lu bytes in %lu transactions (%.1f bytes/transaction), %.0f bytes/sec clocking at "
+                   "%.03f MHz, %.0f bytes/sec with %u usec host gap per transaction\n",
+                   num_bytes,
+                   num_transactions,
+                   num_transactions ? static_cast<double>(num_bytes) / num_transactions : 0.0,
+                   busy_secs > 0.0 ? num_bytes / busy_secs : 0.0,
+                   PIXEL_CLOCK_MHZ / bit_div,
+                   gap_secs > 0.0 ? num_bytes / gap_secs : 0.0,
+                   gap_us);
+    }
+};
+
+SpiTarget * spi;        // non-null if -spi (-cosim host words drive SPI target)
+
+class BusInterface
+{
+    const int   BUS_START_TIME = 1000000;        // after init
+    const float BUS_CLOCK_DIV  = 5;              // min 5
+    const float FAST_CLOCK_DIV = 2;              // -fastbus: one pixel clock per bus state
+    const int   FAST_READ_TIME = 10;             // -fastbus: min half-clocks from BUS_START to read data
+
+    static const char * reg_name[];
+    enum
+    {
+        BUS_START,
+        BUS_HOLD,
+        BUS_STROBEOFF,
+        BUS_END
+    };
+
+    bool    enable;
+    int64_t last_time;
+    int     state;
+    int     index;
+    bool    wait_vsync;
+    bool    wait_hsync;
+    bool    wait_vtop;
+    bool    wait_blit;
+    bool    data_upload;
+    int     data_upload_mode;
+    int     data_upload_num;
+    int     data_upload_count;
+    int     data_upload_index;
+    int     write_reg;        // register written since last get_write_reg() (or -1)
+
+    float           bus_clock_div;            // half-clocks per bus state
+    bool            fast_bus;                 // -fastbus back-to-back strobes (timing-relaxed)
+    bool            backdoor;                 // -backdoor uploads written directly to VRAM/XR memory
+    int64_t         start_time;               // main_time of last BUS_START
+    uint16_t        shadow_reg[16];           // word last written to each register (WR_ADDR etc. also incremented)
+    const uint8_t * backdoor_xr_data;         // -backdoor XR upload in progress (one word per clock)
+    int             backdoor_xr_words;
+    bool            backdoor_tail;            // data_upload is -backdoor bus writes after copy (backdoor_tail_data)
+    uint8_t         backdoor_tail_data[3];    // next address word, odd last byte
+
+    std::vector<uint16_t> cosim_data;        // -cosim words from host (first word is last word of previous batch)
+
+    static size_t                test_data_len;
+    static const uint16_t *      test_data;                  // current test data (built-in, -script or command line)
+    static uint16_t              builtin_test_data[];        // compiled in test data
+    static std::vector<uint16_t> cmdline_test_data;
+
+public:
+public:
+    void set_cmdline_data(int argc, char ** argv, int & nextarg)
+    {
+        for (int i = nextarg; i < argc; i++)
+        {
+            char * endptr = nullptr;
+            int    value  = static_cast<int>(strtoul(argv[i], &endptr, 0) & 0x1fffUL);
+            if (endptr != nullptr && *endptr == '\0')
+            {
+                cmdline_test_data.push_back(value);
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        if (cmdline_test_data.size() != 0)
+        {
+            set_test_data(cmdline_test_data.data(), cmdline_test_data.size());
+        }
+    }
+
+    void set_test_data(const uint16_t * data, size_t len)
+    {
+        test_data     = data;
+        test_data_len = len;
+    }
+
+    int get_index() const
+    {
+        return index;
+    }
+
+    // -fastbus and -backdoor (call after init)
+    void set_fast(bool _fast_bus, bool _backdoor)
+    {
+        fast_bus      = _fast_bus;
+        backdoor      = _backdoor;
+        bus_clock_div = fast_bus ? FAST_CLOCK_DIV : BUS_CLOCK_DIV;
+    }
+
+    bool timing_relaxed() const
+    {
+        return fast_bus || backdoor;
+    }
+
+    // return register number written (strobe off) since last call, or -1
+    int get_write_reg()
+    {
+        int r     = write_reg;
+        write_reg = -1;
+        return r;
+    }
+
+    static int find_reg(const char * name)
+    {
+        size_t len = strlen(name);
+        for (int r = 0; r < 16; r++)        // 4-bit register number
+        {
+            // reg_name is space padded, match with or without "XM_" prefix
+            const char * rn = reg_name[r];
+            if ((strncmp(rn, name, len) == 0 && (rn[len] == ' ' || rn[len] == '\0')) ||
+                (strncmp(rn + 3, name, len) == 0 && (rn[len + 3] == ' ' || rn[len + 3] == '\0')))
+            {
+                return r;
+            }
+        }
+        return -1;
+    }
+
+#if SIM_SAVABLE
+    void save(VerilatedSerialize & os)
+    {
+        os.write(&enable, sizeof(enable));
+        os.write(&last_time, sizeof(last_time));
+        os.write(&state, sizeof(state));
+        os.write(&index, sizeof(index));
+        os.write(&wait_vsync, sizeof(wait_vsync));
+        os.write(&wait_hsync, sizeof(wait_hsync));
+        os.write(&wait_vtop, sizeof(wait_vtop));
+        os.write(&wait_blit, sizeof(wait_blit));
+        os.write(&data_upload, sizeof(data_upload));
+        os.write(&data_upload_mode, sizeof(data_upload_mode));
+        os.write(&data_upload_num, sizeof(data_upload_num));
+        os.write(&data_upload_count, sizeof(data_upload_count));
+        os.write(&data_upload_index, sizeof(data_upload_index));
+        os.write(shadow_reg, sizeof(shadow_reg));
+        os.write(&fast_bus, sizeof(fast_bus));
+        os.write(&backdoor, sizeof(backdoor));
+        os.write(&start_time, sizeof(start_time));
+        // XR upload position as offset into upload payload (data_upload_num already counts it)
+        int64_t xr_offset = backdoor_xr_data != nullptr ? backdoor_xr_data - uploads[data_upload_num - 1].payload : -1;
+        os.write(&xr_offset, sizeof(xr_offset));
+        os.write(&backdoor_xr_words, sizeof(backdoor_xr_words));
+        os.write(&backdoor_tail, sizeof(backdoor_tail));
+        os.write(backdoor_tail_data, sizeof(backdoor_tail_data));
+    }
+
+    void restore(VerilatedDeserialize & is)
+    {
+        is.read(&enable, sizeof(enable));
+        is.read(&last_time, sizeof(last_time));
+        is.read(&state, sizeof(state));
+        is.read(&index, sizeof(index));
+        is.read(&wait_vsync, sizeof(wait_vsync));
+        is.read(&wait_hsync, sizeof(wait_hsync));
+        is.read(&wait_vtop, sizeof(wait_vtop));
+        is.read(&wait_blit, sizeof(wait_blit));
+        is.read(&data_upload, sizeof(data_upload));
+        is.read(&data_upload_mode, sizeof(data_upload_mode));
+        is.read(&data_upload_num, sizeof(data_upload_num));
+        is.read(&data_upload_count, sizeof(data_upload_count));
+        is.read(&data_upload_index, sizeof(data_upload_index));
+        is.read(shadow_reg, sizeof(shadow_reg));
+        bool saved_fast_bus;
+        bool saved_backdoor;
+        is.read(&saved_fast_bus, sizeof(saved_fast_bus));
+        is.read(&saved_backdoor, sizeof(saved_backdoor));
+        if (saved_fast_bus != fast_bus || saved_backdoor != backdoor)
+        {
+            fprintf(stderr,
+                    "Snapshot was saved with%s -fastbus and with%s -backdoor (options must match to restore)\n",
+                    saved_fast_bus ? "" : "out",
+                    saved_backdoor ? "" : "out");
+            exit(EXIT_FAILURE);
+        }
+        is.read(&start_time, sizeof(start_time));
+        int64_t xr_offset;
+        is.read(&xr_offset, sizeof(xr_offset));
+        is.read(&backdoor_xr_words, sizeof(backdoor_xr_words));
+        is.read(&backdoor_tail, sizeof(backdoor_tail));
+        is.read(backdoor_tail_data, sizeof(backdoor_tail_data));
+        backdoor_xr_data = nullptr;
+        if (xr_offset >= 0)
+        {
+            if (data_upload_num < 1 || data_upload_num > static_cast<int>(uploads.size()) ||
+                xr_offset + backdoor_xr_words * 2 > uploads[data_upload_num - 1].size)
+            {
+                fprintf(stderr, "Snapshot -backdoor XR upload does not match -u uploads\n");
+                exit(EXIT_FAILURE);
+            }
+            backdoor_xr_data = uploads[data_upload_num - 1].payload + xr_offset;
+        }
+    }
+#endif
+
+    void init(Vxosera_main * top, bool _enable)
+    {
+        enable            = _enable;
+        index             = 0;
+        state             = BUS_START;
+        wait_vsync        = false;
+        wait_hsync        = false;
+        wait_vtop         = false;
+        wait_blit         = false;
+        data_upload       = false;
+        data_upload_mode  = 0;
+        data_upload_num   = 0;
+        data_upload_count = 0;
+        data_upload_index = 0;
+        write_reg         = -1;
+        bus_clock_div     = BUS_CLOCK_DIV;
+        fast_bus          = false;
+        backdoor          = false;
+        start_time        = 0;
+        backdoor_xr_data  = nullptr;
+        backdoor_xr_words = 0;
+        backdoor_tail     = false;
+        memset(shadow_reg, 0, sizeof(shadow_reg));
+        if (cosim != nullptr)
+        {
+            cosim_data.resize(4096 + 1);
+            set_test_data(nullptr, 0);
+        }
+        top->bus_cs_n_i = 1;
+#if SIM_PROFILE
+        XOSERA_MAIN(top)->xrmem_arb->sim_xr_wr = 0;
+#endif
+    }
+
+    // update shadow register words for a bus byte write (with XM_DATA/XM_XDATA address increment)
+    void track_write(int reg_num, int bytesel, uint8_t data)
+    {
+        uint16_t & r = shadow_reg[reg_num];
+        r            = bytesel ? ((r & 0xff00) | data) : ((r & 0x00ff) | (data << 8));
+        if (bytesel && (reg_num == XM_DATA || reg_num == XM_DATA_2))
+        {
+            shadow_reg[XM_WR_ADDR] += shadow_reg[XM_WR_INCR];
+        }
+        else if (bytesel && reg_num == XM_XDATA)
+        {
+            shadow_reg[XM_WR_XADDR]++;
+        }
+    }
+
+    // -cosim: make next batch of host words the test_data (keeping previous last word, so REG_WAIT_BLIT_xxx can
+    // re-issue its SYS_CTRL read), returns false if host has not queued any
+    bool cosim_fetch()
+    {
+        uint16_t last = test_data_len ? test_data[test_data_len - 1] : 0;
+        size_t   n    = cosim->fetch(&cosim_data[1], cosim_data.size() - 1);
+        if (n == 0)
+        {
+            return false;
+        }
+        cosim_data[0] = last;
+        set_test_data(cosim_data.data(), n + 1);
+        index = 1;
+        return true;
+    }
+
+    // true while a register interface VRAM or XR access has not been acknowledged (host would see mem_wait)
+    static bool mem_busy(Vxosera_main * top)
+    {
+        return XOSERA_MAIN(top)->vram_arb->regs_sel_i || XOSERA_MAIN(top)->xrmem_arb->xr_sel_i;
+    }
+
+    // queue -backdoor bus writes done after the direct copy: XM_WR_ADDR/XM_WR_XADDR word with the address after the
+    // upload, then an odd last byte as XM_DATA/XM_XDATA msb (leaving registers as a bus upload would)
+    void backdoor_tail_writes(const upload_t & upload, int mode, uint16_t next_addr)
+    {
+        backdoor_tail         = true;
+        backdoor_tail_data[0] = next_addr >> 8;
+        backdoor_tail_data[1] = next_addr & 0xff;
+        backdoor_tail_data[2] = upload.payload[upload.size - 1];
+        data_upload           = true;
+        data_upload_mode      = mode;
+        data_upload_count     = (upload.size & 1) ? 3 : 2;
+        data_upload_index     = 0;
+    }
+
+    // -backdoor upload: write VRAM directly (at shadow XM_WR_ADDR, adding XM_WR_INCR), or start XR memory
+    // writes (at shadow XM_WR_XADDR) via xrmem_arb simulation write port (PROFILE=1 builds only), returns false to
+    // use bus instead
+    bool backdoor_upload(Vxosera_main * top, const upload_t & upload, int mode)
+    {
+        int words = upload.size / 2;
+        if (mode == 0)
+        {
+            auto &   vmem = XOSERA_MAIN(top)->vram_arb->vram->memory;
+            uint16_t addr = shadow_reg[XM_WR_ADDR];
+            uint16_t incr = shadow_reg[XM_WR_INCR];
+            for (int w = 0; w < words; w++)
+            {
+                vmem[addr] = (upload.payload[w * 2] << 8) | upload.payload[w * 2 + 1];
+                addr += incr;
+            }
+            logonly_printf("[Upload #%d backdoor, %d bytes to VRAM 0x%04x, incr 0x%04x]\n",
+                           data_upload_num + 1,
+                           upload.size,
+                           shadow_reg[XM_WR_ADDR],
+                           incr);
+            shadow_reg[XM_WR_ADDR] = addr;
+            backdoor_tail_writes(upload, mode, addr);
+            return true;
+        }
+
+#if SIM_PROFILE
+        if ((shadow_reg[XM_WR_XADDR] & 0xC000) == 0x0000)        // XR registers need bus writes
+        {
+            return false;
+        }
+        logonly_printf("[Upload #%d backdoor, %d bytes to XR 0x%04x]\n",
+                       data_upload_num + 1,
+                       upload.size,
+                       shadow_reg[XM_WR_XADDR]);
+        backdoor_xr_data  = upload.payload;
+        backdoor_xr_words = words;
+        backdoor_tail_writes(upload, mode, shadow_reg[XM_WR_XADDR] + words);
+        return true;
+#else
+        return false;        // no xrmem_arb simulation write port
+#endif
+    }
+
+    // write next -backdoor XR upload word (one per clock), returns false when done
+    bool backdoor_xr_cycle(Vxosera_main * top)
+    {
+#if SIM_PROFILE
+        auto xr = XOSERA_MAIN(top)->xrmem_arb;
+        if (backdoor_xr_words == 0)
+        {
+            xr->sim_xr_wr = 0;
+            return false;
+        }
+        xr->sim_xr_wr   = 1;
+        xr->sim_xr_addr = shadow_reg[XM_WR_XADDR]++;
+        xr->sim_xr_data = (backdoor_xr_data[0] << 8) | backdoor_xr_data[1];
+        backdoor_xr_data += 2;
+        backdoor_xr_words--;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void process(Vxosera_main * top)
+    {
+        char tempstr[256];
+        // bus test
+        if (enable && main_time >= BUS_START_TIME)
+        {
+            if (backdoor_xr_data != nullptr)
+            {
+                if (!backdoor_xr_cycle(top))
                 {
-                    logonly_printf("[@t=%8lu] Wait VSYNC...\n", main_time);
-                    wait_vsync = true;
-                    index++;
-                    return;
+                    backdoor_xr_data = nullptr;
                 }
-                // REG_WAITVTOP
-                if (!data_upload && test_data[index] == 0xfffd)
+                return;
+            }
+
+            if (wait_vsync)
+            {
+                if (vsync_detect)
                 {
-                    logonly_printf("[@t=%8lu] Wait VTOP (VSYNC end)...\n", main_time);
-                    //                    logonly_printf("[@t=%8lu] belayed!\n", main_time);
-                    wait_vtop   = true;
-                    vtop_detect = false;
-                    index++;
-                    return;
+                    logonly_printf("[@t=%8lu  ... VSYNC arrives]\n", main_time);
+                    wait_vsync   = false;
+                    vsync_detect = false;
                 }
-                // REG_WAIT_BLIT_READY
-                if (!data_upload && test_data[index] == 0xfffc)
+                return;
+            }
+
+            if (wait_vtop)
+            {
+                if (vtop_detect)
                 {
-                    last_time = bus_time - 1;
-                    if (!(last_read_val & (0x0100 << SYS_CTRL_BLIT_FULL_B)))        // blit_full bit
-                    {
-                        logonly_printf("[@t=%8lu] blit_full clear (SYS_CTRL.L=0x%02x)\n", main_time, last_read_val);
-                        index++;
-                        last_read_val = 0;
-                        wait_blit     = false;
-                        return;
-                    }
-                    else if (!wait_blit)
-                    {
-                        logonly_printf("[@t=%8lu] Waiting until SYS_CTRL.L blit_full is clear...\n", main_time);
-                    }
-                    wait_blit = true;
-                    index--;
-                    return;
+                    logonly_printf("[@t=%8lu  ... VSYNC end arrives]\n", main_time);
+                    wait_vtop   = false;
+                    vtop_detect = false;
                 }
-                // REG_WAIT_BLIT_DONE
-                if (!data_upload && test_data[index] == 0xfffb)
+                return;
+            }
+
+            if (wait_hsync)
+            {
+                if (hsync_detect)
                 {
-                    last_time = bus_time - 1;
+                    logonly_printf("[@t=%8lu  ... HSYNC arrives]\n", main_time);
+                    wait_hsync = false;
+                }
+                return;
+            }
+
+            int64_t bus_time = (main_time - BUS_START_TIME) / bus_clock_div;
+
+            if (bus_time >= last_time)
+            {
+                last_time = bus_time + 1;
+
+                // -fastbus waits for register interface memory access (like host checking mem_wait)
+                if (fast_bus && state == BUS_START && mem_busy(top))
+                {
+                    return;
+                }
+
+                // -cosim bus idles until host queues more words
+                if (cosim != nullptr && !data_upload && state == BUS_START && index >= test_data_len &&
+                    !cosim_fetch())
+                {
+                    return;
+                }
+
+                // logonly_printf("%5d >= %5d [@bt=%lu] INDEX=%9d 0x%04x%s\n",
+                //                bus_time,
+                //                last_time,
+                //                main_time,
+                //                index,
+                //                test_data[index],
+                //                data_upload ? " UPLOAD" : "");
+
+                // REG_END
+                if (!data_upload && test_data[index] == 0xffff)
+                {
+                    logonly_printf("[@t=%8lu] REG_END hit\n", main_time);
+                    done      = true;
+                    enable    = false;
+                    last_time = bus_time - 1;
+                    logonly_printf("%5d >= new last_time = %5d\n", bus_time, last_time);
+                    return;
+                }
+                // REG_WAITVSYNC
+                if (!data_upload && test_data[index] == 0xfffe)
+                {
+                    logonly_printf("[@t=%8lu] Wait VSYNC...\n", main_time);
+                    wait_vsync = true;
+                    index++;
+                    return;
+                }
+                // REG_WAITVTOP
+                if (!data_upload && test_data[index] == 0xfffd)
+                {
+                    logonly_printf("[@t=%8lu] Wait VTOP (VSYNC end)...\n", main_time);
+                    //                    logonly_printf("[@t=%8lu] belayed!\n", main_time);
+                    wait_vtop   = true;
+                    vtop_detect = false;
+                    index++;
+                    return;
+                }
+                // REG_WAIT_BLIT_READY
+                if (!data_upload && test_data[index] == 0xfffc)
+                {
+                    last_time = bus_time - 1;
+                    if (!(last_read_val & (0x0100 << SYS_CTRL_BLIT_FULL_B)))        // blit_full bit
+                    {
+                        logonly_printf("[@t=%8lu] blit_full clear (SYS_CTRL.L=0x%02x)\n", main_time, last_read_val);
+                        index++;
+                        last_read_val = 0;
+                        wait_blit     = false;
+                        return;
+                    }
+                    else if (!wait_blit)
+                    {
+                        logonly_printf("[@t=%8lu] Waiting until SYS_CTRL.L blit_full is clear...\n", main_time);
+                    }
+                    wait_blit = true;
+                    index--;
+                    return;
+                }
+                // REG_WAIT_BLIT_DONE
+                if (!data_upload && test_data[index] == 0xfffb)
+                {
+                    last_time = bus_time - 1;
                     if (!(last_read_val & (0x0100 << SYS_CTRL_BLIT_BUSY_B)))        // blit_busy bit
                     {
                         logonly_printf("[@t=%8lu] blit_busy clear (SYS_CTRL.L=0x%02x)\n", main_time, last_read_val);
@@ -279,6 +1354,13 @@ public:
                     index--;
                     return;
                 }
+                // REG_SNAPSHOT
+                if (!data_upload && test_data[index] == 0xfff9)
+                {
+                    memsnap_why = "REG_SNAPSHOT";
+                    index++;
+                    return;
+                }
                 // REG_WAITHSYNC
                 if (!data_upload && test_data[index] == 0xfffa)
                 {
@@ -288,799 +1370,1215 @@ public:
                     return;
                 }
 
-                if (!data_upload && (test_data[index] & 0xfffe) == 0xfff0)
-                {
-                    data_upload       = upload_size[data_upload_num] > 0;
-                    data_upload_mode  = test_data[index] & 0x1;
-                    data_upload_count = upload_size[data_upload_num];        // byte count
-                    data_upload_index = 0;
-                    logonly_printf("[Upload #%d started, %d bytes, mode %s]\n",
-                                   data_upload_num + 1,
-                                   data_upload_count,
-                                   data_upload_mode ? "XR_DATA" : "VRAM_DATA");
+                if (!data_upload && (test_data[index] & 0xfffe) == 0xfff0)
+                {
+                    bool have_upload  = data_upload_num < static_cast<int>(uploads.size());
+                    int  upload_size  = have_upload ? uploads[data_upload_num].size : 0;
+                    if (backdoor && upload_size > 1 &&
+                        backdoor_upload(top, uploads[data_upload_num], test_data[index] & 0x1))
+                    {
+                        data_upload_num++;
+                        index++;
+                        return;
+                    }
+                    data_upload       = upload_size > 0;
+                    data_upload_mode  = test_data[index] & 0x1;
+                    data_upload_count = upload_size;        // byte count
+                    data_upload_index = 0;
+                    logonly_printf("[Upload #%d started, %d bytes, mode %s]\n",
+                                   data_upload_num + 1,
+                                   data_upload_count,
+                                   data_upload_mode ? "XR_DATA" : "VRAM_DATA");
+
+                    index++;
+                }
+                int rd_wr   = (test_data[index] & 0xC000) == 0x8000 ? 1 : 0;
+                int bytesel = (test_data[index] & 0x1000) ? 1 : 0;
+                int reg_num = (test_data[index] >> 8) & 0xf;
+                int data    = test_data[index] & 0xff;
+
+                if (data_upload && backdoor_tail && state == BUS_START)
+                {
+                    bool addr_byte = data_upload_index < 2;
+                    rd_wr          = 0;
+                    bytesel        = data_upload_index & 1;
+                    reg_num        = data_upload_mode ? (addr_byte ? XM_WR_XADDR : XM_XDATA)
+                                                      : (addr_byte ? XM_WR_ADDR : XM_DATA);
+                    data           = backdoor_tail_data[data_upload_index++];
+                }
+                else if (data_upload && state == BUS_START)
+                {
+                    bytesel = data_upload_index & 1;
+                    reg_num = data_upload_mode ? XM_XDATA : XM_DATA;
+                    data    = uploads[data_upload_num].payload[data_upload_index++];
+                }
+
+                switch (state)
+                {
+                    case BUS_START:
+                        start_time         = main_time;
+                        top->bus_cs_n_i    = 1;
+                        top->bus_bytesel_i = bytesel;
+                        top->bus_rd_nwr_i  = rd_wr;
+                        top->bus_reg_num_i = reg_num;
+                        top->bus_data_i    = data;
+                        if (data_upload && data_upload_index < 16)
+                        {
+                            logonly_printf("[@t=%8lu] ", main_time);
+                            snprintf(tempstr,
+                                     sizeof(tempstr),
+                                     "r[0x%x] %s.%3s",
+                                     reg_num,
+                                     reg_name[reg_num],
+                                     bytesel ? "lsb*" : "msb");
+                            logonly_printf("  %-25.25s <= %s%02x%s\n",
+                                           tempstr,
+                                           bytesel ? "__" : "",
+                                           data & 0xff,
+                                           bytesel ? "" : "__");
+                            if (data_upload_index == 15)
+                            {
+                                logonly_printf("  ...\n");
+                            }
+                        }
+                        break;
+                    case BUS_HOLD:
+                        // -fastbus holds reads until read data is valid (register number synchronized)
+                        if (fast_bus && rd_wr && main_time - start_time < FAST_READ_TIME - 2)
+                        {
+                            return;
+                        }
+                        break;
+                    case BUS_STROBEOFF:
+                        if (rd_wr)
+                        {
+                            if (!wait_blit && cosim != nullptr)
+                            {
+                                cosim->respond(top->bus_data_o);
+                            }
+                            if (!wait_blit && evlog != nullptr)
+                            {
+                                evlog->put(EV_REG_RD, main_time, reg_num | (bytesel << 4), 0, top->bus_data_o);
+                            }
+                            else if (!wait_blit)
+                            {
+                                logonly_printf("[@t=%8lu] Read  Reg %s (#%02x.%s) => %s%02x%s\n",
+                                               main_time,
+                                               reg_name[reg_num],
+                                               reg_num,
+                                               bytesel ? "L" : "H",
+                                               bytesel ? "__" : "",
+                                               top->bus_data_o,
+                                               bytesel ? "" : "__");
+                            }
+                            if (bytesel)
+                            {
+                                last_read_val = (last_read_val & 0xff00) | top->bus_data_o;
+                            }
+                            else
+                            {
+                                last_read_val = (last_read_val & 0x00ff) | (top->bus_data_o << 8);
+                            }
+                        }
+                        else
+                        {
+                            track_write(top->bus_reg_num_i, top->bus_bytesel_i, top->bus_data_i);
+                            write_reg = reg_num;
+                            if (!data_upload && evlog != nullptr)
+                            {
+                                evlog->put(EV_REG_WR, main_time, reg_num | (bytesel << 4), 0, top->bus_data_i);
+                            }
+                            else if (!data_upload)
+                            {
+                                logonly_printf("[@t=%8lu] Write Reg %s (#%02x.%s) <= %s%02x%s\n",
+                                               main_time,
+                                               reg_name[reg_num],
+                                               reg_num,
+                                               bytesel ? "L" : "H",
+                                               bytesel ? "__" : "",
+                                               top->bus_data_i,
+                                               bytesel ? "" : "__");
+                            }
+                        }
+                        top->bus_cs_n_i = 0;
+                        break;
+                    case BUS_END:
+                        top->bus_cs_n_i = 0;
+                        if (!fast_bus)        // -fastbus keeps signals until next BUS_START (held for synchronizers)
+                        {
+                            top->bus_bytesel_i = 0;
+                            top->bus_rd_nwr_i  = 0;
+                            top->bus_reg_num_i = 0;
+                            top->bus_data_i    = 0;
+                        }
+                        //                        last_time          = bus_time + 9;
+                        if (data_upload && backdoor_tail)
+                        {
+                            if (data_upload_index >= data_upload_count)
+                            {
+                                data_upload   = false;
+                                backdoor_tail = false;
+                                logonly_printf("[Upload #%d completed]\n", data_upload_num);
+                            }
+                        }
+                        else if (data_upload)
+                        {
+                            if (data_upload_index >= data_upload_count)
+                            {
+                                data_upload = false;
+                                logonly_printf("[Upload #%d completed]\n", data_upload_num + 1);
+                                data_upload_num++;
+                            }
+                        }
+                        else if (++index >= test_data_len && cosim == nullptr)
+                        {
+                            logonly_printf("*** END of test_data_len ***\n");
+                            enable = false;
+                        }
+                        break;
+                    default:
+                        assert(false);
+                }
+                state = state + 1;
+                if (state > BUS_END)
+                {
+                    state = BUS_START;
+                }
+            }
+            else
+            {
+                //                logonly_printf("%5d < %5d INDEX=%9d\n", bus_time, last_time, index);
+            }
+        }
+    }
+};
+
+const char * BusInterface::reg_name[] = {"XM_SYS_CTRL ",
+                                         "XM_INT_CTRL ",
+                                         "XM_TIMER    ",
+                                         "XM_RD_XADDR ",
+                                         "XM_WR_XADDR ",
+                                         "XM_XDATA    ",
+                                         "XM_RD_INCR  ",
+                                         "XM_RD_ADDR  ",
+                                         "XM_WR_INCR  ",
+                                         "XM_WR_ADDR  ",
+                                         "XM_DATA     ",
+                                         "XM_DATA_2   ",
+                                         "XM_PIXEL_X  ",
+                                         "XM_PIXEL_Y  ",
+                                         "XM_UART",
+                                         "XM_FEATURE  "};
+
+#define REG_BH(r, v)     (((XM_##r) | 0x00) << 8) | ((v) & 0xff)
+#define REG_BL(r, v)     (((XM_##r) | 0x10) << 8) | ((v) & 0xff)
+#define REG_W(r, v)      ((XM_##r) << 8) | (((v) >> 8) & 0xff), (((XM_##r) | 0x10) << 8) | ((v) & 0xff)
+#define REG_RW(r)        (((XM_##r) | 0x80) << 8), (((XM_##r) | 0x90) << 8)
+#define XREG_SETW(xr, v) REG_W(WR_XADDR, XR_##xr), REG_W(XDATA, (v))
+#define XREG_GETW(xr)    REG_W(RD_XADDR, (XR_##xr) | XRMEM_READ), REG_RW(XDATA)
+
+#define XMEM_SETW(xrmem, v) REG_W(WR_XADDR, xrmem), REG_W(XDATA, (v))
+
+#define REG_UPLOAD()          0xfff0
+#define REG_UPLOAD_AUX()      0xfff1
+#define REG_SNAPSHOT()        0xfff9
+#define REG_WAITHSYNC()       0xfffa
+#define REG_WAIT_BLIT_READY() (((XM_SYS_CTRL) | 0x80) << 8), 0xfffc
+#define REG_WAIT_BLIT_DONE()  (((XM_SYS_CTRL) | 0x80) << 8), 0xfffb
+#define REG_WAITVTOP()        0xfffd
+#define REG_WAITVSYNC()       0xfffe
+#define REG_END()             0xffff
+
+#define X_COLS 80
+#define W_4BPP (320 / 4)
+#define H_4BPP (240)
+
+#define W_LOGO (32 / 4)
+#define H_LOGO (16)
+
+BusInterface bus;
+uint16_t     BusInterface::builtin_test_data[] = {
+    // test data
+
+    REG_WAITHSYNC(),
+    REG_WAITVTOP(),
+    REG_WAIT_BLIT_DONE(),
+    // initialize non-zero Xosera registers
+    XREG_SETW(VID_CTRL, 0x0008),
+    XREG_SETW(VID_LEFT, 0),
+    XREG_SETW(VID_RIGHT, VISIBLE_WIDTH),
+
+    XREG_SETW(PA_GFX_CTRL, 0x0080),
+    XREG_SETW(PA_TILE_CTRL, 0x000F),
+    XREG_SETW(PA_LINE_LEN, VISIBLE_WIDTH / 8),
+    XREG_SETW(PB_GFX_CTRL, 0x0080),
+    XREG_SETW(PB_TILE_CTRL, 0x000F),
+    XREG_SETW(PB_LINE_LEN, VISIBLE_WIDTH / 8),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+
+#if 0        // this clears all VRAM
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_ANDC, 0x0000),              // no ANDC
+    XREG_SETW(BLIT_XOR, 0x0000),               // no XOR
+    XREG_SETW(BLIT_MOD_S, 0x0000),             // no S modulo
+    XREG_SETW(BLIT_SRC_S, 0x0000),             // fill const
+    XREG_SETW(BLIT_MOD_D, 0x0000),             // no B modulo (contiguous output)
+    XREG_SETW(BLIT_DST_D, 0x0000),             // VRAM display start address line 0
+    XREG_SETW(BLIT_SHIFT, 0xFF00),             // no edge masking or shifting
+    XREG_SETW(BLIT_LINES, 0x0000),             // repeat 1 time
+    XREG_SETW(BLIT_WORDS, 0x10000 - 1),        // size of VRAM
+    REG_WAIT_BLIT_DONE(),
+#endif
+
+    XREG_SETW(POINTER_H, OFFSCREEN_WIDTH + 390),
+    XREG_SETW(POINTER_V, 0xF000 | 100),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+
+#if 0
+    REG_W(PIXEL_X, 0xC000),        // base
+    REG_W(PIXEL_Y, 0x0100),        // width
+    REG_BH(SYS_CTRL, 0x00),         // set base, width
+
+    REG_W(PIXEL_X, 0x0000),
+    REG_W(PIXEL_Y, 0x0000),
+    REG_W(DATA, 0xAAAA),
+
+    REG_W(PIXEL_X, 0x0000),
+    REG_W(PIXEL_Y, 0x0005),
+    REG_W(DATA, 0x5555),
+
+    REG_W(PIXEL_X, 0x0005),
+    REG_W(PIXEL_Y, 0x0000),
+    REG_W(DATA, 0xAAAA),
+
+    REG_W(PIXEL_X, 0x0005),
+    REG_W(PIXEL_Y, 0x0005),
+    REG_W(DATA, 0x5555),
+
+    REG_W(PIXEL_X, 0xC000),        // base
+    REG_W(PIXEL_Y, 0x0100),        // width
+    REG_BH(FEATURE, 0x01),         // set base, width
+
+    REG_W(PIXEL_X, 0x0000),
+    REG_W(PIXEL_Y, 0x0000),
+    REG_W(DATA, 0xAAAA),
+
+    REG_W(PIXEL_X, 0x0000),
+    REG_W(PIXEL_Y, 0x0005),
+    REG_W(DATA, 0x5555),
+
+    REG_W(PIXEL_X, 0x0005),
+    REG_W(PIXEL_Y, 0x0000),
+    REG_W(DATA, 0xAAAA),
+
+    REG_W(PIXEL_X, 0x0004),
+    REG_W(PIXEL_Y, 0x0005),
+    REG_W(DATA, 0x5555),
+
+    REG_W(PIXEL_X, 0x0005),
+    REG_W(PIXEL_Y, 0x0005),
+    REG_W(DATA, 0x5555),
+
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+#endif
+
+#if 0
+    REG_W(WR_INCR, 0x10),
+    REG_W(WR_ADDR, 0x2000),
+    REG_W(DATA, 1234),
+    REG_W(DATA, 5678),
+
+    REG_W(WR_XADDR, XR_COLOR_A_ADDR),
+    REG_W(XDATA, 0x1234),
+    REG_W(XDATA, 0x5678),
+
+    REG_W(RD_XADDR, XR_COLOR_A_ADDR),
+    REG_RW(XDATA),
+    REG_RW(XDATA),
+#endif
+
+#if 0
+    // copper bar sample
+    XREG_SETW(POINTER_V, 0xF000 | 480),
+    XREG_SETW(PA_GFX_CTRL, 0x0000),        // blank screen
+    XREG_SETW(PB_GFX_CTRL, 0x0080),        // blank screen
+    XREG_SETW(VID_CTRL, 0x0000),           // border color #0
+
+#include "color_bar_table.vsim.h"
+
+    REG_W(WR_INCR, 0x0001),
+    REG_W(WR_ADDR, 0x0000),
+    REG_W(DATA, 0x0F00 | 'X'),
+    REG_BL(DATA, 'o'),
+    REG_BL(DATA, 's'),
+    REG_BL(DATA, 'e'),
+    REG_BL(DATA, 'r'),
+    REG_BL(DATA, 'a'),
+    REG_BL(DATA, ' '),
+    REG_BL(DATA, 'c'),
+    REG_BL(DATA, 'o'),
+    REG_BL(DATA, 'p'),
+    REG_BL(DATA, 'p'),
+    REG_BL(DATA, 'e'),
+    REG_BL(DATA, 'r'),
+    REG_BL(DATA, ' '),
+    REG_BL(DATA, 'r'),
+    REG_BL(DATA, 'a'),
+    REG_BL(DATA, 's'),
+    REG_BL(DATA, 't'),
+    REG_BL(DATA, 'e'),
+    REG_BL(DATA, 'r'),
+    REG_BL(DATA, ' '),
+    REG_BL(DATA, 'b'),
+    REG_BL(DATA, 'a'),
+    REG_BL(DATA, 'r'),
+    REG_BL(DATA, ' '),
+    REG_BL(DATA, 'e'),
+    REG_BL(DATA, 'x'),
+    REG_BL(DATA, 'a'),
+    REG_BL(DATA, 'm'),
+    REG_BL(DATA, 'p'),
+    REG_BL(DATA, 'l'),
+    REG_BL(DATA, 'e'),
+
+    XREG_SETW(COPP_CTRL, 0x8000),        // enable copper
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    XREG_SETW(COPP_CTRL, 0x0000),        // disable copper
+#endif
+
+
+#if 1
+    REG_W(SYS_CTRL, 0x000F),                // write mask
+    XREG_SETW(PA_GFX_CTRL, 0x005F),         // bitmap, 4-bpp, Hx4, Vx4
+    XREG_SETW(PA_TILE_CTRL, 0x000F),        // tileset 0x0000 in TILEMEM, tilemap in VRAM, 16-high font
+    XREG_SETW(PA_DISP_ADDR, 0x0000),        // display start address
+    XREG_SETW(PA_LINE_LEN, W_4BPP),         // display line word length (320 pixels with 4 pixels per word at 4-bpp)
+
+    // REG_W(WR_XADDR, XR_COLOR_ADDR),        // upload color palette
+    // REG_UPLOAD_AUX(),
+    // upload moto logo to 0xF000
+    REG_W(WR_INCR, 0x0001),
+    REG_W(WR_ADDR, 0xF000),
+    REG_UPLOAD(),
+
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+
+    // fill screen with dither with 0 = transparency
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, 0x0001),             // constS, no transp
+    XREG_SETW(BLIT_ANDC, 0x0000),             // no ANDC
+    XREG_SETW(BLIT_XOR, 0x0000),              // no XOR
+    XREG_SETW(BLIT_MOD_S, 0x0000),            // no S modulo
+    XREG_SETW(BLIT_SRC_S, 0x8888),            // fill const
+    XREG_SETW(BLIT_MOD_D, 0x0000),            // no B modulo (contiguous output)
+    XREG_SETW(BLIT_DST_D, 0x0000),            // VRAM display start address line 0
+    XREG_SETW(BLIT_SHIFT, 0xFF00),            // no edge masking or shifting
+    XREG_SETW(BLIT_LINES, H_4BPP - 1),        // screen height -1
+    XREG_SETW(BLIT_WORDS, W_4BPP - 1),        // screen width in words -1
+
+    REG_WAIT_BLIT_DONE(),
+    REG_WAITVTOP(),
+
+    // fill screen with dither with 0 = opaque
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, 0x0011),                   // constS, enable 4-bit transp=0x00
+    XREG_SETW(BLIT_ANDC, 0x0000),                   // no ANDC
+    XREG_SETW(BLIT_XOR, 0x0000),                    // no XOR
+    XREG_SETW(BLIT_MOD_S, 0x0000),                  // no S modulo
+    XREG_SETW(BLIT_SRC_S, 0x1010),                  // fill const
+    XREG_SETW(BLIT_MOD_D, W_4BPP),                  // modulo line width (to skip every other line)
+    XREG_SETW(BLIT_DST_D, 0x0000),                  // VRAM display start address line 0
+    XREG_SETW(BLIT_SHIFT, 0xFF00),                  // no edge masking or shifting
+    XREG_SETW(BLIT_LINES, (H_4BPP / 2) - 1),        // (screen height/2) -1
+    XREG_SETW(BLIT_WORDS, W_4BPP - 1),              // screen width in words -1
+
+    REG_WAIT_BLIT_READY(),
+
+    XREG_SETW(BLIT_CTRL, 0x0011),                   // constS, enable 4-bit transp=0x00
+    XREG_SETW(BLIT_ANDC, 0x0000),                   // no ANDC
+    XREG_SETW(BLIT_XOR, 0x0000),                    // no XOR
+    XREG_SETW(BLIT_MOD_S, 0x0000),                  // C line XOR (toggle dither pattern)
+    XREG_SETW(BLIT_SRC_S, 0x0101),                  // fill const
+    XREG_SETW(BLIT_MOD_D, W_4BPP),                  // modulo line width (to skip every other line)
+    XREG_SETW(BLIT_DST_D, 0x0000 + W_4BPP),         // VRAM display start address line 1
+    XREG_SETW(BLIT_SHIFT, 0xFF00),                  // no edge masking or shifting
+    XREG_SETW(BLIT_LINES, (H_4BPP / 2) - 1),        // (screen height/2) -1
+    XREG_SETW(BLIT_WORDS, W_4BPP - 1),              // screen width in words -1
+
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+
+    // 2D moto blit 0, 0
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, 0x0000),                             // enable 4-bit transp=0x00
+    XREG_SETW(BLIT_ANDC, 0x0000),                             // no ANDC
+    XREG_SETW(BLIT_XOR, 0x0000),                              // no XOR
+    XREG_SETW(BLIT_MOD_S, 0x0000),                            // no S modulo (contiguous source)
+    XREG_SETW(BLIT_SRC_S, 0xF000),                            // S = start of moto logo
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO),                   // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (20 * W_4BPP) + 1),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0xFF00),                            // no masking or shifting
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                        // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1),                        // moto graphic width
+
+    // 2D moto blit 1, 0
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, 0x0000),                             // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x0000),                             // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x0000),                              // no A line XOR
+    XREG_SETW(BLIT_MOD_S, -1),                                // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                            // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),               // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (40 * W_4BPP) + 1),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0x7801),                            // shift/mask 1 nibble
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                        // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                    // moto graphic width
+
+    // 2D moto blit 2, 0
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, 0x0000),                             // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x0000),                             // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x0000),                              // no A line XOR
+    XREG_SETW(BLIT_MOD_S, -1),                                // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                            // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),               // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (60 * W_4BPP) + 1),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0x3C02),                            // shift/mask 2 nibbles
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                        // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                    // moto graphic width
+
+    // 2D moto blit 3, 0
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, 0x0000),                             // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x0000),                             // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x0000),                              // no A line XOR
+    XREG_SETW(BLIT_MOD_S, -1),                                // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                            // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),               // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (80 * W_4BPP) + 1),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0x1E03),                            // shift/mask 3 nibbles
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                        // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                    // moto graphic width
+
+    // 2D moto blit 0, 1
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, BLIT_CTRL_TRANSP_F),                  // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
+    XREG_SETW(BLIT_MOD_S, 0x0000),                             // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO),                    // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (20 * W_4BPP) + 10),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0xFF00),                             // no masking or shifting
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1),                         // moto graphic width
+
+    // 2D moto blit 1, 1
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, BLIT_CTRL_TRANSP_F),                  // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
+    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (40 * W_4BPP) + 10),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0x7801),                             // shift/mask 1 nibble
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+
+    // 2D moto blit 2, 1
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, BLIT_CTRL_TRANSP_F),                  // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
+    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (60 * W_4BPP) + 10),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0x3C02),                             // shift/mask 2 nibbles
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+
+    // 2D moto blit 3, 1
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, BLIT_CTRL_TRANSP_F),                  // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
+    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (80 * W_4BPP) + 10),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0x1E03),                             // shift/mask 3 nibbles
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+
+
+    // 2D moto blit 0, 2
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, 0xFF00 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
+    XREG_SETW(BLIT_MOD_S, 0x0000),                             // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO),                    // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (20 * W_4BPP) + 19),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0xFF00),                             // no masking or shifting
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1),                         // moto graphic width
+
+    // 2D moto blit 1, 2
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, 0xFF00 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
+    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (40 * W_4BPP) + 19),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0x7801),                             // shift/mask 1 nibble
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+
+    // 2D moto blit 2, 2
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, 0xFF00 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
+    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (60 * W_4BPP) + 19),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0x3C02),                             // shift/mask 2 nibbles
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+
+    // 2D moto blit 3, 2
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, 0xFF00 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
+    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (80 * W_4BPP) + 19),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0x1E03),                             // shift/mask 3 nibbles
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+
+
+    // 2D moto blit 0, 3
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, 0x0000 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x3333),                              // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x1111),                               // no A line XOR
+    XREG_SETW(BLIT_MOD_S, 0x0000),                             // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO),                    // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (20 * W_4BPP) + 28),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0xFF00),                             // no masking or shifting
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1),                         // moto graphic width
+
+    // 2D moto blit 1, 3
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, 0x0000 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x3333),                              // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x2222),                               // no A line XOR
+    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (40 * W_4BPP) + 28),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0x7801),                             // shift/mask 1 nibble
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+
+    // 2D moto blit 2, 3
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, 0x0000 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x3333),                              // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x3333),                               // no A line XOR
+    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (60 * W_4BPP) + 28),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0x3C02),                             // shift/mask 2 nibbles
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+
+    // 2D moto blit 3, 3
+    REG_WAIT_BLIT_READY(),
+    XREG_SETW(BLIT_CTRL, 0x0000 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
+    XREG_SETW(BLIT_ANDC, 0x4444),                              // no A line XOR
+    XREG_SETW(BLIT_XOR, 0x8888),                               // no A line XOR
+    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
+    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
+    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
+    XREG_SETW(BLIT_DST_D, 0x0000 + (80 * W_4BPP) + 28),        // D = start dest address
+    XREG_SETW(BLIT_SHIFT, 0x1E03),                             // shift/mask 3 nibbles
+    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
+    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+
+
+
+
+#if 1
+
+    // 16-color 320x200 color tut
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    XREG_SETW(PA_GFX_CTRL, 0x0065),           // bitmap, 8-bpp, Hx2, Vx2
+    XREG_SETW(PA_TILE_CTRL, 0x000F),          // tileset 0x0000 in TILEMEM, tilemap in VRAM, 16-high font
+    XREG_SETW(PA_DISP_ADDR, 0x0000),          // display start address
+    XREG_SETW(PA_LINE_LEN, (320 / 2)),        // display line word length (320 pixels with 2 pixels per word at 8-bpp)
+    XREG_SETW(PB_GFX_CTRL, 0x0080),           // disable
+
+    REG_W(WR_XADDR, XR_COLOR_ADDR),        // upload color palette
+    REG_UPLOAD_AUX(),
+
+    REG_W(WR_INCR, 0x0001),
+    REG_W(WR_ADDR, 0x0000),
+    REG_UPLOAD(),
+
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+
+#endif
+
+
+    REG_WAIT_BLIT_DONE(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+
+#endif
+
+#if 0
+    // true color hack test
+
+    XREG_SETW(PA_GFX_CTRL, 0x0065),         // PA bitmap, 8-bpp, Hx2, Vx2
+    XREG_SETW(PA_TILE_CTRL, 0x000F),        // tileset 0x0000 in TILEMEM, tilemap in VRAM, 16-high font
+    XREG_SETW(PA_DISP_ADDR, 0x0000),        // display start address (start of 8-bpp line data)
+    XREG_SETW(PA_LINE_LEN,
+              (320 / 2) +
+                  (320 / 4)),        // display line word length (combined 8-bit and 4-bit for interleaved lines)
+
+    XREG_SETW(PB_GFX_CTRL, 0x0055),                     // PB bitmap, 4-bpp, Hx2, Vx2
+    XREG_SETW(PB_TILE_CTRL, 0x000F),                    // tileset 0x0000 in TILEMEM, tilemap in VRAM, 16-high font
+    XREG_SETW(PB_DISP_ADDR, 0x0000 + (320 / 2)),        // display start address (start of 4-bpp line data)
+    XREG_SETW(PB_LINE_LEN,
+              (320 / 2) +
+                  (320 / 4)),        // display line word length (combined 8-bit and 4-bit for interleaved lines)
 
-                    index++;
-                }
-                int rd_wr   = (test_data[index] & 0xC000) == 0x8000 ? 1 : 0;
-                int bytesel = (test_data[index] & 0x1000) ? 1 : 0;
-                int reg_num = (test_data[index] >> 8) & 0xf;
-                int data    = test_data[index] & 0xff;
+    REG_W(WR_XADDR, XR_COLOR_ADDR),        // upload color palette
+    REG_UPLOAD_AUX(),
 
-                if (data_upload && state == BUS_START)
-                {
-                    bytesel = data_upload_index & 1;
-                    reg_num = data_upload_mode ? XM_XDATA : XM_DATA;
-                    data    = upload_payload[data_upload_num][data_upload_index++];
-                }
+    REG_W(WR_INCR, 0x0001),        // 16x16 logo to 0xF000
+    REG_W(WR_ADDR, 0x0000),
+    REG_UPLOAD(),        // RG 8-bpp + 4-bpp B
 
-                switch (state)
-                {
-                    case BUS_START:
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
 
-                        top->bus_cs_n_i    = 1;
-                        top->bus_bytesel_i = bytesel;
-                        top->bus_rd_nwr_i  = rd_wr;
-                        top->bus_reg_num_i = reg_num;
-                        top->bus_data_i    = data;
-                        if (data_upload && data_upload_index < 16)
-                        {
-                            logonly_printf("[@t=%8lu] ", main_time);
-                            snprintf(tempstr,
-                                     sizeof(tempstr),
-                                     "r[0x%x] %s.%3s",
-                                     reg_num,
-                                     reg_name[reg_num],
-                                     bytesel ? "lsb*" : "msb");
-                            logonly_printf("  %-25.25s <= %s%02x%s\n",
-                                           tempstr,
-                                           bytesel ? "__" : "",
-                                           data & 0xff,
-                                           bytesel ? "" : "__");
-                            if (data_upload_index == 15)
-                            {
-                                logonly_printf("  ...\n");
-                            }
-                        }
-                        break;
-                    case BUS_HOLD:
-                        break;
-                    case BUS_STROBEOFF:
-                        if (rd_wr)
-                        {
-                            if (!wait_blit)
-                            {
-                                logonly_printf("[@t=%8lu] Read  Reg %s (#%02x.%s) => %s%02x%s\n",
-                                               main_time,
-                                               reg_name[reg_num],
-                                               reg_num,
-                                               bytesel ? "L" : "H",
-                                               bytesel ? "__" : "",
-                                               top->bus_data_o,
-                                               bytesel ? "" : "__");
-                            }
-                            if (bytesel)
-                            {
-                                last_read_val = (last_read_val & 0xff00) | top->bus_data_o;
-                            }
-                            else
-                            {
-                                last_read_val = (last_read_val & 0x00ff) | (top->bus_data_o << 8);
-                            }
-                        }
-                        else if (!data_upload)
-                        {
-                            logonly_printf("[@t=%8lu] Write Reg %s (#%02x.%s) <= %s%02x%s\n",
-                                           main_time,
-                                           reg_name[reg_num],
-                                           reg_num,
-                                           bytesel ? "L" : "H",
-                                           bytesel ? "__" : "",
-                                           top->bus_data_i,
-                                           bytesel ? "" : "__");
-                        }
-                        top->bus_cs_n_i = 0;
-                        break;
-                    case BUS_END:
-                        top->bus_cs_n_i    = 0;
-                        top->bus_bytesel_i = 0;
-                        top->bus_rd_nwr_i  = 0;
-                        top->bus_reg_num_i = 0;
-                        top->bus_data_i    = 0;
-                        //                        last_time          = bus_time + 9;
-                        if (data_upload)
-                        {
-                            if (data_upload_index >= data_upload_count)
-                            {
-                                data_upload = false;
-                                logonly_printf("[Upload #%d completed]\n", data_upload_num + 1);
-                                data_upload_num++;
-                            }
-                        }
-                        else if (++index >= test_data_len)
-                        {
-                            logonly_printf("*** END of test_data_len ***\n");
-                            enable = false;
-                        }
-                        break;
-                    default:
-                        assert(false);
-                }
-                state = state + 1;
-                if (state > BUS_END)
-                {
-                    state = BUS_START;
-                }
-            }
-            else
-            {
-                //                logonly_printf("%5d < %5d INDEX=%9d\n", bus_time, last_time, index);
-            }
-        }
-    }
-};
+#endif
 
-const char * BusInterface::reg_name[] = {"XM_SYS_CTRL ",
-                                         "XM_INT_CTRL ",
-                                         "XM_TIMER    ",
-                                         "XM_RD_XADDR ",
-                                         "XM_WR_XADDR ",
-                                         "XM_XDATA    ",
-                                         "XM_RD_INCR  ",
-                                         "XM_RD_ADDR  ",
-                                         "XM_WR_INCR  ",
-                                         "XM_WR_ADDR  ",
-                                         "XM_DATA     ",
-                                         "XM_DATA_2   ",
-                                         "XM_PIXEL_X  ",
-                                         "XM_PIXEL_Y  ",
-                                         "XM_UART",
-                                         "XM_FEATURE  "};
+#if 0
+    // slim copper wait test
+    XREG_SETW(PA_GFX_CTRL, 0x0080),        // blank screen
+    XREG_SETW(PB_GFX_CTRL, 0x0080),        // blank screen
+    XREG_SETW(VID_CTRL, 0x0000),           // border color #0
 
-#define REG_BH(r, v)     (((XM_##r) | 0x00) << 8) | ((v) & 0xff)
-#define REG_BL(r, v)     (((XM_##r) | 0x10) << 8) | ((v) & 0xff)
-#define REG_W(r, v)      ((XM_##r) << 8) | (((v) >> 8) & 0xff), (((XM_##r) | 0x10) << 8) | ((v) & 0xff)
-#define REG_RW(r)        (((XM_##r) | 0x80) << 8), (((XM_##r) | 0x90) << 8)
-#define XREG_SETW(xr, v) REG_W(WR_XADDR, XR_##xr), REG_W(XDATA, (v))
-#define XREG_GETW(xr)    REG_W(RD_XADDR, (XR_##xr) | XRMEM_READ), REG_RW(XDATA)
+#include "cop_wait_test.vsim.h"
 
-#define XMEM_SETW(xrmem, v) REG_W(WR_XADDR, xrmem), REG_W(XDATA, (v))
+    XREG_SETW(COPP_CTRL, 0x8000),        // enable copper
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+#endif
 
-#define REG_UPLOAD()          0xfff0
-#define REG_UPLOAD_AUX()      0xfff1
-#define REG_WAITHSYNC()       0xfffa
-#define REG_WAIT_BLIT_READY() (((XM_SYS_CTRL) | 0x80) << 8), 0xfffc
-#define REG_WAIT_BLIT_DONE()  (((XM_SYS_CTRL) | 0x80) << 8), 0xfffb
-#define REG_WAITVTOP()        0xfffd
-#define REG_WAITVSYNC()       0xfffe
-#define REG_END()             0xffff
+#if 1
+    // slim copper test
+    XREG_SETW(PA_GFX_CTRL, 0x0080),        // blank screen
+    XREG_SETW(PB_GFX_CTRL, 0x0080),        // blank screen
+    XREG_SETW(VID_CTRL, 0x0000),           // border color #0
 
-#define X_COLS 80
-#define W_4BPP (320 / 4)
-#define H_4BPP (240)
+#include "cop_blend_test.vsim.h"
 
-#define W_LOGO (32 / 4)
-#define H_LOGO (16)
 
-BusInterface bus;
-int          BusInterface::test_data_len    = 32767;
-uint16_t     BusInterface::test_data[32768] = {
-    // test data
+    XREG_SETW(COPP_CTRL, 0x8000),        // enable copper
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+#endif
 
-    REG_WAITHSYNC(),
+
+#if 0
+
+    // 16-color 320x200 color tut
     REG_WAITVTOP(),
-    REG_WAIT_BLIT_DONE(),
-    // initialize non-zero Xosera registers
-    XREG_SETW(VID_CTRL, 0x0008),
-    XREG_SETW(VID_LEFT, 0),
-    XREG_SETW(VID_RIGHT, VISIBLE_WIDTH),
+    REG_WAITVSYNC(),
+    XREG_SETW(PA_HV_FSCALE, 0x0005),        // 400 line scale
+    XREG_SETW(PA_HV_FSCALE, 0x0005),        // 400 line scale
+
+    XREG_SETW(PA_GFX_CTRL, 0x0055),           // bitmap, 8-bpp, Hx2, Vx2
+    XREG_SETW(PA_TILE_CTRL, 0x000F),          // tileset 0x0000 in TILEMEM, tilemap in VRAM, 16-high font
+    XREG_SETW(PA_DISP_ADDR, 0x0000),          // display start address
+    XREG_SETW(PA_LINE_LEN, (320 / 4)),        // display line word length (320 pixels with 4 pixels per word at 4-bpp)
+
+    XREG_SETW(PB_GFX_CTRL, 0x0080),        // disable
+
+    REG_W(WR_XADDR, XR_COLOR_ADDR),        // upload color palette
+    REG_UPLOAD_AUX(),
+
+    REG_W(WR_INCR, 0x0001),        // tut
+    REG_W(WR_ADDR, 0x0000),
+    REG_UPLOAD(),        // RG 8-bpp + 4-bpp B
 
-    XREG_SETW(PA_GFX_CTRL, 0x0080),
-    XREG_SETW(PA_TILE_CTRL, 0x000F),
-    XREG_SETW(PA_LINE_LEN, VISIBLE_WIDTH / 8),
-    XREG_SETW(PB_GFX_CTRL, 0x0080),
-    XREG_SETW(PB_TILE_CTRL, 0x000F),
-    XREG_SETW(PB_LINE_LEN, VISIBLE_WIDTH / 8),
     REG_WAITVTOP(),
     REG_WAITVSYNC(),
+
     REG_WAITVTOP(),
     REG_WAITVSYNC(),
 
-#if 0        // this clears all VRAM
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_ANDC, 0x0000),              // no ANDC
-    XREG_SETW(BLIT_XOR, 0x0000),               // no XOR
-    XREG_SETW(BLIT_MOD_S, 0x0000),             // no S modulo
-    XREG_SETW(BLIT_SRC_S, 0x0000),             // fill const
-    XREG_SETW(BLIT_MOD_D, 0x0000),             // no B modulo (contiguous output)
-    XREG_SETW(BLIT_DST_D, 0x0000),             // VRAM display start address line 0
-    XREG_SETW(BLIT_SHIFT, 0xFF00),             // no edge masking or shifting
-    XREG_SETW(BLIT_LINES, 0x0000),             // repeat 1 time
-    XREG_SETW(BLIT_WORDS, 0x10000 - 1),        // size of VRAM
-    REG_WAIT_BLIT_DONE(),
-#endif
+#endif
+
+#if 0        // lame audio test
+    XREG_SETW(VID_CTRL, 0x0000),
+    XREG_SETW(VID_RIGHT, 640 - 4),
+
+    REG_RW(INT_CTRL),
+    REG_W(INT_CTRL, 0x000F),
+    REG_RW(INT_CTRL),
+
+    REG_W(WR_INCR, 0x0001),        // sample at 0xFF00
+    REG_W(WR_ADDR, 0xFF00),
+    REG_UPLOAD(),        // upload sample data
+
+    REG_W(WR_INCR, 0x0001),        // sample at 0xFE00
+    REG_W(WR_ADDR, 0xFE00),
+    REG_UPLOAD(),        // upload sample data
+
+#include "cop_audio_evil.vsim.h"
+
+//    XREG_SETW(PA_GFX_CTRL, 0x0080),        // pf a blank
+//    XREG_SETW(PB_GFX_CTRL, 0x0080),        // pf b blank
+
+#define SILENCE_ADDR (XR_TILE_ADDR + XR_TILE_SIZE - 1)
+#define PERIOD_TEST  0x300
+#define WAVE_TEST    0xFF00
+#define WAVE_LEN     0x0001
+#define WAVE_LEN3    0x007F
+
+    XMEM_SETW(SILENCE_ADDR, 0xE3E4),
+    XREG_SETW(COPP_CTRL, 0x8000),        // enable copper
+
+    XREG_SETW(AUD0_VOL, 0x0000),
+    XREG_SETW(AUD0_LENGTH, 0x8000 | 0),
+    XREG_SETW(AUD0_START, SILENCE_ADDR),
+    XREG_SETW(AUD0_PERIOD, 0x7FFF),
+
+    XREG_SETW(AUD1_VOL, 0x0000),
+    XREG_SETW(AUD1_LENGTH, 0x8000 | 0),
+    XREG_SETW(AUD1_START, SILENCE_ADDR),
+    XREG_SETW(AUD1_PERIOD, 0x7FFF),
 
-    XREG_SETW(POINTER_H, OFFSCREEN_WIDTH + 390),
-    XREG_SETW(POINTER_V, 0xF000 | 100),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
+    XREG_SETW(AUD2_VOL, 0x0000),
+    XREG_SETW(AUD2_LENGTH, 0x8000 | 0),
+    XREG_SETW(AUD2_START, SILENCE_ADDR),
+    XREG_SETW(AUD2_PERIOD, 0x7FFF),
 
-#if 0
-    REG_W(PIXEL_X, 0xC000),        // base
-    REG_W(PIXEL_Y, 0x0100),        // width
-    REG_BH(SYS_CTRL, 0x00),         // set base, width
+    XREG_SETW(AUD3_VOL, 0x0000),
+    XREG_SETW(AUD3_LENGTH, 0x8000 | 0),
+    XREG_SETW(AUD3_START, SILENCE_ADDR),
+    XREG_SETW(AUD3_PERIOD, 0x7FFF),
 
-    REG_W(PIXEL_X, 0x0000),
-    REG_W(PIXEL_Y, 0x0000),
-    REG_W(DATA, 0xAAAA),
+    XREG_SETW(AUD_CTRL, 0x0001),
 
-    REG_W(PIXEL_X, 0x0000),
-    REG_W(PIXEL_Y, 0x0005),
-    REG_W(DATA, 0x5555),
+    REG_RW(INT_CTRL),
+    REG_RW(INT_CTRL),
+    REG_RW(INT_CTRL),
+    REG_RW(INT_CTRL),
+    REG_RW(INT_CTRL),
+    REG_RW(INT_CTRL),
+    REG_RW(INT_CTRL),
+    REG_RW(INT_CTRL),
 
-    REG_W(PIXEL_X, 0x0005),
-    REG_W(PIXEL_Y, 0x0000),
-    REG_W(DATA, 0xAAAA),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    REG_W(PIXEL_X, 0x0005),
-    REG_W(PIXEL_Y, 0x0005),
-    REG_W(DATA, 0x5555),
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    REG_W(PIXEL_X, 0xC000),        // base
-    REG_W(PIXEL_Y, 0x0100),        // width
-    REG_BH(FEATURE, 0x01),         // set base, width
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    REG_W(PIXEL_X, 0x0000),
-    REG_W(PIXEL_Y, 0x0000),
-    REG_W(DATA, 0xAAAA),
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
 
-    REG_W(PIXEL_X, 0x0000),
-    REG_W(PIXEL_Y, 0x0005),
-    REG_W(DATA, 0x5555),
+    XREG_SETW(AUD0_VOL, 0x2020),
+    XREG_SETW(AUD1_VOL, 0x2020),
+    XREG_SETW(AUD2_VOL, 0x2020),
+    XREG_SETW(AUD3_VOL, 0x2020),
+    XREG_SETW(AUD0_PERIOD, 0x8000 | PERIOD_TEST),
+    XREG_SETW(AUD1_PERIOD, 0x8000 | (PERIOD_TEST + 1)),
+    XREG_SETW(AUD2_PERIOD, 0x8000 | (PERIOD_TEST + 3)),
+    XREG_SETW(AUD3_PERIOD, 0x8000 | (PERIOD_TEST - 3)),
 
-    REG_W(PIXEL_X, 0x0005),
-    REG_W(PIXEL_Y, 0x0000),
-    REG_W(DATA, 0xAAAA),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    REG_W(PIXEL_X, 0x0004),
-    REG_W(PIXEL_Y, 0x0005),
-    REG_W(DATA, 0x5555),
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    REG_W(PIXEL_X, 0x0005),
-    REG_W(PIXEL_Y, 0x0005),
-    REG_W(DATA, 0x5555),
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-#endif
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    // spam
 
-#if 0
-    REG_W(WR_INCR, 0x10),
-    REG_W(WR_ADDR, 0x2000),
-    REG_W(DATA, 1234),
-    REG_W(DATA, 5678),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    REG_W(WR_XADDR, XR_COLOR_A_ADDR),
-    REG_W(XDATA, 0x1234),
-    REG_W(XDATA, 0x5678),
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    REG_W(RD_XADDR, XR_COLOR_A_ADDR),
-    REG_RW(XDATA),
-    REG_RW(XDATA),
-#endif
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-#if 0
-    // copper bar sample
-    XREG_SETW(POINTER_V, 0xF000 | 480),
-    XREG_SETW(PA_GFX_CTRL, 0x0000),        // blank screen
-    XREG_SETW(PB_GFX_CTRL, 0x0080),        // blank screen
-    XREG_SETW(VID_CTRL, 0x0000),           // border color #0
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-#include "color_bar_table.vsim.h"
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    REG_W(WR_INCR, 0x0001),
-    REG_W(WR_ADDR, 0x0000),
-    REG_W(DATA, 0x0F00 | 'X'),
-    REG_BL(DATA, 'o'),
-    REG_BL(DATA, 's'),
-    REG_BL(DATA, 'e'),
-    REG_BL(DATA, 'r'),
-    REG_BL(DATA, 'a'),
-    REG_BL(DATA, ' '),
-    REG_BL(DATA, 'c'),
-    REG_BL(DATA, 'o'),
-    REG_BL(DATA, 'p'),
-    REG_BL(DATA, 'p'),
-    REG_BL(DATA, 'e'),
-    REG_BL(DATA, 'r'),
-    REG_BL(DATA, ' '),
-    REG_BL(DATA, 'r'),
-    REG_BL(DATA, 'a'),
-    REG_BL(DATA, 's'),
-    REG_BL(DATA, 't'),
-    REG_BL(DATA, 'e'),
-    REG_BL(DATA, 'r'),
-    REG_BL(DATA, ' '),
-    REG_BL(DATA, 'b'),
-    REG_BL(DATA, 'a'),
-    REG_BL(DATA, 'r'),
-    REG_BL(DATA, ' '),
-    REG_BL(DATA, 'e'),
-    REG_BL(DATA, 'x'),
-    REG_BL(DATA, 'a'),
-    REG_BL(DATA, 'm'),
-    REG_BL(DATA, 'p'),
-    REG_BL(DATA, 'l'),
-    REG_BL(DATA, 'e'),
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    XREG_SETW(COPP_CTRL, 0x8000),        // enable copper
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    XREG_SETW(COPP_CTRL, 0x0000),        // disable copper
-#endif
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-#if 1
-    REG_W(SYS_CTRL, 0x000F),                // write mask
-    XREG_SETW(PA_GFX_CTRL, 0x005F),         // bitmap, 4-bpp, Hx4, Vx4
-    XREG_SETW(PA_TILE_CTRL, 0x000F),        // tileset 0x0000 in TILEMEM, tilemap in VRAM, 16-high font
-    XREG_SETW(PA_DISP_ADDR, 0x0000),        // display start address
-    XREG_SETW(PA_LINE_LEN, W_4BPP),         // display line word length (320 pixels with 4 pixels per word at 4-bpp)
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    // REG_W(WR_XADDR, XR_COLOR_ADDR),        // upload color palette
-    // REG_UPLOAD_AUX(),
-    // upload moto logo to 0xF000
-    REG_W(WR_INCR, 0x0001),
-    REG_W(WR_ADDR, 0xF000),
-    REG_UPLOAD(),
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    // fill screen with dither with 0 = transparency
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, 0x0001),             // constS, no transp
-    XREG_SETW(BLIT_ANDC, 0x0000),             // no ANDC
-    XREG_SETW(BLIT_XOR, 0x0000),              // no XOR
-    XREG_SETW(BLIT_MOD_S, 0x0000),            // no S modulo
-    XREG_SETW(BLIT_SRC_S, 0x8888),            // fill const
-    XREG_SETW(BLIT_MOD_D, 0x0000),            // no B modulo (contiguous output)
-    XREG_SETW(BLIT_DST_D, 0x0000),            // VRAM display start address line 0
-    XREG_SETW(BLIT_SHIFT, 0xFF00),            // no edge masking or shifting
-    XREG_SETW(BLIT_LINES, H_4BPP - 1),        // screen height -1
-    XREG_SETW(BLIT_WORDS, W_4BPP - 1),        // screen width in words -1
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    REG_WAIT_BLIT_DONE(),
-    REG_WAITVTOP(),
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    // fill screen with dither with 0 = opaque
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, 0x0011),                   // constS, enable 4-bit transp=0x00
-    XREG_SETW(BLIT_ANDC, 0x0000),                   // no ANDC
-    XREG_SETW(BLIT_XOR, 0x0000),                    // no XOR
-    XREG_SETW(BLIT_MOD_S, 0x0000),                  // no S modulo
-    XREG_SETW(BLIT_SRC_S, 0x1010),                  // fill const
-    XREG_SETW(BLIT_MOD_D, W_4BPP),                  // modulo line width (to skip every other line)
-    XREG_SETW(BLIT_DST_D, 0x0000),                  // VRAM display start address line 0
-    XREG_SETW(BLIT_SHIFT, 0xFF00),                  // no edge masking or shifting
-    XREG_SETW(BLIT_LINES, (H_4BPP / 2) - 1),        // (screen height/2) -1
-    XREG_SETW(BLIT_WORDS, W_4BPP - 1),              // screen width in words -1
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    REG_WAIT_BLIT_READY(),
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    XREG_SETW(BLIT_CTRL, 0x0011),                   // constS, enable 4-bit transp=0x00
-    XREG_SETW(BLIT_ANDC, 0x0000),                   // no ANDC
-    XREG_SETW(BLIT_XOR, 0x0000),                    // no XOR
-    XREG_SETW(BLIT_MOD_S, 0x0000),                  // C line XOR (toggle dither pattern)
-    XREG_SETW(BLIT_SRC_S, 0x0101),                  // fill const
-    XREG_SETW(BLIT_MOD_D, W_4BPP),                  // modulo line width (to skip every other line)
-    XREG_SETW(BLIT_DST_D, 0x0000 + W_4BPP),         // VRAM display start address line 1
-    XREG_SETW(BLIT_SHIFT, 0xFF00),                  // no edge masking or shifting
-    XREG_SETW(BLIT_LINES, (H_4BPP / 2) - 1),        // (screen height/2) -1
-    XREG_SETW(BLIT_WORDS, W_4BPP - 1),              // screen width in words -1
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
+
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
+
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    // 2D moto blit 0, 0
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, 0x0000),                             // enable 4-bit transp=0x00
-    XREG_SETW(BLIT_ANDC, 0x0000),                             // no ANDC
-    XREG_SETW(BLIT_XOR, 0x0000),                              // no XOR
-    XREG_SETW(BLIT_MOD_S, 0x0000),                            // no S modulo (contiguous source)
-    XREG_SETW(BLIT_SRC_S, 0xF000),                            // S = start of moto logo
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO),                   // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (20 * W_4BPP) + 1),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0xFF00),                            // no masking or shifting
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                        // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1),                        // moto graphic width
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    // 2D moto blit 1, 0
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, 0x0000),                             // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x0000),                             // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x0000),                              // no A line XOR
-    XREG_SETW(BLIT_MOD_S, -1),                                // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                            // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),               // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (40 * W_4BPP) + 1),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0x7801),                            // shift/mask 1 nibble
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                        // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                    // moto graphic width
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    // 2D moto blit 2, 0
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, 0x0000),                             // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x0000),                             // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x0000),                              // no A line XOR
-    XREG_SETW(BLIT_MOD_S, -1),                                // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                            // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),               // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (60 * W_4BPP) + 1),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0x3C02),                            // shift/mask 2 nibbles
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                        // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                    // moto graphic width
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    // 2D moto blit 3, 0
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, 0x0000),                             // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x0000),                             // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x0000),                              // no A line XOR
-    XREG_SETW(BLIT_MOD_S, -1),                                // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                            // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),               // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (80 * W_4BPP) + 1),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0x1E03),                            // shift/mask 3 nibbles
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                        // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                    // moto graphic width
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    // 2D moto blit 0, 1
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, BLIT_CTRL_TRANSP_F),                  // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
-    XREG_SETW(BLIT_MOD_S, 0x0000),                             // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO),                    // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (20 * W_4BPP) + 10),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0xFF00),                             // no masking or shifting
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1),                         // moto graphic width
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    // 2D moto blit 1, 1
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, BLIT_CTRL_TRANSP_F),                  // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
-    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (40 * W_4BPP) + 10),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0x7801),                             // shift/mask 1 nibble
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    // 2D moto blit 2, 1
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, BLIT_CTRL_TRANSP_F),                  // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
-    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (60 * W_4BPP) + 10),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0x3C02),                             // shift/mask 2 nibbles
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    // 2D moto blit 3, 1
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, BLIT_CTRL_TRANSP_F),                  // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
-    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (80 * W_4BPP) + 10),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0x1E03),                             // shift/mask 3 nibbles
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
+
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    // 2D moto blit 0, 2
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, 0xFF00 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
-    XREG_SETW(BLIT_MOD_S, 0x0000),                             // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO),                    // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (20 * W_4BPP) + 19),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0xFF00),                             // no masking or shifting
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1),                         // moto graphic width
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    // 2D moto blit 1, 2
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, 0xFF00 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
-    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (40 * W_4BPP) + 19),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0x7801),                             // shift/mask 1 nibble
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    // 2D moto blit 2, 2
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, 0xFF00 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
-    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (60 * W_4BPP) + 19),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0x3C02),                             // shift/mask 2 nibbles
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    // 2D moto blit 3, 2
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, 0xFF00 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x0000),                              // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x0000),                               // no A line XOR
-    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (80 * W_4BPP) + 19),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0x1E03),                             // shift/mask 3 nibbles
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
+
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    // 2D moto blit 0, 3
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, 0x0000 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x3333),                              // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x1111),                               // no A line XOR
-    XREG_SETW(BLIT_MOD_S, 0x0000),                             // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO),                    // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (20 * W_4BPP) + 28),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0xFF00),                             // no masking or shifting
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1),                         // moto graphic width
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    // 2D moto blit 1, 3
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, 0x0000 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x3333),                              // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x2222),                               // no A line XOR
-    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (40 * W_4BPP) + 28),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0x7801),                             // shift/mask 1 nibble
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    // 2D moto blit 2, 3
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, 0x0000 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x3333),                              // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x3333),                               // no A line XOR
-    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (60 * W_4BPP) + 28),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0x3C02),                             // shift/mask 2 nibbles
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    // 2D moto blit 3, 3
-    REG_WAIT_BLIT_READY(),
-    XREG_SETW(BLIT_CTRL, 0x0000 | BLIT_CTRL_TRANSP_F),         // const A, read B, 4-bit trans=0
-    XREG_SETW(BLIT_ANDC, 0x4444),                              // no A line XOR
-    XREG_SETW(BLIT_XOR, 0x8888),                               // no A line XOR
-    XREG_SETW(BLIT_MOD_S, -1),                                 // line A modulo adjust for added width
-    XREG_SETW(BLIT_SRC_S, 0xF000),                             // moto graphic src B
-    XREG_SETW(BLIT_MOD_D, W_4BPP - W_LOGO - 1),                // D modulo = dest width - source width
-    XREG_SETW(BLIT_DST_D, 0x0000 + (80 * W_4BPP) + 28),        // D = start dest address
-    XREG_SETW(BLIT_SHIFT, 0x1E03),                             // shift/mask 3 nibbles
-    XREG_SETW(BLIT_LINES, H_LOGO - 1),                         // moto graphic height
-    XREG_SETW(BLIT_WORDS, W_LOGO - 1 + 1),                     // moto graphic width
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-#if 1
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    // 16-color 320x200 color tut
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    XREG_SETW(PA_GFX_CTRL, 0x0065),           // bitmap, 8-bpp, Hx2, Vx2
-    XREG_SETW(PA_TILE_CTRL, 0x000F),          // tileset 0x0000 in TILEMEM, tilemap in VRAM, 16-high font
-    XREG_SETW(PA_DISP_ADDR, 0x0000),          // display start address
-    XREG_SETW(PA_LINE_LEN, (320 / 2)),        // display line word length (320 pixels with 2 pixels per word at 8-bpp)
-    XREG_SETW(PB_GFX_CTRL, 0x0080),           // disable
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    REG_W(WR_XADDR, XR_COLOR_ADDR),        // upload color palette
-    REG_UPLOAD_AUX(),
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    REG_W(WR_INCR, 0x0001),
-    REG_W(WR_ADDR, 0x0000),
-    REG_UPLOAD(),
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-#endif
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    REG_WAIT_BLIT_DONE(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-#endif
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-#if 0
-    // true color hack test
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    XREG_SETW(PA_GFX_CTRL, 0x0065),         // PA bitmap, 8-bpp, Hx2, Vx2
-    XREG_SETW(PA_TILE_CTRL, 0x000F),        // tileset 0x0000 in TILEMEM, tilemap in VRAM, 16-high font
-    XREG_SETW(PA_DISP_ADDR, 0x0000),        // display start address (start of 8-bpp line data)
-    XREG_SETW(PA_LINE_LEN,
-              (320 / 2) +
-                  (320 / 4)),        // display line word length (combined 8-bit and 4-bit for interleaved lines)
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    XREG_SETW(PB_GFX_CTRL, 0x0055),                     // PB bitmap, 4-bpp, Hx2, Vx2
-    XREG_SETW(PB_TILE_CTRL, 0x000F),                    // tileset 0x0000 in TILEMEM, tilemap in VRAM, 16-high font
-    XREG_SETW(PB_DISP_ADDR, 0x0000 + (320 / 2)),        // display start address (start of 4-bpp line data)
-    XREG_SETW(PB_LINE_LEN,
-              (320 / 2) +
-                  (320 / 4)),        // display line word length (combined 8-bit and 4-bit for interleaved lines)
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    REG_W(WR_XADDR, XR_COLOR_ADDR),        // upload color palette
-    REG_UPLOAD_AUX(),
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    REG_W(WR_INCR, 0x0001),        // 16x16 logo to 0xF000
-    REG_W(WR_ADDR, 0x0000),
-    REG_UPLOAD(),        // RG 8-bpp + 4-bpp B
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-#endif
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-#if 0
-    // slim copper wait test
-    XREG_SETW(PA_GFX_CTRL, 0x0080),        // blank screen
-    XREG_SETW(PB_GFX_CTRL, 0x0080),        // blank screen
-    XREG_SETW(VID_CTRL, 0x0000),           // border color #0
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-#include "cop_wait_test.vsim.h"
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    XREG_SETW(COPP_CTRL, 0x8000),        // enable copper
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-#endif
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-#if 1
-    // slim copper test
-    XREG_SETW(PA_GFX_CTRL, 0x0080),        // blank screen
-    XREG_SETW(PB_GFX_CTRL, 0x0080),        // blank screen
-    XREG_SETW(VID_CTRL, 0x0000),           // border color #0
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-#include "cop_blend_test.vsim.h"
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    XREG_SETW(COPP_CTRL, 0x8000),        // enable copper
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-#endif
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-#if 0
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    // 16-color 320x200 color tut
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    XREG_SETW(PA_HV_FSCALE, 0x0005),        // 400 line scale
-    XREG_SETW(PA_HV_FSCALE, 0x0005),        // 400 line scale
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    XREG_SETW(PA_GFX_CTRL, 0x0055),           // bitmap, 8-bpp, Hx2, Vx2
-    XREG_SETW(PA_TILE_CTRL, 0x000F),          // tileset 0x0000 in TILEMEM, tilemap in VRAM, 16-high font
-    XREG_SETW(PA_DISP_ADDR, 0x0000),          // display start address
-    XREG_SETW(PA_LINE_LEN, (320 / 4)),        // display line word length (320 pixels with 4 pixels per word at 4-bpp)
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    XREG_SETW(PB_GFX_CTRL, 0x0080),        // disable
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    REG_W(WR_XADDR, XR_COLOR_ADDR),        // upload color palette
-    REG_UPLOAD_AUX(),
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    REG_W(WR_INCR, 0x0001),        // tut
-    REG_W(WR_ADDR, 0x0000),
-    REG_UPLOAD(),        // RG 8-bpp + 4-bpp B
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-#endif
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-#if 0        // lame audio test
-    XREG_SETW(VID_CTRL, 0x0000),
-    XREG_SETW(VID_RIGHT, 640 - 4),
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    REG_RW(INT_CTRL),
-    REG_W(INT_CTRL, 0x000F),
-    REG_RW(INT_CTRL),
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    REG_W(WR_INCR, 0x0001),        // sample at 0xFF00
-    REG_W(WR_ADDR, 0xFF00),
-    REG_UPLOAD(),        // upload sample data
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    REG_W(WR_INCR, 0x0001),        // sample at 0xFE00
-    REG_W(WR_ADDR, 0xFE00),
-    REG_UPLOAD(),        // upload sample data
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-#include "cop_audio_evil.vsim.h"
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-//    XREG_SETW(PA_GFX_CTRL, 0x0080),        // pf a blank
-//    XREG_SETW(PB_GFX_CTRL, 0x0080),        // pf b blank
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-#define SILENCE_ADDR (XR_TILE_ADDR + XR_TILE_SIZE - 1)
-#define PERIOD_TEST  0x300
-#define WAVE_TEST    0xFF00
-#define WAVE_LEN     0x0001
-#define WAVE_LEN3    0x007F
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    XMEM_SETW(SILENCE_ADDR, 0xE3E4),
-    XREG_SETW(COPP_CTRL, 0x8000),        // enable copper
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    XREG_SETW(AUD0_VOL, 0x0000),
-    XREG_SETW(AUD0_LENGTH, 0x8000 | 0),
-    XREG_SETW(AUD0_START, SILENCE_ADDR),
-    XREG_SETW(AUD0_PERIOD, 0x7FFF),
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    XREG_SETW(AUD1_VOL, 0x0000),
-    XREG_SETW(AUD1_LENGTH, 0x8000 | 0),
-    XREG_SETW(AUD1_START, SILENCE_ADDR),
-    XREG_SETW(AUD1_PERIOD, 0x7FFF),
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    XREG_SETW(AUD2_VOL, 0x0000),
-    XREG_SETW(AUD2_LENGTH, 0x8000 | 0),
-    XREG_SETW(AUD2_START, SILENCE_ADDR),
-    XREG_SETW(AUD2_PERIOD, 0x7FFF),
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
-    XREG_SETW(AUD3_VOL, 0x0000),
-    XREG_SETW(AUD3_LENGTH, 0x8000 | 0),
-    XREG_SETW(AUD3_START, SILENCE_ADDR),
-    XREG_SETW(AUD3_PERIOD, 0x7FFF),
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
-    XREG_SETW(AUD_CTRL, 0x0001),
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
-    REG_RW(INT_CTRL),
-    REG_RW(INT_CTRL),
-    REG_RW(INT_CTRL),
-    REG_RW(INT_CTRL),
-    REG_RW(INT_CTRL),
-    REG_RW(INT_CTRL),
-    REG_RW(INT_CTRL),
-    REG_RW(INT_CTRL),
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -1093,15 +2591,6 @@ uint16_t     BusInterface::test_data[32768] = {
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
 
-    XREG_SETW(AUD0_VOL, 0x2020),
-    XREG_SETW(AUD1_VOL, 0x2020),
-    XREG_SETW(AUD2_VOL, 0x2020),
-    XREG_SETW(AUD3_VOL, 0x2020),
-    XREG_SETW(AUD0_PERIOD, 0x8000 | PERIOD_TEST),
-    XREG_SETW(AUD1_PERIOD, 0x8000 | (PERIOD_TEST + 1)),
-    XREG_SETW(AUD2_PERIOD, 0x8000 | (PERIOD_TEST + 3)),
-    XREG_SETW(AUD3_PERIOD, 0x8000 | (PERIOD_TEST - 3)),
-
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -1113,8 +2602,6 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
-    // spam
-
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -2869,6 +4356,7 @@ uint16_t     BusInterface::test_data[32768] = {
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
 
+
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -3210,6 +4698,7 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -3221,8 +4710,6 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
-
-
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -4977,6 +6464,18 @@ uint16_t     BusInterface::test_data[32768] = {
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
 
+
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
+
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
+
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
+
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -5307,6 +6806,7 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -5329,8 +6829,17 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
+
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -5650,6 +7159,7 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -5672,7 +7182,17 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
+
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
+
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -5992,6 +7512,7 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -6025,7 +7546,17 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
+
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
+
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -6334,6 +7865,7 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -6378,7 +7910,17 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
+
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
+
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -6676,6 +8218,7 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -6731,7 +8274,17 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
+
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
+
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -7018,6 +8571,8 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+
+
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -7084,7 +8639,17 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
+
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
+
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -7349,6 +8914,7 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -7437,8 +9003,17 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
+
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -7692,6 +9267,7 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -7780,7 +9356,17 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
+
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
 
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
+
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -8034,6 +9620,7 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -8133,7 +9720,17 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
 
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
+
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
+
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -8376,6 +9973,7 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -8486,7 +10084,17 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
+
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
+
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -8718,6 +10326,7 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -8839,7 +10448,17 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD0_START, WAVE_TEST),
+
+    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD1_START, WAVE_TEST),
+
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
 
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
@@ -9060,676 +10679,2868 @@ uint16_t     BusInterface::test_data[32768] = {
 
     XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
     XREG_SETW(AUD3_START, WAVE_TEST),
+
+
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITHSYNC(),
+    REG_WAITHSYNC(),
+    REG_WAITHSYNC(),
+#if 0
+    REG_WAITVTOP(),
+    XREG_SETW(AUD0_PERIOD, 0x8000 | PERIOD_TEST),
     XREG_SETW(AUD0_LENGTH, WAVE_LEN),
     XREG_SETW(AUD0_START, WAVE_TEST),
 
+    XREG_SETW(AUD1_PERIOD, 0x8000 | (PERIOD_TEST * 2)),
     XREG_SETW(AUD1_LENGTH, WAVE_LEN),
     XREG_SETW(AUD1_START, WAVE_TEST),
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    XREG_SETW(AUD2_PERIOD, 0x8000 | (PERIOD_TEST * 3)),
+    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
+    XREG_SETW(AUD2_START, WAVE_TEST),
+
+    XREG_SETW(AUD3_PERIOD, 0x8000 | (PERIOD_TEST * 4)),
+    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
+    XREG_SETW(AUD3_START, WAVE_TEST),
+    XREG_SETW(VID_CTRL, 0x0001),
+
+    REG_WAITHSYNC(),
+    REG_WAITHSYNC(),
+    REG_WAITHSYNC(),
+    REG_WAITHSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+#endif
+    // XREG_SETW(AUD0_VOL, 0x2020),
+    // XREG_SETW(AUD1_VOL, 0x2020),
+    // XREG_SETW(AUD2_VOL, 0x2020),
+    // XREG_SETW(AUD3_VOL, 0x2020),
+
+    // XREG_SETW(AUD_CTRL, 0x0000),
+    // REG_WAITHSYNC(),
+    // REG_WAITHSYNC(),
+    // REG_WAITHSYNC(),
+    // REG_WAITHSYNC(),
+    // REG_WAITHSYNC(),
+    // XREG_SETW(AUD_CTRL, 0x000F),
+
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+
+    REG_RW(INT_CTRL),
+
+    // XREG_SETW(AUD0_VOL, 0x8040),
+    // XREG_SETW(AUD1_VOL, 0x8040),
+    // XREG_SETW(AUD2_VOL, 0x8040),
+    // XREG_SETW(AUD3_VOL, 0x0000),
+
+    // XREG_SETW(AUD_CTRL, 0x0000),
+    // REG_WAITHSYNC(),
+    // REG_WAITHSYNC(),
+    // REG_WAITHSYNC(),
+    // REG_WAITHSYNC(),
+    // REG_WAITHSYNC(),
+    // XREG_SETW(AUD_CTRL, 0x000F),
+
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+
+    // XREG_SETW(AUD0_VOL, 0x8040),
+    // XREG_SETW(AUD1_VOL, 0x8040),
+    // XREG_SETW(AUD2_VOL, 0x8040),
+    // XREG_SETW(AUD3_VOL, 0x8040),
+
+    // XREG_SETW(AUD_CTRL, 0x0000),
+    // REG_WAITHSYNC(),
+    // REG_WAITHSYNC(),
+    // REG_WAITHSYNC(),
+    // REG_WAITHSYNC(),
+    // REG_WAITHSYNC(),
+    // XREG_SETW(AUD_CTRL, 0x000F),
+
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+#if 0        // min vol test
+    XREG_SETW(AUD0_VOL, 0x0200),        // minimum
+    XREG_SETW(AUD1_VOL, 0x0000),
+    XREG_SETW(AUD2_VOL, 0x0000),
+    XREG_SETW(AUD3_VOL, 0x0000),
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    XREG_SETW(AUD_CTRL, 0x0000),
+    REG_WAITHSYNC(),
+    REG_WAITHSYNC(),
+    REG_WAITHSYNC(),
+    REG_WAITHSYNC(),
+    REG_WAITHSYNC(),
+    XREG_SETW(AUD_CTRL, 0x000F),
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+    REG_WAITVTOP(),
+    REG_WAITVSYNC(),
+#endif
+    XREG_SETW(AUD_CTRL, 0x0000),
+    REG_WAITHSYNC(),
+    REG_WAITHSYNC(),
+    REG_WAITHSYNC(),
+    REG_WAITHSYNC(),
+    REG_WAITHSYNC(),
+#endif
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    REG_W(INT_CTRL, 0x8100),
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    REG_END(),
+    // end test data
+};
+const uint16_t *      BusInterface::test_data     = BusInterface::builtin_test_data;
+size_t                BusInterface::test_data_len = NUM_ELEMENTS(BusInterface::builtin_test_data);
+std::vector<uint16_t> BusInterface::cmdline_test_data;
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+#if 0
+uint16_t     BusInterface::test_stfont[1024] = {REG_W(WR_ADDR, 0x3),
+                                          REG_W(WR_INC, 0x1),
+                                          REG_W(DATA, 0x0200 | 'H'),
+                                          REG_BL(DATA, 'e'),
+                                          REG_BL(DATA, 'l'),
+                                          REG_BL(DATA, 'l'),
+                                          REG_BL(DATA, 'o'),
+                                          REG_BL(DATA, '!'),
+                                          REG_W(WR_ADDR, 0x0),
+                                          REG_W(DATA, 0x0e00 | '\x0e'),
+                                          REG_W(DATA, 0x0e00 | '\x0f'),
+                                          REG_W(WR_ADDR, X_COLS * 5),
+                                          REG_W(DATA, 0x0200 | 'A'),
+                                          REG_BL(DATA, 't'),
+                                          REG_BL(DATA, 'a'),
+                                          REG_BL(DATA, 'r'),
+                                          REG_BL(DATA, 'i'),
+                                          REG_BL(DATA, ' '),
+                                          REG_BL(DATA, 'S'),
+                                          REG_BL(DATA, 'T'),
+                                          REG_BL(DATA, ' '),
+                                          REG_BL(DATA, '8'),
+                                          REG_BL(DATA, 'x'),
+                                          REG_BL(DATA, '1'),
+                                          REG_BL(DATA, '6'),
+                                          REG_BL(DATA, ' '),
+                                          REG_BL(DATA, 'F'),
+                                          REG_BL(DATA, 'o'),
+                                          REG_BL(DATA, 'n'),
+                                          REG_BL(DATA, 't'),
+                                          REG_BL(DATA, ' '),
+                                          REG_BL(DATA, 'T'),
+                                          REG_BL(DATA, 'e'),
+                                          REG_BL(DATA, 's'),
+                                          REG_BL(DATA, 't'),
+                                          REG_BL(DATA, ' '),
+                                          REG_BL(DATA, '\x1c'),
+                                          REG_BL(WR_INC, X_COLS - 1),
+                                          REG_BL(DATA, '\x1d'),
+                                          REG_BL(WR_INC, 1),
+                                          REG_BL(DATA, '\x1e'),
+                                          REG_BL(DATA, '\x1f'),
+                                          REG_END()};
+#endif
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+// Bus test script loaded at runtime (-script option) instead of compiled in test_data.
+//
+// Binary scripts (".bin" file extension) are memory-mapped little-endian 16-bit test_data words.
+// Text scripts use the same syntax as the compiled in test_data (so CopAsm ".vsim.h" output can be used),
+// a comma separated list of REG_xxx() macros or numeric expressions, with C comments,
+// "#define NAME [expression]", "#include "file"" and "#if expression"/"#ifdef NAME"/"#ifndef NAME"/"#else"/"#endif"
+// lines (in #if, "defined(NAME)" is supported and undefined names are 0, like C).  All xosera_m68k_defs.h names with
+// a value are predefined.
+class BusScript
+{
+    struct mapped_file_t
+    {
+        const char * data;
+        size_t       size;
+    };
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    std::vector<uint16_t>                words;
+    std::unordered_map<std::string, int> syms;
+    std::string                          file_name;
+    const char *                         pos;
+    const char *                         end;
+    int                                  line;
+    bool                                 in_if;        // evaluating #if (undefined names are 0)
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    static bool map_file(const char * name, mapped_file_t & mf)
+    {
+        int fd = open(name, O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            close(fd);
+            return false;
+        }
+        mf.size = st.st_size;
+        mf.data = mf.size ? static_cast<const char *>(mmap(nullptr, mf.size, PROT_READ, MAP_PRIVATE, fd, 0)) : "";
+        close(fd);
+        return mf.data != MAP_FAILED;
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    [[noreturn]] void fatal(const char * msg, const char * arg = "")
+    {
+        fprintf(stderr, "%s:%d: bus script error: %s%s\n", file_name.c_str(), line, msg, arg);
+        exit(EXIT_FAILURE);
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    void skip_space()
+    {
+        while (pos < end)
+        {
+            if (*pos == '\n')
+            {
+                line++;
+                pos++;
+            }
+            else if (isspace(*pos))
+            {
+                pos++;
+            }
+            else if (pos[0] == '/' && pos + 1 < end && pos[1] == '/')
+            {
+                while (pos < end && *pos != '\n')
+                {
+                    pos++;
+                }
+            }
+            else if (pos[0] == '/' && pos + 1 < end && pos[1] == '*')
+            {
+                pos += 2;
+                while (pos < end && !(pos[0] == '*' && pos + 1 < end && pos[1] == '/'))
+                {
+                    line += (*pos++ == '\n');
+                }
+                pos += 2;
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    bool match(const char * op)
+    {
+        skip_space();
+        size_t len = strlen(op);
+        if (static_cast<size_t>(end - pos) >= len && memcmp(pos, op, len) == 0)
+        {
+            pos += len;
+            return true;
+        }
+        return false;
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    void expect(const char * op)
+    {
+        if (!match(op))
+        {
+            fatal("expected ", op);
+        }
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    std::string ident()
+    {
+        skip_space();
+        const char * start = pos;
+        while (pos < end && (isalnum(*pos) || *pos == '_'))
+        {
+            pos++;
+        }
+        return std::string(start, pos - start);
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    int symbol(const std::string & name)
+    {
+        auto it = syms.find(name);
+        if (it == syms.end())
+        {
+            if (in_if)
+            {
+                return 0;
+            }
+            fatal("undefined symbol ", name.c_str());
+        }
+        return it->second;
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    // true if rest of directive line is empty (e.g., "#define NAME" with no value)
+    bool at_eol()
+    {
+        const char * p = pos;
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        {
+            p++;
+        }
+        return p >= end || *p == '\n' || (p[0] == '/' && p + 1 < end && p[1] == '/');
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    int primary()
+    {
+        skip_space();
+        if (pos >= end)
+        {
+            fatal("unexpected end of file");
+        }
+        if (match("("))
+        {
+            int v = expr();
+            expect(")");
+            return v;
+        }
+        if (match("-"))
+        {
+            return -primary();
+        }
+        if (match("~"))
+        {
+            return ~primary();
+        }
+        if (match("!"))
+        {
+            return !primary();
+        }
+        if (*pos == '\'')
+        {
+            int v = 0;
+            pos++;
+            if (pos < end && *pos == '\\')
+            {
+                char * endptr = nullptr;
+                pos++;
+                switch (pos < end ? *pos : 0)
+                {
+                    case 'x':
+                        v = strtol(pos + 1, &endptr, 16);
+                        break;
+                    case 'n':
+                        v = '\n';
+                        break;
+                    case 't':
+                        v = '\t';
+                        break;
+                    case '0':
+                        v = strtol(pos, &endptr, 8);
+                        break;
+                    default:
+                        v = *pos;
+                        break;
+                }
+                pos = endptr ? endptr : pos + 1;
+            }
+            else if (pos < end)
+            {
+                v = static_cast<uint8_t>(*pos++);
+            }
+            expect("'");
+            return v;
+        }
+        if (isdigit(*pos))
+        {
+            char * endptr = nullptr;
+            long   v      = strtol(pos, &endptr, 0);
+            pos           = endptr;
+            while (pos < end && (*pos == 'u' || *pos == 'U' || *pos == 'l' || *pos == 'L'))
+            {
+                pos++;
+            }
+            return static_cast<int>(v);
+        }
+        std::string name = ident();
+        if (name.empty())
+        {
+            fatal("expected expression");
+        }
+        if (name == "defined" && in_if)
+        {
+            bool paren = match("(");
+            name       = ident();
+            if (name.empty() || (paren && !match(")")))
+            {
+                fatal("expected defined(NAME)");
+            }
+            return syms.count(name) != 0;
+        }
+        return symbol(name);
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    // binary operators, lowest to highest precedence (as C, but both sides of "||" and "&&" are evaluated)
+    int expr(int level = 0)
+    {
+        static const char * ops[][4] = {{"||", nullptr},
+                                        {"&&", nullptr},
+                                        {"|", nullptr},
+                                        {"^", nullptr},
+                                        {"&", nullptr},
+                                        {"==", "!=", nullptr},
+                                        {"<=", ">=", "<", ">"},
+                                        {"<<", ">>", nullptr},
+                                        {"+", "-", nullptr},
+                                        {"*", "/", "%", nullptr}};
+        if (level >= static_cast<int>(NUM_ELEMENTS(ops)))
+        {
+            return primary();
+        }
+        int v = expr(level + 1);
+        for (;;)
+        {
+            skip_space();
+            int op = -1;
+            for (int i = 0; i < 4 && ops[level][i] != nullptr; i++)
+            {
+                size_t len = strlen(ops[level][i]);
+                // don't mistake "||", "&&", "<<", ">>", "<=", ">=" or "==" for single character operators
+                if (static_cast<size_t>(end - pos) >= len && memcmp(pos, ops[level][i], len) == 0 &&
+                    !(len == 1 && pos + 1 < end && (pos[1] == pos[0] || pos[1] == '=')))
+                {
+                    op = i;
+                    pos += len;
+                    break;
+                }
+            }
+            if (op < 0)
+            {
+                return v;
+            }
+            int r = expr(level + 1);
+            switch (level * 4 + op)
+            {
+                case 0:
+                    v = v || r;
+                    break;
+                case 4:
+                    v = v && r;
+                    break;
+                case 8:
+                    v |= r;
+                    break;
+                case 12:
+                    v ^= r;
+                    break;
+                case 16:
+                    v &= r;
+                    break;
+                case 20:
+                    v = v == r;
+                    break;
+                case 21:
+                    v = v != r;
+                    break;
+                case 24:
+                    v = v <= r;
+                    break;
+                case 25:
+                    v = v >= r;
+                    break;
+                case 26:
+                    v = v < r;
+                    break;
+                case 27:
+                    v = v > r;
+                    break;
+                case 28:
+                    v <<= r;
+                    break;
+                case 29:
+                    v >>= r;
+                    break;
+                case 32:
+                    v += r;
+                    break;
+                case 33:
+                    v -= r;
+                    break;
+                case 36:
+                    v *= r;
+                    break;
+                default:
+                    if (r == 0)
+                    {
+                        fatal("divide by zero");
+                    }
+                    v = (op == 1) ? v / r : v % r;
+                    break;
+            }
+        }
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    // register name argument, with or without prefix (e.g., "WR_XADDR" or "XM_WR_XADDR")
+    int reg_arg(const char * prefix)
+    {
+        skip_space();
+        const char * save = pos;
+        std::string  name = ident();
+        if (!name.empty() && syms.count(prefix + name))
+        {
+            return syms[prefix + name];
+        }
+        pos = save;
+        return expr();
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    void emit_reg_w(int r, int v)
+    {
+        words.push_back((r << 8) | ((v >> 8) & 0xff));
+        words.push_back(((r | 0x10) << 8) | (v & 0xff));
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    void emit_reg_rw(int r)
+    {
+        words.push_back((r | 0x80) << 8);
+        words.push_back((r | 0x90) << 8);
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    // skip lines of a false #if (or #else of a true one), until matching #else (if allowed) or #endif
+    void skip_block(bool allow_else)
+    {
+        int depth = 0;
+        while (pos < end)
+        {
+            skip_space();
+            if (match("#"))
+            {
+                std::string dir = ident();
+                if (dir == "if" || dir == "ifdef" || dir == "ifndef")
+                {
+                    depth++;
+                }
+                else if (dir == "endif" && depth-- == 0)
+                {
+                    return;
+                }
+                else if (dir == "else" && depth == 0 && allow_else)
+                {
+                    return;
+                }
+            }
+            while (pos < end && *pos != '\n')
+            {
+                pos++;
+            }
+        }
+        fatal("missing #endif");
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    void directive()
+    {
+        std::string dir = ident();
+        if (dir == "if")
+        {
+            in_if = true;
+            int v = expr();
+            in_if = false;
+            if (v == 0)
+            {
+                skip_block(true);
+            }
+        }
+        else if (dir == "ifdef" || dir == "ifndef")
+        {
+            std::string name = ident();
+            if (name.empty())
+            {
+                fatal("expected name after #", dir.c_str());
+            }
+            if ((syms.count(name) != 0) != (dir == "ifdef"))
+            {
+                skip_block(true);
+            }
+        }
+        else if (dir == "else")
+        {
+            skip_block(false);
+        }
+        else if (dir == "endif")
+        {
+        }
+        else if (dir == "define")
+        {
+            std::string name = ident();
+            if (name.empty())
+            {
+                fatal("#define needs name");
+            }
+            syms[name] = at_eol() ? 1 : expr();
+        }
+        else if (dir == "include" && match("<"))
+        {
+            // system header (e.g., <stdint.h>), ignored
+            while (pos < end && *pos != '\n')
+            {
+                pos++;
+            }
+        }
+        else if (dir == "include")
+        {
+            skip_space();
+            const char * start = ++pos;
+            while (pos < end && *pos != '"' && *pos != '\n')
+            {
+                pos++;
+            }
+            std::string name(start, pos - start);
+            expect("\"");
+            // include path is relative to including file
+            size_t slash = file_name.rfind('/');
+            if (name[0] != '/' && slash != std::string::npos)
+            {
+                name = file_name.substr(0, slash + 1) + name;
+            }
+            load_text(name.c_str());
+        }
+        else if (dir == "pragma")
+        {
+            while (pos < end && *pos != '\n')
+            {
+                pos++;
+            }
+        }
+        else
+        {
+            fatal("unsupported directive #", dir.c_str());
+        }
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    void item()
+    {
+        skip_space();
+        const char * save = pos;
+        std::string  name = ident();
+        if (!name.empty() && match("("))
+        {
+            if (name == "REG_BH" || name == "REG_BL")
+            {
+                int r = reg_arg("XM_");
+                expect(",");
+                int v = expr();
+                words.push_back(((r | (name == "REG_BL" ? 0x10 : 0x00)) << 8) | (v & 0xff));
+            }
+            else if (name == "REG_W")
+            {
+                int r = reg_arg("XM_");
+                expect(",");
+                emit_reg_w(r, expr());
+            }
+            else if (name == "REG_RW")
+            {
+                emit_reg_rw(reg_arg("XM_"));
+            }
+            else if (name == "XREG_SETW" || name == "XMEM_SETW")
+            {
+                int xr = name == "XREG_SETW" ? reg_arg("XR_") : expr();
+                expect(",");
+                emit_reg_w(XM_WR_XADDR, xr);
+                emit_reg_w(XM_XDATA, expr());
+            }
+            else if (name == "XREG_GETW")
+            {
+                emit_reg_w(XM_RD_XADDR, reg_arg("XR_"));
+                emit_reg_rw(XM_XDATA);
+            }
+            else if (name == "REG_UPLOAD")
+            {
+                words.push_back(0xfff0);
+            }
+            else if (name == "REG_UPLOAD_AUX")
+            {
+                words.push_back(0xfff1);
+            }
+            else if (name == "REG_WAITHSYNC")
+            {
+                words.push_back(0xfffa);
+            }
+            else if (name == "REG_SNAPSHOT")
+            {
+                words.push_back(0xfff9);
+            }
+            else if (name == "REG_WAIT_BLIT_READY" || name == "REG_WAIT_BLIT_DONE")
+            {
+                words.push_back((XM_SYS_CTRL | 0x80) << 8);
+                words.push_back(name == "REG_WAIT_BLIT_READY" ? 0xfffc : 0xfffb);
+            }
+            else if (name == "REG_WAITVTOP")
+            {
+                words.push_back(0xfffd);
+            }
+            else if (name == "REG_WAITVSYNC")
+            {
+                words.push_back(0xfffe);
+            }
+            else if (name == "REG_END")
+            {
+                words.push_back(0xffff);
+            }
+            else
+            {
+                fatal("unknown macro ", name.c_str());
+            }
+            expect(")");
+        }
+        else
+        {
+            pos = save;
+            words.push_back(expr() & 0xffff);
+        }
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    void load_text(const char * name)
+    {
+        mapped_file_t mf;
+        if (!map_file(name, mf))
+        {
+            fatal("can't read ", name);
+        }
+        std::string  save_name = file_name;
+        const char * save_pos  = pos;
+        const char * save_end  = end;
+        int          save_line = line;
+        file_name              = name;
+        pos                    = mf.data;
+        end                    = mf.data + mf.size;
+        line                   = 1;
+
+        for (skip_space(); pos < end; skip_space())
+        {
+            if (match("#"))
+            {
+                directive();
+            }
+            else
+            {
+                item();
+                match(",");
+            }
+        }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+        munmap(const_cast<char *>(mf.data), mf.size);
+        file_name = save_name;
+        pos       = save_pos;
+        end       = save_end;
+        line      = save_line;
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+public:
+    BusScript()
+        : pos(nullptr)
+        , end(nullptr)
+        , line(0)
+        , in_if(false)
+    {
+        // every xosera_m68k_defs.h #define with a value (generated by sim.mk), and its include guard (so a script can
+        // #include it, without needing to understand the rest of it)
+#define SCRIPT_SYM(s) syms[#s] = (s)
+#include "xosera_m68k_defs_syms.h"
+        syms["XOSERA_M68K_DEFS_H"] = 1;
+        // video mode and test_data names
+        SCRIPT_SYM(VISIBLE_WIDTH);
+        SCRIPT_SYM(VISIBLE_HEIGHT);
+        SCRIPT_SYM(TOTAL_WIDTH);
+        SCRIPT_SYM(TOTAL_HEIGHT);
+        SCRIPT_SYM(OFFSCREEN_WIDTH);
+        SCRIPT_SYM(OFFSCREEN_HEIGHT);
+        SCRIPT_SYM(X_COLS);
+        SCRIPT_SYM(W_4BPP);
+        SCRIPT_SYM(H_4BPP);
+        SCRIPT_SYM(W_LOGO);
+        SCRIPT_SYM(H_LOGO);
+#undef SCRIPT_SYM
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    // load script file and make it the bus test_data (exits on error)
+    void load(const char * name)
+    {
+        size_t len = strlen(name);
+        if (len > 4 && strcmp(name + len - 4, ".bin") == 0)
+        {
+            mapped_file_t mf;
+            file_name = name;
+            if (!map_file(name, mf) || (mf.size & 1) || mf.size == 0)
+            {
+                fatal("can't map binary script (or odd/zero size)");
+            }
+            const uint16_t * mw = reinterpret_cast<const uint16_t *>(mf.data);
+            size_t           mn = mf.size / 2;
+            if (mw[mn - 1] == 0xffff)
+            {
+                // used directly from mapping (stays mapped until exit)
+                bus.set_test_data(mw, mn);
+                logonly_printf("Mapped binary bus script \"%s\" (%zu words)\n", name, mn);
+                return;
+            }
+            words.assign(mw, mw + mn);
+            munmap(const_cast<char *>(mf.data), mf.size);
+        }
+        else
+        {
+            load_text(name);
+        }
+        if (words.empty() || words.back() != 0xffff)
+        {
+            words.push_back(0xffff);        // REG_END
+        }
+        bus.set_test_data(words.data(), words.size());
+        logonly_printf("Loaded bus script \"%s\" (%zu words)\n", name, words.size());
+    }
+};
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+// -trace trigger conditions (dump trace windows around events, instead of the first MAX_TRACE_FRAMES frames)
+enum
+{
+    TRIG_FRAME,        // frame range
+    TRIG_LINE,         // scanline range (in every frame, or one frame)
+    TRIG_REG,          // host bus write to register
+    TRIG_INTR,         // bus_intr_o rising edge
+    TRIG_VRAM,         // VRAM read/write (any unit) within address range
+};
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+struct trace_trigger_t
+{
+    int type;
+    int lo;           // range start (or register number)
+    int hi;           // range end (inclusive)
+    int frame;        // TRIG_LINE frame (or -1 for every frame)
+};
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+std::vector<trace_trigger_t> trace_triggers;
+int                          trace_pre_lines  = 0;         // pre-trigger ring scanlines (-trace_pre)
+int                          trace_post_lines = 16;        // scanlines dumped after an event trigger (-trace_post)
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+// parse "<lo>[-<hi>]" number range, returns pointer after range (or nullptr on error)
+static const char * parse_trace_range(const char * str, int & lo, int & hi)
+{
+    char * endptr = nullptr;
+    lo            = static_cast<int>(strtol(str, &endptr, 0));
+    hi            = lo;
+    if (endptr == str)
+    {
+        return nullptr;
+    }
+    if (*endptr == '-')
+    {
+        str = endptr + 1;
+        hi  = static_cast<int>(strtol(str, &endptr, 0));
+        if (endptr == str || hi < lo)
+        {
+            return nullptr;
+        }
+    }
+    return endptr;
+}
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+// parse -trace trigger spec (returns false if invalid)
+static bool parse_trace_trigger(const char * spec)
+{
+    trace_trigger_t trig = {TRIG_FRAME, 0, 0, -1};
+    const char *    end  = nullptr;
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    if (strncmp(spec, "frame:", 6) == 0)
+    {
+        trig.type = TRIG_FRAME;
+        end       = parse_trace_range(spec + 6, trig.lo, trig.hi);
+    }
+    else if (strncmp(spec, "line:", 5) == 0)
+    {
+        trig.type = TRIG_LINE;
+        end       = parse_trace_range(spec + 5, trig.lo, trig.hi);
+        if (end != nullptr && *end == '@')
+        {
+            char * endptr = nullptr;
+            trig.frame    = static_cast<int>(strtol(end + 1, &endptr, 0));
+            end           = endptr != end + 1 ? endptr : nullptr;
+        }
+    }
+    else if (strncmp(spec, "reg:", 4) == 0)
+    {
+        char * endptr = nullptr;
+        trig.type     = TRIG_REG;
+        trig.lo       = static_cast<int>(strtol(spec + 4, &endptr, 0));
+        if (endptr == spec + 4 || *endptr != '\0')
+        {
+            trig.lo = BusInterface::find_reg(spec + 4);
+        }
+        end = (trig.lo >= 0 && trig.lo < 16) ? spec + strlen(spec) : nullptr;
+    }
+    else if (strcmp(spec, "intr") == 0)
+    {
+        trig.type = TRIG_INTR;
+        end       = spec + strlen(spec);
+    }
+    else if (strncmp(spec, "vram:", 5) == 0)
+    {
+#if SIM_PROFILE
+        trig.type = TRIG_VRAM;
+        end       = parse_trace_range(spec + 5, trig.lo, trig.hi);
+#else
+        printf("-trace vram: needs simulation built with PROFILE=1\n");
+        exit(EXIT_FAILURE);
+#endif
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
+    if (end == nullptr || *end != '\0')
+    {
+        return false;
+    }
+    trace_triggers.push_back(trig);
+    return true;
+}
 
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+#if VM_TRACE
+#if USE_FST
+typedef VerilatedFstC trace_file_t;
+#define TRACE_EXT ".fst"
+#else
+typedef VerilatedVcdC trace_file_t;
+#define TRACE_EXT ".vcd"
+#endif
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+// Trace file control for -trace triggers.  Dumping is only done while a trigger window is active (frame/line range
+// matches, or within trace_post_lines of a reg/intr/vram event).  With trace_pre_lines, dumping continues into a ring
+// of two segment files (rotated every trace_pre_lines scanlines), and when a window starts the current segment
+// continues as the window file and the previous one is kept as its pre-trigger history.
+class TraceWindow
+{
+    trace_file_t * tfp;
+    bool           tracing;           // trace segment file open
+    bool           active;            // inside trigger window
+    bool           last_intr;         // previous bus_intr_o (for edge)
+    int            event_lines;       // scanlines left to dump after last event trigger
+    int            ring_lines;        // scanlines in current pre-trigger ring segment
+    int            segment;           // current segment file number
+    int            prev_segment;      // previous pre-trigger ring segment (or -1)
+    int            window_num;        // number of trigger windows
+    int            window_pre;        // pre-trigger segment for current window (or -1)
+
+    static void segment_name(char * name, size_t name_size, int seg)
+    {
+        snprintf(name, name_size, LOGDIR "xosera_vsim_seg%04d" TRACE_EXT, seg);
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    void open_segment()
+    {
+        char name[256];
+        segment_name(name, sizeof(name), ++segment);
+        tfp->open(name);
+        tracing    = true;
+        ring_lines = 0;
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    void remove_segment(int seg)
+    {
+        char name[256];
+        segment_name(name, sizeof(name), seg);
+        unlink(name);
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    void start_window(const char * why, int frame_num, int line)
+    {
+        window_num++;
+        active     = true;
+        window_pre = -1;
+        if (tracing)
+        {
+            window_pre   = prev_segment;        // keep pre-trigger history
+            prev_segment = -1;
+        }
+        else
+        {
+            open_segment();
+        }
+        logonly_printf(
+            "[@t=%8lu] Trace window #%d started, frame %d line %d (%s)\n", main_time, window_num, frame_num, line, why);
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    void end_window(int frame_num, int line, bool restart)
+    {
+        char seg_name[256];
+        char win_name[256];
+        tfp->close();
+        tracing = false;
+        active  = false;
+
+        segment_name(seg_name, sizeof(seg_name), segment);
+        snprintf(win_name, sizeof(win_name), LOGDIR "xosera_vsim_w%02d" TRACE_EXT, window_num);
+        rename(seg_name, win_name);
+        logonly_printf("[@t=%8lu] Trace window #%d ended, frame %d line %d, saved \"%s\"",
+                       main_time,
+                       window_num,
+                       frame_num,
+                       line,
+                       win_name);
+        if (window_pre >= 0)
+        {
+            segment_name(seg_name, sizeof(seg_name), window_pre);
+            snprintf(win_name, sizeof(win_name), LOGDIR "xosera_vsim_w%02d_pre" TRACE_EXT, window_num);
+            rename(seg_name, win_name);
+            logonly_printf(" (pre-trigger \"%s\")", win_name);
+        }
+        logonly_printf("\n");
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+        if (restart && trace_pre_lines > 0)
+        {
+            open_segment();
+        }
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+public:
+    TraceWindow()
+        : tfp(nullptr)
+        , tracing(false)
+        , active(false)
+        , last_intr(false)
+        , event_lines(0)
+        , ring_lines(0)
+        , segment(0)
+        , prev_segment(-1)
+        , window_num(0)
+        , window_pre(-1)
+    {
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    void init(trace_file_t * _tfp)
+    {
+        tfp = _tfp;
+        if (trace_pre_lines > 0)
+        {
+            open_segment();
+        }
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    bool dumping() const
+    {
+        return tracing;
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    // check event triggers (each pixel clock)
+    void check_events(Vxosera_main * top, int frame_num, int line)
+    {
+        int         write_reg = bus.get_write_reg();
+        bool        intr_edge = top->bus_intr_o && !last_intr;
+        const char * why      = nullptr;
+        last_intr             = top->bus_intr_o;
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+        for (auto & trig : trace_triggers)
+        {
+            if (trig.type == TRIG_REG && write_reg == trig.lo)
+            {
+                why = "register write";
+            }
+            else if (trig.type == TRIG_INTR && intr_edge)
+            {
+                why = "interrupt";
+            }
+#if SIM_PROFILE
+            else if (trig.type == TRIG_VRAM)
+            {
+                auto arb  = XOSERA_MAIN(top)->vram_arb;
+                bool sel  = arb->vgen_sel_i || (arb->regs_sel_i && !arb->regs_ack_o) ||
+                           (arb->blit_sel_i && !arb->blit_ack_o);
+                if (sel && arb->vram_addr >= trig.lo && arb->vram_addr <= trig.hi)
+                {
+                    why = arb->vram_wr ? "VRAM write" : "VRAM read";
+                }
+            }
+#endif
+        }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+        if (why != nullptr)
+        {
+            if (!active)
+            {
+                start_window(why, frame_num, line);
+            }
+            event_lines = trace_post_lines + 1;
+        }
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    // check range triggers and pre-trigger ring (each scanline)
+    void scanline(int frame_num, int line)
+    {
+        bool in_range = false;
+        for (auto & trig : trace_triggers)
+        {
+            if ((trig.type == TRIG_FRAME && frame_num >= trig.lo && frame_num <= trig.hi) ||
+                (trig.type == TRIG_LINE && line >= trig.lo && line <= trig.hi &&
+                 (trig.frame < 0 || trig.frame == frame_num)))
+            {
+                in_range = true;
+            }
+        }
+        if (event_lines > 0)
+        {
+            event_lines--;
+        }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+        if (!active && in_range)
+        {
+            start_window("frame/line range", frame_num, line);
+        }
+        else if (active && !in_range && event_lines == 0)
+        {
+            end_window(frame_num, line, true);
+        }
+        else if (!active && tracing && ++ring_lines >= trace_pre_lines)
+        {
+            // rotate pre-trigger ring segments
+            tfp->close();
+            if (prev_segment >= 0)
+            {
+                remove_segment(prev_segment);
+            }
+            prev_segment = segment;
+            open_segment();
+        }
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    void finish(int frame_num, int line)
+    {
+        if (active)
+        {
+            end_window(frame_num, line, false);
+        }
+        else if (tracing)
+        {
+            tfp->close();
+            tracing = false;
+            remove_segment(segment);
+        }
+        if (prev_segment >= 0)
+        {
+            remove_segment(prev_segment);
+        }
+        logonly_printf("Trace windows saved: %d\n", window_num);
+    }
+};
+#endif
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+// VRAM arbitration profiler (-vprof option)
+//
+// Counts VRAM cycles granted to each requester (and cycles waiting for VRAM) per scanline and per frame, using the
+// vram_arb priority order (video gen, then register interface, then blitter; audio DMA uses the video gen select).
+// Writes per-scanline CSV, per-frame JSON summary and a per-pixel-clock heatmap image (PPM) of which requester used
+// VRAM (blue video, yellow audio, green registers, red blitter, brightness is fraction of profiled frames).
+class VramProfiler
+{
+public:
+    enum
+    {
+        VP_VIDEO,
+        VP_AUDIO,
+        VP_REGS,
+        VP_BLIT,
+        VP_IDLE,
+        VP_AUDIO_WAIT,
+        VP_REGS_WAIT,
+        VP_BLIT_WAIT,
+        VP_NUM_COUNTS
+    };
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+private:
+    static const char * count_name[VP_NUM_COUNTS];
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    struct frame_counts_t
+    {
+        int      frame_num;
+        uint64_t count[VP_NUM_COUNTS];
+    };
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    uint32_t                    line_count[TOTAL_HEIGHT][VP_NUM_COUNTS];        // current frame per scanline
+    uint16_t (*heatmap)[TOTAL_WIDTH][VP_IDLE];                                  // granted count per pixel clock
+    std::vector<frame_counts_t> frames;
+    FILE *                      csv_fp;
+    int                         num_frames;
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+public:
+    VramProfiler()
+        : heatmap(nullptr)
+        , csv_fp(nullptr)
+        , num_frames(0)
+    {
+        memset(line_count, 0, sizeof(line_count));
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    void init()
+    {
+        heatmap = new uint16_t[TOTAL_HEIGHT][TOTAL_WIDTH][VP_IDLE]();
+        csv_fp  = fopen(LOGDIR "xosera_vsim_vram_prof.csv", "w");
+        if (csv_fp == nullptr)
+        {
+            fprintf(stderr, "Creating VRAM profile \"%s\" error ", LOGDIR "xosera_vsim_vram_prof.csv");
+            perror("fopen failed");
+            exit(EXIT_FAILURE);
+        }
+        fprintf(csv_fp, "frame,line");
+        for (int c = 0; c < VP_NUM_COUNTS; c++)
+        {
+            fprintf(csv_fp, ",%s", count_name[c]);
+        }
+        fprintf(csv_fp, "\n");
+        logonly_printf("Writing VRAM profile to \"" LOGDIR "xosera_vsim_vram_prof.csv\"...\n");
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    // count VRAM use for this pixel clock (after rising edge eval, needs PROFILE=1 public signals)
+    void cycle(Vxosera_main * top, int x, int y)
+    {
+#if SIM_PROFILE
+        if (x >= TOTAL_WIDTH || y >= TOTAL_HEIGHT)
+        {
+            return;
+        }
+        auto arb      = XOSERA_MAIN(top)->vram_arb;
+        auto vgen     = XOSERA_MAIN(top)->video_gen;
+        bool regs_req = arb->regs_sel_i && !arb->regs_ack_o;
+        bool blit_req = arb->blit_sel_i && !arb->blit_ack_o;
+        int  grant    = VP_IDLE;
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+        if (arb->vgen_sel_i)
+        {
+            grant = vgen->audio_vram_sel ? VP_AUDIO : VP_VIDEO;
+        }
+        else if (regs_req)
+        {
+            grant = VP_REGS;
+        }
+        else if (blit_req)
+        {
+            grant = VP_BLIT;
+        }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+        uint32_t * lc = line_count[y];
+        lc[grant]++;
+        if (grant != VP_IDLE)
+        {
+            heatmap[y][x][grant]++;
+        }
+        if (vgen->audio_vram_req && grant != VP_AUDIO)
+        {
+            lc[VP_AUDIO_WAIT]++;
+        }
+        if (regs_req && grant != VP_REGS)
+        {
+            lc[VP_REGS_WAIT]++;
+        }
+        if (blit_req && grant != VP_BLIT)
+        {
+            lc[VP_BLIT_WAIT]++;
+        }
+#endif
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    // write scanline counts for completed frame and add to frame summary
+    void end_frame(int frame_num)
+    {
+        frame_counts_t fc = {frame_num, {0}};
+        for (int y = 0; y < TOTAL_HEIGHT; y++)
+        {
+            fprintf(csv_fp, "%d,%d", frame_num, y);
+            for (int c = 0; c < VP_NUM_COUNTS; c++)
+            {
+                fprintf(csv_fp, ",%u", line_count[y][c]);
+                fc.count[c] += line_count[y][c];
+            }
+            fprintf(csv_fp, "\n");
+        }
+        memset(line_count, 0, sizeof(line_count));
+        frames.push_back(fc);
+        num_frames++;
+
+        uint64_t total = fc.count[VP_VIDEO] + fc.count[VP_AUDIO] + fc.count[VP_REGS] + fc.count[VP_BLIT] +
+                         fc.count[VP_IDLE];
+        logonly_printf("VRAM profile frame %d: video %.1f%% audio %.1f%% regs %.1f%% blit %.1f%% idle %.1f%% "
+                       "(waits: audio %lu regs %lu blit %lu)\n",
+                       frame_num,
+                       100.0 * fc.count[VP_VIDEO] / total,
+                       100.0 * fc.count[VP_AUDIO] / total,
+                       100.0 * fc.count[VP_REGS] / total,
+                       100.0 * fc.count[VP_BLIT] / total,
+                       100.0 * fc.count[VP_IDLE] / total,
+                       fc.count[VP_AUDIO_WAIT],
+                       fc.count[VP_REGS_WAIT],
+                       fc.count[VP_BLIT_WAIT]);
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    void finish()
+    {
+        fclose(csv_fp);
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+        // JSON per-frame and total summary
+        FILE * fp = fopen(LOGDIR "xosera_vsim_vram_prof.json", "w");
+        if (fp != nullptr)
+        {
+            uint64_t total[VP_NUM_COUNTS] = {0};
+            fprintf(fp,
+                    "{\n  \"mode\": \"%dx%d\",\n  \"total_width\": %d,\n  \"total_height\": %d,\n  \"frames\": [\n",
+                    VISIBLE_WIDTH,
+                    VISIBLE_HEIGHT,
+                    TOTAL_WIDTH,
+                    TOTAL_HEIGHT);
+            for (size_t f = 0; f < frames.size(); f++)
+            {
+                fprintf(fp, "    {\"frame\": %d", frames[f].frame_num);
+                for (int c = 0; c < VP_NUM_COUNTS; c++)
+                {
+                    fprintf(fp, ", \"%s\": %lu", count_name[c], frames[f].count[c]);
+                    total[c] += frames[f].count[c];
+                }
+                fprintf(fp, "}%s\n", f + 1 < frames.size() ? "," : "");
+            }
+            fprintf(fp, "  ],\n  \"total\": {\"frames\": %d", num_frames);
+            for (int c = 0; c < VP_NUM_COUNTS; c++)
+            {
+                fprintf(fp, ", \"%s\": %lu", count_name[c], total[c]);
+            }
+            fprintf(fp, "}\n}\n");
+            fclose(fp);
+        }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+        // heatmap of VRAM use per pixel clock (scanline rows)
+        fp = fopen(LOGDIR "xosera_vsim_vram_heatmap.ppm", "wb");
+        if (fp != nullptr && num_frames > 0)
+        {
+            // requester colors video, audio, regs, blit
+            static const uint8_t colors[VP_IDLE][3] = {{0, 0, 255}, {255, 255, 0}, {0, 255, 0}, {255, 0, 0}};
+            std::vector<uint8_t> row(TOTAL_WIDTH * 3);
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+            fprintf(fp, "P6\n%d %d\n255\n", TOTAL_WIDTH, TOTAL_HEIGHT);
+            for (int y = 0; y < TOTAL_HEIGHT; y++)
+            {
+                for (int x = 0; x < TOTAL_WIDTH; x++)
+                {
+                    for (int ch = 0; ch < 3; ch++)
+                    {
+                        uint32_t v = 0;
+                        for (int r = 0; r < VP_IDLE; r++)
+                        {
+                            v += heatmap[y][x][r] * colors[r][ch];
+                        }
+                        row[x * 3 + ch] = static_cast<uint8_t>(std::min(v / num_frames, 255u));
+                    }
+                }
+                fwrite(row.data(), 1, row.size(), fp);
+            }
+        }
+        if (fp != nullptr)
+        {
+            fclose(fp);
+        }
+        delete[] heatmap;
+        heatmap = nullptr;
+        log_printf("VRAM profile for %d frames saved as \"" LOGDIR "xosera_vsim_vram_prof.csv/.json\" and \"" LOGDIR
+                   "xosera_vsim_vram_heatmap.ppm\"\n",
+                   num_frames);
+    }
+};
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+const char * VramProfiler::count_name[VramProfiler::VP_NUM_COUNTS] =
+    {"video", "audio", "regs", "blit", "idle", "audio_wait", "regs_wait", "blit_wait"};
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+// Copper execution profiler (-cprof option)
+//
+// Follows copper_slim execution each pixel clock: the copper address of the executing opcode, cycles until the next
+// opcode is loaded (split into execute, HPOS/VPOS wait and XR bus write wait) and HPOS/VPOS waits that were already
+// past when reached ("late", e.g., a scanline overrun). Writes per-scanline totals (all frames), a per-scanline
+// timeline for one frame and a per-instruction cycle histogram annotated with CopAsm listing lines (-cprof_lst).
+class CopperProfiler
+{
+    enum
+    {
+        ST_FETCH  = 0,        // copper_slim copp_ex_state_t
+        ST_DECODE = 1,
+    };
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    enum
+    {
+        CP_EXEC,
+        CP_WAIT_H,
+        CP_WAIT_V,
+        CP_XR_WAIT,
+        CP_NUM_KINDS
+    };
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    static const char * kind_name[CP_NUM_KINDS];
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    static const int COPPER_WORDS = 2048;        // 11-bit copper address
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    struct op_stats_t
+    {
+        uint16_t opcode;
+        uint64_t count;                      // times executed
+        uint64_t cycles[CP_NUM_KINDS];        // cycles spent
+        uint64_t late;                       // HPOS/VPOS already past when reached
+    };
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    struct listing_line_t
+    {
+        std::string file;
+        int         line;
+        std::string text;
+    };
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    op_stats_t                                   ops[COPPER_WORDS];
+    std::unordered_map<int, listing_line_t>      listing;        // copper address to CopAsm listing line
+    uint32_t                                     line_cycles[CP_NUM_KINDS + 1];
+    int                                          prev_state;
+    int                                          cur_addr;
+    int                                          run_addr;
+    int                                          run_kind;
+    int                                          run_line;
+    int                                          run_start;
+    int                                          run_cycles;
+    int                                          timeline_frame;
+    FILE *                                       lines_fp;
+    FILE *                                       timeline_fp;
+
+    static const char * op_name(uint16_t op)
+    {
+        static const char * names[8] = {"SETI", "SETI", "SETM", "SETM", "HPOS", "VPOS", "BRGE", "BRLT"};
+        return names[(op >> 11) & 7];
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    void timeline_flush()
+    {
+        if (run_cycles)
+        {
+            fprintf(timeline_fp,
+                    "%d,%d,%d,0x%04x,%s,%d,%s\n",
+                    timeline_frame,
+                    run_line,
+                    run_start,
+                    XR_COPPER_ADDR + run_addr,
+                    op_name(ops[run_addr].opcode),
+                    run_cycles,
+                    kind_name[run_kind]);
+        }
+        run_cycles = 0;
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+public:
+    CopperProfiler()
+        : prev_state(ST_FETCH)
+        , cur_addr(-1)
+        , run_addr(0)
+        , run_kind(CP_EXEC)
+        , run_line(0)
+        , run_start(0)
+        , run_cycles(0)
+        , timeline_frame(1)
+        , lines_fp(nullptr)
+        , timeline_fp(nullptr)
+    {
+        memset(ops, 0, sizeof(ops));
+        memset(line_cycles, 0, sizeof(line_cycles));
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    // read CopAsm listing (-l output) to map copper addresses to source lines
+    void read_listing(const char * name)
+    {
+        FILE * fp = fopen(name, "r");
+        if (fp == nullptr)
+        {
+            fprintf(stderr, "Reading copper listing \"%s\" error ", name);
+            perror("fopen failed");
+            exit(EXIT_FAILURE);
+        }
+        char        line[1024];
+        std::string file = name;
+        int         num  = 0;
+        while (fgets(line, sizeof(line), fp) != nullptr)
+        {
+            // e.g.: "C006 20A0           //     15 c000: \t   MOVI    #HPOS+H_START,hor_pos"
+            const char * cp = strstr(line, "//");
+            if (cp == nullptr)
+            {
+                continue;
+            }
+            if (strncmp(cp, "// File: ", 9) == 0)
+            {
+                file = cp + 9;
+                file.erase(file.find_last_not_of("\r\n") + 1);
+                continue;
+            }
+            int  line_num = 0;
+            int  addr     = 0;
+            char sep      = 0;
+            int  len      = 0;
+            if (sscanf(cp + 2, "%d %x%c%n", &line_num, &addr, &sep, &len) == 3 && sep == ':')
+            {
+                std::string text = cp + 2 + len;
+                text.erase(0, text.find_first_not_of(" \t"));
+                text.erase(text.find_last_not_of(" \t\r\n") + 1);
+                listing[addr & (COPPER_WORDS - 1)] = {file, line_num, text};
+                num++;
+            }
+        }
+        fclose(fp);
+        logonly_printf("Read %d copper listing lines from \"%s\"\n", num, name);
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    void init(int frame)
+    {
+        timeline_frame = frame;
+        lines_fp       = fopen(LOGDIR "xosera_vsim_copper_lines.csv", "w");
+        timeline_fp    = fopen(LOGDIR "xosera_vsim_copper_timeline.csv", "w");
+        if (lines_fp == nullptr || timeline_fp == nullptr)
+        {
+            fprintf(stderr, "Creating copper profile in \"%s\" error ", LOGDIR);
+            perror("fopen failed");
+            exit(EXIT_FAILURE);
+        }
+        fprintf(lines_fp, "frame,line,exec,wait_h,wait_v,xr_wait,late\n");
+        fprintf(timeline_fp, "frame,line,h,addr,op,cycles,kind\n");
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    // follow copper for this pixel clock (after rising edge eval, needs PROFILE=1 public signals)
+    void cycle(Vxosera_main * top, int frame_num, int line)
+    {
+#if SIM_PROFILE
+        auto cop   = XOSERA_MAIN(top)->copper;
+        int  state = cop->cop_ex_state;
+        if (cop->cop_reset)
+        {
+            prev_state = ST_FETCH;
+            return;
+        }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+        // new opcode loaded into cop_IR
+        bool new_op = state == ST_DECODE && prev_state == ST_FETCH;
+        prev_state  = state;
+        if (new_op)
+        {
+            cur_addr          = cop->op_addr & (COPPER_WORDS - 1);
+            op_stats_t & op   = ops[cur_addr];
+            op.opcode         = cop->cop_IR;
+            op.count++;
+            if (((op.opcode >> 12) & 3) == 2)        // HPOS/VPOS
+            {
+                int target = op.opcode & 0x7ff;
+                int pos    = (op.opcode & 0x0800) ? cop->v_count_i : cop->h_count_i;
+                if (pos > target)
+                {
+                    op.late++;
+                    line_cycles[CP_NUM_KINDS]++;
+                }
+            }
+        }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+        if (cur_addr < 0)
+        {
+            return;
+        }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+        int kind = CP_EXEC;
+        if (cop->wait_hv_flag)
+        {
+            kind = cop->wait_for_v ? CP_WAIT_V : CP_WAIT_H;
+        }
+        else if (cop->xr_wr_en && !cop->xr_wr_ack_i)
+        {
+            kind = CP_XR_WAIT;
+        }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+        ops[cur_addr].cycles[kind]++;
+        line_cycles[kind]++;
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+        if (frame_num == timeline_frame)
+        {
+            if (run_cycles == 0 || kind != run_kind || new_op)
+            {
+                timeline_flush();
+                run_addr  = cur_addr;
+                run_kind  = kind;
+                run_line  = line;
+                run_start = cop->h_count_i;
+            }
+            run_cycles++;
+        }
+#endif
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    void end_line(int frame_num, int line)
+    {
+        timeline_flush();
+        if (frame_num > 0)
+        {
+            fprintf(lines_fp,
+                    "%d,%d,%u,%u,%u,%u,%u\n",
+                    frame_num,
+                    line,
+                    line_cycles[CP_EXEC],
+                    line_cycles[CP_WAIT_H],
+                    line_cycles[CP_WAIT_V],
+                    line_cycles[CP_XR_WAIT],
+                    line_cycles[CP_NUM_KINDS]);
+        }
+        memset(line_cycles, 0, sizeof(line_cycles));
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    void finish()
+    {
+        fclose(lines_fp);
+        fclose(timeline_fp);
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+        FILE * fp = fopen(LOGDIR "xosera_vsim_copper_hist.txt", "w");
+        if (fp == nullptr)
+        {
+            return;
+        }
+        uint64_t total = 0;
+        for (int a = 0; a < COPPER_WORDS; a++)
+        {
+            total += ops[a].cycles[CP_EXEC] + ops[a].cycles[CP_XR_WAIT];
+        }
+        fprintf(fp, "Copper instruction cycle histogram (%lu non-waiting cycles)\n\n", total);
+        fprintf(fp,
+                "%-6s %-4s %10s %10s %6s %6s %10s %10s %10s %8s  %s\n",
+                "addr",
+                "op",
+                "count",
+                "exec",
+                "%exec",
+                "avg",
+                "wait_h",
+                "wait_v",
+                "xr_wait",
+                "late",
+                "source");
+        for (int a = 0; a < COPPER_WORDS; a++)
+        {
+            const op_stats_t & op = ops[a];
+            if (op.count == 0)
+            {
+                continue;
+            }
+            uint64_t busy = op.cycles[CP_EXEC] + op.cycles[CP_XR_WAIT];
+            fprintf(fp,
+                    "0x%04x %-4s %10lu %10lu %5.1f%% %6.2f %10lu %10lu %10lu %8lu",
+                    XR_COPPER_ADDR + a,
+                    op_name(op.opcode),
+                    op.count,
+                    op.cycles[CP_EXEC],
+                    total ? 100.0 * busy / total : 0.0,
+                    static_cast<double>(busy) / op.count,
+                    op.cycles[CP_WAIT_H],
+                    op.cycles[CP_WAIT_V],
+                    op.cycles[CP_XR_WAIT],
+                    op.late);
+            auto it = listing.find(a);
+            if (it != listing.end())
+            {
+                fprintf(fp, "  %s:%d: %s", it->second.file.c_str(), it->second.line, it->second.text.c_str());
+            }
+            fprintf(fp, "\n");
+        }
+        fclose(fp);
+        log_printf("Copper profile saved as \"" LOGDIR "xosera_vsim_copper_hist.txt\", \"" LOGDIR
+                   "xosera_vsim_copper_lines.csv\" and \"" LOGDIR "xosera_vsim_copper_timeline.csv\" (frame %d)\n",
+                   timeline_frame);
+    }
+};
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+const char * CopperProfiler::kind_name[CopperProfiler::CP_NUM_KINDS] = {"exec", "wait_h", "wait_v", "xr_wait"};
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+// Blitter throughput benchmark (-blitbench option)
+//
+// Replaces the bus test_data with a sweep of blits (word count, line count, modulo, shift, transparency and S constant
+// fill), repeated for several playfield display setups so VRAM contention with video fetch is included. Pixel clocks
+// are counted from the XR_BLIT_WORDS write queuing each blit until blit_busy clears, and written as a table of VRAM
+// words written per pixel clock (run sim builds for other VIDEO_MODE to compare resolutions).
+class BlitBench
+{
+    struct display_t
+    {
+        const char * name;
+        uint16_t     pa_gfx_ctrl;
+        uint16_t     pb_gfx_ctrl;
+    };
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    struct variant_t
+    {
+        const char * name;
+        uint16_t     ctrl;         // XR_BLIT_CTRL
+        uint16_t     mod;          // XR_BLIT_MOD_S and XR_BLIT_MOD_D
+        uint16_t     shift;        // XR_BLIT_SHIFT
+    };
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    struct job_t
+    {
+        int display;
+        int variant;
+        int words;
+        int lines;
+    };
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    enum
+    {
+        NUM_DISPLAYS    = 5,
+        NUM_VARIANTS    = 5,
+        NUM_SWEEP_WORDS = 4,
+        NUM_SWEEP_LINES = 3,
+    };
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    static const display_t displays[NUM_DISPLAYS];
+    static const variant_t variants[NUM_VARIANTS];
+    static const int       sweep_words[NUM_SWEEP_WORDS];
+    static const int       sweep_lines[NUM_SWEEP_LINES];
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    static const uint16_t SRC_ADDR = 0x0000;
+    static const uint16_t DST_ADDR = 0x8000;
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    std::vector<uint16_t> words;         // generated bus test_data
+    std::vector<job_t>    jobs;
+    std::vector<uint64_t> cycles;        // pixel clocks for each completed job
+    bool                  prev_queued;
+    bool                  prev_busy;
+    bool                  running;
+    vluint64_t            start_time;
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    void add(std::initializer_list<int> w)
+    {
+        for (int v : w)
+        {
+            words.push_back(static_cast<uint16_t>(v));
+        }
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+public:
+    BlitBench()
+        : prev_queued(false)
+        , prev_busy(false)
+        , running(false)
+        , start_time(0)
+    {
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    // generate job sweep and make it the bus test_data
+    void init()
+    {
+        for (int d = 0; d < NUM_DISPLAYS; d++)
+        {
+            // new GFX_CTRL takes effect next frame
+            add({REG_WAIT_BLIT_DONE(),
+                 XREG_SETW(PA_GFX_CTRL, displays[d].pa_gfx_ctrl),
+                 XREG_SETW(PB_GFX_CTRL, displays[d].pb_gfx_ctrl),
+                 REG_WAITVSYNC(),
+                 REG_WAITVTOP()});
+            for (int v = 0; v < NUM_VARIANTS; v++)
+            {
+                const variant_t & var   = variants[v];
+                bool              fill  = (var.ctrl & BLIT_CTRL_SCONST_F) != 0;
+                uint16_t          src_s = fill ? 0x5555 : SRC_ADDR;
+                for (auto nw : sweep_words)
+                {
+                    for (auto nl : sweep_lines)
+                    {
+                        jobs.push_back({d, v, nw, nl});
+                        add({XREG_SETW(BLIT_CTRL, var.ctrl),
+                             XREG_SETW(BLIT_ANDC, 0x0000),
+                             XREG_SETW(BLIT_XOR, 0x0000),
+                             XREG_SETW(BLIT_MOD_S, var.mod),
+                             XREG_SETW(BLIT_SRC_S, src_s),
+                             XREG_SETW(BLIT_MOD_D, var.mod),
+                             XREG_SETW(BLIT_DST_D, DST_ADDR),
+                             XREG_SETW(BLIT_SHIFT, var.shift),
+                             XREG_SETW(BLIT_LINES, nl - 1),
+                             XREG_SETW(BLIT_WORDS, nw - 1),        // starts blit
+                             REG_WAIT_BLIT_DONE()});
+                    }
+                }
+            }
+        }
+        add({REG_END()});
+        bus.set_test_data(words.data(), words.size());
+        log_printf("Blitter benchmark: %zu blits (%d displays, %d variants, %zu bus test_data words)\n",
+                   jobs.size(),
+                   NUM_DISPLAYS,
+                   NUM_VARIANTS,
+                   words.size());
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    // time blit for this pixel clock (after rising edge eval, needs PROFILE=1 public signals)
+    void cycle(Vxosera_main * top)
+    {
+#if SIM_PROFILE
+        auto blit   = XOSERA_MAIN(top)->blitter;
+        bool queued = blit->xreg_blit_queued;
+        bool busy   = blit->blit_busy_o;
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+        if (queued && !prev_queued && !running)
+        {
+            start_time = main_time;
+            running    = true;
+        }
+        else if (running && prev_busy && !busy)
+        {
+            cycles.push_back((main_time - start_time) / 2);
+            running = false;
+        }
+        prev_queued = queued;
+        prev_busy   = busy;
+#endif
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    void finish()
+    {
+        char csv_name[256];
+        snprintf(csv_name, sizeof(csv_name), LOGDIR "xosera_vsim_blitbench_%dx%d.csv", VISIBLE_WIDTH, VISIBLE_HEIGHT);
+        FILE * fp = fopen(csv_name, "w");
+        if (fp == nullptr)
+        {
+            fprintf(stderr, "Creating blitter benchmark \"%s\" error ", csv_name);
+            perror("fopen failed");
+            return;
+        }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+        uint64_t sum_words[NUM_DISPLAYS][NUM_VARIANTS]  = {{0}};
+        uint64_t sum_cycles[NUM_DISPLAYS][NUM_VARIANTS] = {{0}};
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+        fprintf(fp, "mode,display,blit,words,lines,mod,shift,total_words,cycles,words_per_clk\n");
+        for (size_t j = 0; j < cycles.size() && j < jobs.size(); j++)
+        {
+            const job_t &     job   = jobs[j];
+            const variant_t & var   = variants[job.variant];
+            int               total = job.words * job.lines;
+            fprintf(fp,
+                    "%dx%d,%s,%s,%d,%d,%d,%d,%d,%lu,%0.4f\n",
+                    VISIBLE_WIDTH,
+                    VISIBLE_HEIGHT,
+                    displays[job.display].name,
+                    var.name,
+                    job.words,
+                    job.lines,
+                    var.mod,
+                    var.shift & 3,
+                    total,
+                    cycles[j],
+                    cycles[j] ? static_cast<double>(total) / cycles[j] : 0.0);
+            sum_words[job.display][job.variant] += total;
+            sum_cycles[job.display][job.variant] += cycles[j];
+        }
+        fclose(fp);
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+        if (cycles.size() < jobs.size())
+        {
+            log_printf("Blitter benchmark incomplete: %zu of %zu blits timed\n", cycles.size(), jobs.size());
+        }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+        // summary table of words per pixel clock (all sizes of each variant)
+        log_printf("Blitter words per pixel clock (%dx%d):\n%-10s", VISIBLE_WIDTH, VISIBLE_HEIGHT, "display");
+        for (int v = 0; v < NUM_VARIANTS; v++)
+        {
+            log_printf(" %9s", variants[v].name);
+        }
+        log_printf("\n");
+        for (int d = 0; d < NUM_DISPLAYS; d++)
+        {
+            log_printf("%-10s", displays[d].name);
+            for (int v = 0; v < NUM_VARIANTS; v++)
+            {
+                log_printf(" %9.4f", sum_cycles[d][v] ? static_cast<double>(sum_words[d][v]) / sum_cycles[d][v] : 0.0);
+            }
+            log_printf("\n");
+        }
+        log_printf("Blitter benchmark saved as \"%s\"\n", csv_name);
+    }
+};
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+const BlitBench::display_t BlitBench::displays[BlitBench::NUM_DISPLAYS] = {
+    {"blank", 0x0080, 0x0080},         // both playfields blanked
+    {"tile1", 0x0000, 0x0080},         // PA 1-bpp tiles
+    {"bmap4", 0x0050, 0x0080},         // PA bitmap, 4-bpp
+    {"bmap8", 0x0060, 0x0080},         // PA bitmap, 8-bpp
+    {"bmap8+4", 0x0060, 0x0050},       // PA bitmap, 8-bpp, PB bitmap 4-bpp
+};
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+const BlitBench::variant_t BlitBench::variants[BlitBench::NUM_VARIANTS] = {
+    {"copy", 0x0000, 0, 0xFF00},
+    {"copy_mod", 0x0000, 8, 0xFF00},
+    {"shift", 0x0000, 0, 0xFF01},
+    {"transp", BLIT_CTRL_TRANSP_F, 0, 0xFF00},
+    {"fill", BLIT_CTRL_SCONST_F, 0, 0xFF00},
+};
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+const int BlitBench::sweep_words[BlitBench::NUM_SWEEP_WORDS] = {1, 4, 16, 80};
+const int BlitBench::sweep_lines[BlitBench::NUM_SWEEP_LINES] = {1, 8, 32};
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+// Audio capture (-wav option)
+//
+// Decimates the audio_l_o/audio_r_o PDM outputs to 16-bit PCM at -wav_rate (default 48000 Hz) by averaging the PDM
+// bits over each output sample period (a first-order CIC, the same integration the sigma-delta DAC relies on), saved
+// as a stereo WAV. With -wav_taps the per-channel mixer input samples (audio_mixer_slim chan_val, before volume) are
+// also saved as a multi-channel 8-bit WAV at the same rate.
+class AudioCapture
+{
+    static const size_t WAV_HEADER_SIZE = 44;
+    static const size_t BUFFER_FRAMES   = 4096;
+
+    FILE *               wav_fp;
+    FILE *               taps_fp;
+    uint32_t             rate;
+    uint32_t             clock_hz;
+    uint32_t             phase;        // sample rate accumulated each pixel clock, output sample at clock_hz
+    uint32_t             sum_l;
+    uint32_t             sum_r;
+    uint32_t             count;
+    uint32_t             num_frames;
+    std::vector<uint8_t> pcm;        // little-endian 16-bit stereo samples
+    std::vector<uint8_t> taps;
+
+    static void write_le(uint8_t *& p, uint32_t v, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+        {
+            *p++ = (v >> (i * 8)) & 0xff;
+        }
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    // write (or rewrite, once size is known) RIFF WAV header
+    static void wav_header(FILE * fp, int channels, int bits, uint32_t rate, uint32_t data_bytes)
+    {
+        uint8_t   hdr[WAV_HEADER_SIZE];
+        uint8_t * p            = hdr;
+        int       block_align  = channels * (bits / 8);
+        uint32_t  riff_padding = data_bytes & 1;
+        memcpy(p, "RIFF", 4);
+        p += 4;
+        write_le(p, 36 + data_bytes + riff_padding, 4);
+        memcpy(p, "WAVEfmt ", 8);
+        p += 8;
+        write_le(p, 16, 4);                         // fmt chunk size
+        write_le(p, 1, 2);                          // PCM
+        write_le(p, channels, 2);
+        write_le(p, rate, 4);
+        write_le(p, rate * block_align, 4);        // byte rate
+        write_le(p, block_align, 2);
+        write_le(p, bits, 2);
+        memcpy(p, "data", 4);
+        p += 4;
+        write_le(p, data_bytes, 4);
+        fseek(fp, 0, SEEK_SET);
+        fwrite(hdr, sizeof(hdr), 1, fp);
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    static FILE * create(const char * name)
+    {
+        FILE * fp = fopen(name, "wb");
+        if (fp == nullptr)
+        {
+            fprintf(stderr, "Creating audio capture \"%s\" error ", name);
+            perror("fopen failed");
+            exit(EXIT_FAILURE);
+        }
+        return fp;
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    void flush()
+    {
+        fwrite(pcm.data(), 1, pcm.size(), wav_fp);
+        pcm.clear();
+        if (taps_fp != nullptr)
+        {
+            fwrite(taps.data(), 1, taps.size(), taps_fp);
+            taps.clear();
+        }
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    // convert averaged PDM (pulse density) to signed PCM sample
+    static int16_t pcm_sample(uint32_t sum, uint32_t count)
+    {
+        int32_t s = static_cast<int32_t>((static_cast<uint64_t>(sum) << 16) / count) - 32768;
+        return static_cast<int16_t>(std::min(s, 32767));
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    void output_sample(Vxosera_main * top)
+    {
+        uint16_t l = static_cast<uint16_t>(pcm_sample(sum_l, count));
+        uint16_t r = static_cast<uint16_t>(pcm_sample(sum_r, count));
+        pcm.push_back(l & 0xff);
+        pcm.push_back(l >> 8);
+        pcm.push_back(r & 0xff);
+        pcm.push_back(r >> 8);
+#if SIM_AUDIO && SIM_PROFILE
+        if (taps_fp != nullptr)
+        {
+            uint64_t chan_val = XOSERA_MAIN(top)->video_gen->audio_mixer->chan_val;
+            for (int c = 0; c < SIM_AUDIO; c++)
+            {
+                taps.push_back(((chan_val >> (c * 8)) & 0xff) ^ 0x80);        // 8-bit WAV is unsigned
+            }
+        }
+#endif
+        sum_l = 0;
+        sum_r = 0;
+        count = 0;
+        num_frames++;
+        if (num_frames % BUFFER_FRAMES == 0)
+        {
+            flush();
+        }
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+public:
+    AudioCapture()
+        : wav_fp(nullptr)
+        , taps_fp(nullptr)
+        , rate(48000)
+        , clock_hz(static_cast<uint32_t>(PIXEL_CLOCK_MHZ * 1000000.0 + 0.5))
+        , phase(0)
+        , sum_l(0)
+        , sum_r(0)
+        , count(0)
+        , num_frames(0)
+    {
+    }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    void init(uint32_t sample_rate, bool mixer_taps)
+    {
+        if (sample_rate == 0 || sample_rate > clock_hz / 2)
+        {
+            printf("-wav_rate %u Hz not valid (pixel clock %u Hz)\n", sample_rate, clock_hz);
+            exit(EXIT_FAILURE);
+        }
+        rate   = sample_rate;
+        wav_fp = create(LOGDIR "xosera_vsim_audio.wav");
+        wav_header(wav_fp, 2, 16, rate, 0);
+        if (mixer_taps)
+        {
+#if SIM_AUDIO && SIM_PROFILE
+            taps_fp = create(LOGDIR "xosera_vsim_audio_taps.wav");
+            wav_header(taps_fp, SIM_AUDIO, 8, rate, 0);
+#elif SIM_AUDIO
+            printf("-wav_taps needs simulation built with PROFILE=1\n");
+            exit(EXIT_FAILURE);
+#else
+            printf("-wav_taps needs simulation built with AUDIO channels\n");
+            exit(EXIT_FAILURE);
+#endif
+        }
+        pcm.reserve(BUFFER_FRAMES * 4);
+        taps.reserve(BUFFER_FRAMES * std::max(SIM_AUDIO, 1));
+        logonly_printf("Capturing audio at %u Hz to \"" LOGDIR "xosera_vsim_audio.wav\"%s...\n",
+                       rate,
+                       mixer_taps ? " (and mixer channel taps to \"" LOGDIR "xosera_vsim_audio_taps.wav\")" : "");
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    // accumulate PDM outputs for this pixel clock (after rising edge eval)
+    inline void cycle(Vxosera_main * top)
+    {
+        sum_l += top->audio_l_o;
+        sum_r += top->audio_r_o;
+        count++;
+        phase += rate;
+        if (phase >= clock_hz)
+        {
+            phase -= clock_hz;
+            output_sample(top);
+        }
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    void finish()
+    {
+        bool mixer_taps = taps_fp != nullptr;
+        flush();
+        uint32_t bytes = num_frames * 2 * sizeof(int16_t);
+        wav_header(wav_fp, 2, 16, rate, bytes);
+        fclose(wav_fp);
+        if (mixer_taps)
+        {
+            uint32_t taps_bytes = num_frames * SIM_AUDIO;
+            if (taps_bytes & 1)
+            {
+                fseek(taps_fp, 0, SEEK_END);
+                fputc(0, taps_fp);        // RIFF chunk pad byte
+            }
+            wav_header(taps_fp, SIM_AUDIO, 8, rate, taps_bytes);
+            fclose(taps_fp);
+        }
+        log_printf("Audio capture saved as \"" LOGDIR "xosera_vsim_audio.wav\"%s (%u samples at %u Hz, %.03f sec)\n",
+                   mixer_taps ? " and \"" LOGDIR "xosera_vsim_audio_taps.wav\"" : "",
+                   num_frames,
+                   rate,
+                   static_cast<double>(num_frames) / rate);
+    }
+};
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+// Interrupt and register read latency histograms (-latency option)
+//
+// For each interrupt source (intr_trigger bit, enabled in INT_CTRL mask) measures pixel clocks from the source signal
+// to bus_intr_o and from pending (INT_CTRL status) until acknowledged by an INT_CTRL write (signals while already
+// pending are counted as merged, they make no bus_intr_o).  Audio channels also measure ready until reloaded (the
+// audio_intr_o level).  For XM_DATA/XM_DATA_2 (VRAM) and XM_XDATA (XR) reads, measures how long MEM_WAIT stays set
+// for the next pre-read (started by the data register read or XM_RD_ADDR/XM_RD_XADDR write).  Log2 bucket histograms
+// are logged at the end of simulation.
+class LatencyStats
+{
+    static const int NUM_INTR    = 7;         // intr_t bits
+    static const int NUM_BUCKETS = 33;        // 0, 1, 2-3, 4-7 ... 2^31+
+    static const int AUD3_INTR   = 3;         // AUD0-AUD3 are intr_t bits 0-3
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    static const char * intr_name[NUM_INTR];
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    struct histogram_t
+    {
+        uint64_t count;
+        uint64_t total;
+        uint64_t min;
+        uint64_t max;
+        uint64_t bucket[NUM_BUCKETS];
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+        void add(uint64_t clocks)
+        {
+            int b = 0;
+            while (b < NUM_BUCKETS - 1 && (clocks >> b) != 0)
+            {
+                b++;
+            }
+            bucket[b]++;
+            min = (count == 0 || clocks < min) ? clocks : min;
+            max = std::max(max, clocks);
+            total += clocks;
+            count++;
+        }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+        void report(const char * name, const char * what) const
+        {
+            if (count == 0)
+            {
+                return;
+            }
+            log_printf("  %-8s %-22s %9lu %9lu %11.2f %9lu\n",
+                       name,
+                       what,
+                       count,
+                       min,
+                       static_cast<double>(total) / count,
+                       max);
+            for (int b = 0; b < NUM_BUCKETS; b++)
+            {
+                if (bucket[b] == 0)
+                {
+                    continue;
+                }
+                uint64_t lo = b == 0 ? 0 : 1ULL << (b - 1);
+                uint64_t hi = b == 0 ? 0 : (1ULL << b) - 1;
+                int      w  = static_cast<int>((bucket[b] * 40 + count - 1) / count);
+                log_printf("    %10lu-%-10lu %9lu %5.1f%% %.*s\n",
+                           lo,
+                           hi,
+                           bucket[b],
+                           (bucket[b] * 100.0) / count,
+                           w,
+                           "########################################");
+            }
+        }
+    };
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    histogram_t signal_hist[NUM_INTR];        // signal to bus_intr_o
+    histogram_t ack_hist[NUM_INTR];           // pending to INT_CTRL acknowledge
+    histogram_t reload_hist[NUM_INTR];        // audio channel ready to reload
+    uint64_t    merged[NUM_INTR];             // signals while already pending
+    uint64_t    signal_time[NUM_INTR];
+    uint64_t    pending_time[NUM_INTR];
+    uint64_t    ready_time[NUM_INTR];
+    uint8_t     signal_waiting;        // signals waiting for bus_intr_o
+    uint8_t     prev_trigger;
+    uint8_t     prev_status;
+    histogram_t vram_rd_hist;
+    histogram_t xr_rd_hist;
+    uint64_t    vram_rd_time;
+    uint64_t    xr_rd_time;
+    bool        prev_vram_rd;
+    bool        prev_xr_rd;
+    uint64_t    clocks;
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+public:
+    LatencyStats()
+        : signal_hist()
+        , ack_hist()
+        , reload_hist()
+        , merged()
+        , signal_time()
+        , pending_time()
+        , ready_time()
+        , signal_waiting(0)
+        , prev_trigger(0)
+        , prev_status(0)
+        , vram_rd_hist()
+        , xr_rd_hist()
+        , vram_rd_time(0)
+        , xr_rd_time(0)
+        , prev_vram_rd(false)
+        , prev_xr_rd(false)
+        , clocks(0)
+    {
+    }
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+    void init()
+    {
+        logonly_printf("Measuring interrupt and XM_DATA/XM_XDATA read latency...\n");
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    // sample interrupt and read wait state for this pixel clock (after rising edge eval, needs PROFILE=1 signals)
+    inline void cycle(Vxosera_main * top)
+    {
+#if SIM_PROFILE
+        Vxosera_main_xosera_main *   xm      = XOSERA_MAIN(top);
+        Vxosera_main_reg_interface * ri      = xm->reg_interface;
+        uint8_t                      trigger = xm->intr_trigger;
+        uint8_t                      status  = xm->intr_status;
+
+        clocks++;
+        if (top->bus_intr_o && signal_waiting)
+        {
+            for (int i = 0; i < NUM_INTR; i++)
+            {
+                if (signal_waiting & (1 << i))
+                {
+                    signal_hist[i].add(clocks - signal_time[i]);
+                }
+            }
+            signal_waiting = 0;
+        }
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+        uint8_t rising  = trigger & ~prev_trigger;
+        uint8_t falling = prev_trigger & ~trigger;
+        uint8_t pended  = status & ~prev_status;
+        uint8_t acked   = prev_status & ~status;
+        if (rising | falling | pended | acked)
+        {
+            uint8_t enabled = xm->intr_mask;
+            for (int i = 0; i < NUM_INTR; i++)
+            {
+                uint8_t bit = 1 << i;
+                if (rising & bit)
+                {
+                    ready_time[i] = clocks;
+                    if (prev_status & bit)
+                    {
+                        merged[i]++;
+                    }
+                    else if (enabled & bit)
+                    {
+                        signal_time[i] = clocks;
+                        signal_waiting |= bit;
+                    }
+                }
+                if ((falling & bit) && i <= AUD3_INTR)
+                {
+                    reload_hist[i].add(clocks - ready_time[i]);
+                }
+                if (pended & bit)
+                {
+                    pending_time[i] = clocks;
+                }
+                if (acked & bit)
+                {
+                    ack_hist[i].add(clocks - pending_time[i]);
+                }
+            }
+        }
+        prev_trigger = trigger;
+        prev_status  = status;
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+        if (ri->vram_rd != prev_vram_rd)
+        {
+            if (ri->vram_rd)
+            {
+                vram_rd_time = clocks;
+            }
+            else
+            {
+                vram_rd_hist.add(clocks - vram_rd_time);
+            }
+            prev_vram_rd = ri->vram_rd;
+        }
+        if (ri->xr_rd != prev_xr_rd)
+        {
+            if (ri->xr_rd)
+            {
+                xr_rd_time = clocks;
+            }
+            else
+            {
+                xr_rd_hist.add(clocks - xr_rd_time);
+            }
+            prev_xr_rd = ri->xr_rd;
+        }
+#endif
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    void finish()
+    {
+        log_printf("Latency histograms (pixel clocks):\n");
+        log_printf("  %-8s %-22s %9s %9s %11s %9s\n", "source", "latency", "count", "min", "avg", "max");
+        for (int i = NUM_INTR - 1; i >= 0; i--)
+        {
+            signal_hist[i].report(intr_name[i], "signal->bus_intr_o");
+            ack_hist[i].report(intr_name[i], "pending->INT_CTRL ack");
+            reload_hist[i].report(intr_name[i], "ready->reload");
+            if (merged[i] || (prev_status & (1 << i)))
+            {
+                log_printf("  %-8s %lu signals merged while pending%s\n",
+                           intr_name[i],
+                           merged[i],
+                           (prev_status & (1 << i)) ? " (still pending at end)" : "");
+            }
+        }
+        vram_rd_hist.report("XM_DATA", "MEM_WAIT (VRAM read)");
+        xr_rd_hist.report("XM_XDATA", "MEM_WAIT (XR read)");
+    }
+};
 
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+const char * LatencyStats::intr_name[LatencyStats::NUM_INTR] = {"AUD0", "AUD1", "AUD2", "AUD3", "VIDEO", "TIMER", "BLIT"};
 
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+// Memory snapshots (-memsnap option, REG_SNAPSHOT() bus test_data marker or SIGUSR1)
+//
+// Copies VRAM and the XR memories (colormem, pointermem, tilemem and coppermem) into a memory-mapped
+// sim/logs/xosera_vsim_memsnap_<n>.bin (see xosera_memsnap.h) and lists it in sim/logs/xosera_vsim_memsnap.txt.
+// Compare two snapshots with sim/xosera_memdiff.
+class MemSnapshot
+{
+    std::vector<std::pair<int, int>> frames;        // -memsnap frame ranges
+    std::vector<memsnap_region_t>    regions;
+    std::vector<uint16_t>            words;
+    FILE *                           index_fp;
+    uint32_t                         snap_num;
+
+    template <typename T>
+    void add(const char * name, uint32_t addr, const T & mem)
+    {
+        memsnap_region_t r;
+        uint32_t         n = sizeof(mem) / sizeof(mem[0]);
+        memset(&r, 0, sizeof(r));
+        snprintf(r.name, sizeof(r.name), "%s", name);
+        r.addr  = addr;
+        r.words = n;
+        regions.push_back(r);
+        for (uint32_t i = 0; i < n; i++)
+        {
+            words.push_back(mem[i]);
+        }
+    }
 
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
+public:
+    MemSnapshot()
+        : index_fp(nullptr)
+        , snap_num(0)
+    {
+    }
 
+    void add_frames(int first, int last)
+    {
+        frames.push_back(std::make_pair(first, last));
+    }
 
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITHSYNC(),
-    REG_WAITHSYNC(),
-    REG_WAITHSYNC(),
-#if 0
-    REG_WAITVTOP(),
-    XREG_SETW(AUD0_PERIOD, 0x8000 | PERIOD_TEST),
-    XREG_SETW(AUD0_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD0_START, WAVE_TEST),
+    bool at_frame(int frame_num) const
+    {
+        for (auto & f : frames)
+        {
+            if (frame_num >= f.first && frame_num <= f.second)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
 
-    XREG_SETW(AUD1_PERIOD, 0x8000 | (PERIOD_TEST * 2)),
-    XREG_SETW(AUD1_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD1_START, WAVE_TEST),
+    void save(Vxosera_main * top, int frame_num, const char * why)
+    {
+        auto xr = XOSERA_MAIN(top)->xrmem_arb;
+
+        regions.clear();
+        words.clear();
+        add("vram", 0x0000, XOSERA_MAIN(top)->vram_arb->vram->memory);
+        add("colormem_A", XR_COLOR_A_ADDR, xr->colormem_A->bram);
+#if SIM_PF_B
+        add("colormem_B", XR_COLOR_B_ADDR, xr->colormem_B->bram);
+#endif
+        add("pointermem", XR_POINTER_ADDR, xr->pointermem->bram);
+        add("tilemem", XR_TILE_ADDR, xr->tilemem->bram);
+        add("tilemem_2", XR_TILE_ADDR + regions.back().words, xr->tilemem_2->bram);
+        add("coppermem", XR_COPPER_ADDR, xr->coppermem->bram);
+        add("coppermem_2", XR_COPPER_ADDR + regions.back().words, xr->coppermem_2->bram);
+        assert(regions.size() <= MEMSNAP_MAX_REGIONS);
+
+        memsnap_header_t hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.magic       = MEMSNAP_MAGIC;
+        hdr.version     = MEMSNAP_VERSION;
+        hdr.num_regions = static_cast<uint32_t>(regions.size());
+        hdr.time        = main_time;
+        hdr.frame       = frame_num;
+        hdr.snap_num    = snap_num;
+        snprintf(hdr.why, sizeof(hdr.why), "%s", why);
+
+        uint32_t offset = sizeof(hdr) + regions.size() * sizeof(memsnap_region_t);
+        for (auto & r : regions)
+        {
+            r.offset = offset;
+            offset += r.words * sizeof(uint16_t);
+        }
 
-    XREG_SETW(AUD2_PERIOD, 0x8000 | (PERIOD_TEST * 3)),
-    XREG_SETW(AUD2_LENGTH, WAVE_LEN),
-    XREG_SETW(AUD2_START, WAVE_TEST),
+        char name[256];
+        snprintf(name, sizeof(name), LOGDIR "xosera_vsim_memsnap_%02u.bin", snap_num);
+        int    fd  = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        void * mem = MAP_FAILED;
+        if (fd >= 0 && ftruncate(fd, offset) == 0)
+        {
+            mem = mmap(nullptr, offset, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        if (mem == MAP_FAILED)
+        {
+            fprintf(stderr, "Creating memory snapshot \"%s\" error ", name);
+            perror("open/mmap failed");
+            exit(EXIT_FAILURE);
+        }
+        uint8_t * p = static_cast<uint8_t *>(mem);
+        memcpy(p, &hdr, sizeof(hdr));
+        memcpy(p + sizeof(hdr), regions.data(), regions.size() * sizeof(memsnap_region_t));
+        memcpy(p + regions[0].offset, words.data(), words.size() * sizeof(uint16_t));
+        munmap(mem, offset);
+        close(fd);
+
+        if (index_fp == nullptr && (index_fp = fopen(LOGDIR "xosera_vsim_memsnap.txt", "w")) != nullptr)
+        {
+            fprintf(index_fp, "# snap, main_time, frame, why, file\n");
+        }
+        if (index_fp != nullptr)
+        {
+            fprintf(index_fp, "%u, %lu, %d, %s, %s\n", snap_num, main_time, frame_num, hdr.why, name);
+            fflush(index_fp);
+        }
+        log_printf("[@t=%8lu] Memory snapshot #%u (%s) saved as \"%s\" (frame %d, %zu words)\n",
+                   main_time,
+                   snap_num,
+                   hdr.why,
+                   name,
+                   frame_num,
+                   words.size());
+        snap_num++;
+    }
 
-    XREG_SETW(AUD3_PERIOD, 0x8000 | (PERIOD_TEST * 4)),
-    XREG_SETW(AUD3_LENGTH, WAVE_LEN3),
-    XREG_SETW(AUD3_START, WAVE_TEST),
-    XREG_SETW(VID_CTRL, 0x0001),
+    void finish()
+    {
+        if (index_fp != nullptr)
+        {
+            fclose(index_fp);
+            index_fp = nullptr;
+        }
+    }
+};
 
-    REG_WAITHSYNC(),
-    REG_WAITHSYNC(),
-    REG_WAITHSYNC(),
-    REG_WAITHSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
+// save frame_buffer (or other TOTAL_WIDTH x TOTAL_HEIGHT ARGB pixels) as image file using frame_format (returns false on
+// error)
+static bool save_frame(const char *     save_base,
+                       char *           save_name,
+                       size_t           save_name_size,
+                       const uint32_t * pixels = &frame_buffer[0][0])
+{
+    static const char * ext[] = {"", "png", "ppm", "raw"};
+    snprintf(save_name, save_name_size, "%s.%s", save_base, ext[frame_format]);
+
+    if (frame_format == FRAME_PNG)
+    {
+#if SDL_RENDER
+        SDL_Surface * screen_shot = SDL_CreateRGBSurfaceFrom(const_cast<uint32_t *>(pixels),
+                                                             TOTAL_WIDTH,
+                                                             TOTAL_HEIGHT,
+                                                             32,
+                                                             TOTAL_WIDTH * sizeof(uint32_t),
+                                                             0x00ff0000,
+                                                             0x0000ff00,
+                                                             0x000000ff,
+                                                             0xff000000);
+        int           res         = IMG_SavePNG(screen_shot, save_name);
+        SDL_FreeSurface(screen_shot);
+        return res == 0;
+#else
+        return false;
 #endif
-    // XREG_SETW(AUD0_VOL, 0x2020),
-    // XREG_SETW(AUD1_VOL, 0x2020),
-    // XREG_SETW(AUD2_VOL, 0x2020),
-    // XREG_SETW(AUD3_VOL, 0x2020),
+    }
 
-    // XREG_SETW(AUD_CTRL, 0x0000),
-    // REG_WAITHSYNC(),
-    // REG_WAITHSYNC(),
-    // REG_WAITHSYNC(),
-    // REG_WAITHSYNC(),
-    // REG_WAITHSYNC(),
-    // XREG_SETW(AUD_CTRL, 0x000F),
+    FILE * ifp = fopen(save_name, "wb");
+    if (ifp == nullptr)
+    {
+        return false;
+    }
 
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
+    uint8_t line[TOTAL_WIDTH * 3];
+    if (frame_format == FRAME_PPM)
+    {
+        fprintf(ifp, "P6\n%d %d\n255\n", TOTAL_WIDTH, TOTAL_HEIGHT);
+        for (int y = 0; y < TOTAL_HEIGHT; y++)
+        {
+            uint8_t * lp = line;
+            for (int x = 0; x < TOTAL_WIDTH; x++)
+            {
+                uint32_t argb = pixels[y * TOTAL_WIDTH + x];
+                *lp++         = (argb >> 16) & 0xff;
+                *lp++         = (argb >> 8) & 0xff;
+                *lp++         = argb & 0xff;
+            }
+            fwrite(line, TOTAL_WIDTH * 3, 1, ifp);
+        }
+    }
+    else
+    {
+        for (int y = 0; y < TOTAL_HEIGHT; y++)
+        {
+            uint8_t * lp = line;
+            for (int x = 0; x < TOTAL_WIDTH; x++)
+            {
+                uint32_t argb = pixels[y * TOTAL_WIDTH + x];
+                *lp++         = (argb >> 20) & 0x0f;
+                *lp++         = ((argb >> 8) & 0xf0) | ((argb >> 4) & 0x0f);
+            }
+            fwrite(line, TOTAL_WIDTH * 2, 1, ifp);
+        }
+    }
 
-    REG_RW(INT_CTRL),
+    return fclose(ifp) == 0;
+}
 
-    // XREG_SETW(AUD0_VOL, 0x8040),
-    // XREG_SETW(AUD1_VOL, 0x8040),
-    // XREG_SETW(AUD2_VOL, 0x8040),
-    // XREG_SETW(AUD3_VOL, 0x0000),
+// Golden frame regression check (-check <dir> option)
+//
+// Each completed frame's visible pixels are hashed (FNV-1a over ARGB pixels) and compared with <dir>/golden.txt.
+// Only mismatched frames are saved (as sim/logs/xosera_vsim_check_f<n> in -f format), with a _mask image that shows
+// differing pixels in red over the dimmed frame when <dir> has the golden raw frame.  The simulation stops after
+// -check_max mismatches (default 1) and exits with EXIT_FAILURE.  -check_update writes golden.txt and golden raw
+// frames to <dir> from this run instead.
+class FrameCheck
+{
+    static const uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+    static const uint64_t FNV_PRIME  = 0x100000001b3ULL;
+
+    std::string                       dir;
+    bool                              update;
+    int                               max_mismatch;
+    uint64_t                          hash;
+    std::unordered_map<int, uint64_t> golden;        // frame number => hash
+    FILE *                            manifest_fp;
+    int                               num_checked;
+    int                               num_mismatch;
+    int                               num_missing;        // frames without golden hash
+    int                               last_frame;
+    std::vector<uint32_t>             mask;
+
+    // golden raw frame name without extension
+    std::string golden_base(int frame_num) const
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "/golden_f%02d", frame_num);
+        return dir + name;
+    }
 
-    // XREG_SETW(AUD_CTRL, 0x0000),
-    // REG_WAITHSYNC(),
-    // REG_WAITHSYNC(),
-    // REG_WAITHSYNC(),
-    // REG_WAITHSYNC(),
-    // REG_WAITHSYNC(),
-    // XREG_SETW(AUD_CTRL, 0x000F),
+    // save red difference mask over dimmed frame (returns false if no golden raw frame)
+    bool save_mask(int frame_num, const char * save_base, char * save_name, size_t save_name_size)
+    {
+        FILE * gfp = fopen((golden_base(frame_num) + ".raw").c_str(), "rb");
+        if (gfp == nullptr)
+        {
+            return false;
+        }
+        uint8_t line[TOTAL_WIDTH * 2];
+        mask.resize(TOTAL_WIDTH * TOTAL_HEIGHT);
+        for (int y = 0; y < TOTAL_HEIGHT; y++)
+        {
+            if (fread(line, sizeof(line), 1, gfp) != 1)
+            {
+                fclose(gfp);
+                return false;
+            }
+            for (int x = 0; x < TOTAL_WIDTH; x++)
+            {
+                uint32_t argb  = frame_buffer[y][x];
+                uint16_t rgb   = ((argb >> 12) & 0xf00) | ((argb >> 8) & 0x0f0) | ((argb >> 4) & 0x00f);
+                uint16_t g_rgb = (line[x * 2] << 8) | line[x * 2 + 1];
 
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
+                mask[y * TOTAL_WIDTH + x] = rgb != g_rgb ? 0xffff0000 : 0xff000000 | ((argb >> 2) & 0x3f3f3f);
+            }
+        }
+        fclose(gfp);
+        return save_frame(save_base, save_name, save_name_size, mask.data());
+    }
 
-    // XREG_SETW(AUD0_VOL, 0x8040),
-    // XREG_SETW(AUD1_VOL, 0x8040),
-    // XREG_SETW(AUD2_VOL, 0x8040),
-    // XREG_SETW(AUD3_VOL, 0x8040),
+public:
+    FrameCheck()
+        : update(false)
+        , max_mismatch(1)
+        , hash(FNV_OFFSET)
+        , manifest_fp(nullptr)
+        , num_checked(0)
+        , num_mismatch(0)
+        , num_missing(0)
+        , last_frame(0)
+    {
+    }
 
-    // XREG_SETW(AUD_CTRL, 0x0000),
-    // REG_WAITHSYNC(),
-    // REG_WAITHSYNC(),
-    // REG_WAITHSYNC(),
-    // REG_WAITHSYNC(),
-    // REG_WAITHSYNC(),
-    // XREG_SETW(AUD_CTRL, 0x000F),
+    void init(const char * golden_dir, bool update_golden, int max_mismatches)
+    {
+        dir          = golden_dir;
+        update       = update_golden;
+        max_mismatch = max_mismatches;
 
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-#if 0        // min vol test
-    XREG_SETW(AUD0_VOL, 0x0200),        // minimum
-    XREG_SETW(AUD1_VOL, 0x0000),
-    XREG_SETW(AUD2_VOL, 0x0000),
-    XREG_SETW(AUD3_VOL, 0x0000),
+        std::string name = dir + "/golden.txt";
+        if (update)
+        {
+            mkdir(golden_dir, 0755);
+            if ((manifest_fp = fopen(name.c_str(), "w")) == nullptr)
+            {
+                fprintf(stderr, "Creating golden manifest \"%s\" error ", name.c_str());
+                perror("fopen failed");
+                exit(EXIT_FAILURE);
+            }
+            fprintf(manifest_fp, "# Xosera simulation golden frames: mode %dx%d\n", VISIBLE_WIDTH, VISIBLE_HEIGHT);
+            log_printf("Check: writing golden frames to \"%s\"\n", golden_dir);
+            return;
+        }
+
+        FILE * mfp = fopen(name.c_str(), "r");
+        if (mfp == nullptr)
+        {
+            fprintf(stderr, "Reading golden manifest \"%s\" error ", name.c_str());
+            perror("fopen failed (use -check_update to create)");
+            exit(EXIT_FAILURE);
+        }
+        char line[256];
+        int  w = 0, h = 0;
+        while (fgets(line, sizeof(line), mfp) != nullptr)
+        {
+            int                frame = 0;
+            unsigned long long value = 0;
+            if (sscanf(line, "# Xosera simulation golden frames: mode %dx%d", &w, &h) == 2)
+            {
+                continue;
+            }
+            if (sscanf(line, "%d %llx", &frame, &value) == 2)
+            {
+                golden[frame] = value;
+            }
+        }
+        fclose(mfp);
+        if (w != VISIBLE_WIDTH || h != VISIBLE_HEIGHT)
+        {
+            fprintf(stderr,
+                    "Golden manifest \"%s\" is for mode %dx%d (simulation is %dx%d)\n",
+                    name.c_str(),
+                    w,
+                    h,
+                    VISIBLE_WIDTH,
+                    VISIBLE_HEIGHT);
+            exit(EXIT_FAILURE);
+        }
+        log_printf("Check: %zu golden frame hashes from \"%s\"\n", golden.size(), name.c_str());
+    }
 
-    XREG_SETW(AUD_CTRL, 0x0000),
-    REG_WAITHSYNC(),
-    REG_WAITHSYNC(),
-    REG_WAITHSYNC(),
-    REG_WAITHSYNC(),
-    REG_WAITHSYNC(),
-    XREG_SETW(AUD_CTRL, 0x000F),
+    // hash visible pixel
+    inline void pixel(uint32_t argb)
+    {
+        hash = (hash ^ argb) * FNV_PRIME;
+    }
 
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-    REG_WAITVTOP(),
-    REG_WAITVSYNC(),
-#endif
-    XREG_SETW(AUD_CTRL, 0x0000),
-    REG_WAITHSYNC(),
-    REG_WAITHSYNC(),
-    REG_WAITHSYNC(),
-    REG_WAITHSYNC(),
-    REG_WAITHSYNC(),
-#endif
+    // check (or save golden) completed frame, returns false when simulation should stop
+    bool end_frame(int frame_num)
+    {
+        uint64_t frame_hash = hash;
+        hash                = FNV_OFFSET;
+        last_frame          = frame_num;
 
-    REG_W(INT_CTRL, 0x8100),
+        if (update)
+        {
+            char save_name[256];
+            int  save_format = frame_format;
+            frame_format     = FRAME_RAW;
+            bool ok          = save_frame(golden_base(frame_num).c_str(), save_name, sizeof(save_name));
+            frame_format     = save_format;
+            fprintf(manifest_fp, "%d %016llx\n", frame_num, static_cast<unsigned long long>(frame_hash));
+            if (!ok)
+            {
+                log_printf("Check: golden frame #%d save as \"%s\" failed\n", frame_num, save_name);
+            }
+            num_checked++;
+            return true;
+        }
 
-    REG_END(),
-    // end test data
+        auto it = golden.find(frame_num);
+        if (it == golden.end())
+        {
+            num_missing++;
+            return true;
+        }
+        num_checked++;
+        if (it->second == frame_hash)
+        {
+            return true;
+        }
+
+        num_mismatch++;
+        char save_base[256];
+        char save_name[256] = {0};
+        char mask_name[256] = {0};
+        snprintf(save_base, sizeof(save_base), LOGDIR "xosera_vsim_check_f%02d", frame_num);
+        save_frame(save_base, save_name, sizeof(save_name));
+        strncat(save_base, "_mask", sizeof(save_base) - strlen(save_base) - 1);
+        bool have_mask = save_mask(frame_num, save_base, mask_name, sizeof(mask_name));
+        log_printf("[@t=%8lu] Check: frame #%d MISMATCH hash %016llx (golden %016llx), saved \"%s\"%s%s%s\n",
+                   main_time,
+                   frame_num,
+                   static_cast<unsigned long long>(frame_hash),
+                   static_cast<unsigned long long>(it->second),
+                   save_name,
+                   have_mask ? " and \"" : " (no golden raw frame for mask)",
+                   have_mask ? mask_name : "",
+                   have_mask ? "\"" : "");
+
+        return num_mismatch < max_mismatch;
+    }
+
+    // log summary, returns false if check failed
+    bool finish()
+    {
+        if (update)
+        {
+            fclose(manifest_fp);
+            log_printf("Check: %d golden frames saved to \"%s\"\n", num_checked, dir.c_str());
+            return true;
+        }
+
+        int not_reached = 0;
+        for (auto & g : golden)
+        {
+            not_reached += g.first > last_frame;
+        }
+        bool pass = num_mismatch == 0 && not_reached == 0;
+        log_printf("Check: %s, %d frames checked, %d mismatched, %d without golden hash, %d golden frames not reached\n",
+                   pass ? "PASS" : "FAIL",
+                   num_checked,
+                   num_mismatch,
+                   num_missing,
+                   not_reached);
+        return pass;
+    }
 };
 
-#if 0
-uint16_t     BusInterface::test_stfont[1024] = {REG_W(WR_ADDR, 0x3),
-                                          REG_W(WR_INC, 0x1),
-                                          REG_W(DATA, 0x0200 | 'H'),
-                                          REG_BL(DATA, 'e'),
-                                          REG_BL(DATA, 'l'),
-                                          REG_BL(DATA, 'l'),
-                                          REG_BL(DATA, 'o'),
-                                          REG_BL(DATA, '!'),
-                                          REG_W(WR_ADDR, 0x0),
-                                          REG_W(DATA, 0x0e00 | '\x0e'),
-                                          REG_W(DATA, 0x0e00 | '\x0f'),
-                                          REG_W(WR_ADDR, X_COLS * 5),
-                                          REG_W(DATA, 0x0200 | 'A'),
-                                          REG_BL(DATA, 't'),
-                                          REG_BL(DATA, 'a'),
-                                          REG_BL(DATA, 'r'),
-                                          REG_BL(DATA, 'i'),
-                                          REG_BL(DATA, ' '),
-                                          REG_BL(DATA, 'S'),
-                                          REG_BL(DATA, 'T'),
-                                          REG_BL(DATA, ' '),
-                                          REG_BL(DATA, '8'),
-                                          REG_BL(DATA, 'x'),
-                                          REG_BL(DATA, '1'),
-                                          REG_BL(DATA, '6'),
-                                          REG_BL(DATA, ' '),
-                                          REG_BL(DATA, 'F'),
-                                          REG_BL(DATA, 'o'),
-                                          REG_BL(DATA, 'n'),
-                                          REG_BL(DATA, 't'),
-                                          REG_BL(DATA, ' '),
-                                          REG_BL(DATA, 'T'),
-                                          REG_BL(DATA, 'e'),
-                                          REG_BL(DATA, 's'),
-                                          REG_BL(DATA, 't'),
-                                          REG_BL(DATA, ' '),
-                                          REG_BL(DATA, '\x1c'),
-                                          REG_BL(WR_INC, X_COLS - 1),
-                                          REG_BL(DATA, '\x1d'),
-                                          REG_BL(WR_INC, 1),
-                                          REG_BL(DATA, '\x1e'),
-                                          REG_BL(DATA, '\x1f'),
-                                          REG_END()};
+// video scan state local to main loop (saved and restored with snapshot)
+struct frame_state_t
+{
+    int  current_x;
+    int  current_y;
+    bool vga_hsync_previous;
+    bool vga_vsync_previous;
+    int  frame_num;
+    int  x_max;
+    int  y_max;
+    int  hsync_count;
+    int  hsync_min;
+    int  hsync_max;
+    int  vsync_count;
+};
+
+#if SIM_SAVABLE
+static const char   SNAPSHOT_MAGIC[8] = {'X', 'O', 'S', 'N', 'A', 'P', '0', '3'};
+static const int    SNAPSHOT_MODE[2]  = {TOTAL_WIDTH, TOTAL_HEIGHT};
+
+// save full simulation state (Verilator model, bus state and main loop state)
+static void save_snapshot(const char * name, Vxosera_main * top, frame_state_t & fs)
+{
+    VerilatedSave os;
+    os.open(name);
+    if (!os.isOpen())
+    {
+        log_printf("Snapshot save to \"%s\" failed\n", name);
+        return;
+    }
+    os.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    os.write(SNAPSHOT_MODE, sizeof(SNAPSHOT_MODE));
+    os << *top;
+    os.write(&main_time, sizeof(main_time));
+    os.write(&first_frame_start, sizeof(first_frame_start));
+    os.write(&frame_start_time, sizeof(frame_start_time));
+    os.write(&vsync_detect, sizeof(vsync_detect));
+    os.write(&vtop_detect, sizeof(vtop_detect));
+    os.write(&hsync_detect, sizeof(hsync_detect));
+    os.write(&last_read_val, sizeof(last_read_val));
+    os.write(&fs, sizeof(fs));
+    bus.save(os);
+    os.write(frame_buffer, sizeof(frame_buffer));
+    os.close();
+    log_printf("[@t=%8lu] Snapshot saved to \"%s\" (frame %d, bus index %d)\n",
+               main_time,
+               name,
+               fs.frame_num,
+               bus.get_index());
+}
+
+// restore full simulation state saved by save_snapshot (-u uploads, -fastbus and -backdoor must match saved run)
+static void restore_snapshot(const char * name, Vxosera_main * top, frame_state_t & fs)
+{
+    VerilatedRestore is;
+    is.open(name);
+    if (!is.isOpen())
+    {
+        fprintf(stderr, "Snapshot restore from \"%s\" failed\n", name);
+        exit(EXIT_FAILURE);
+    }
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    int  mode[2];
+    is.read(magic, sizeof(magic));
+    is.read(mode, sizeof(mode));
+    if (memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) != 0 || memcmp(mode, SNAPSHOT_MODE, sizeof(mode)) != 0)
+    {
+        fprintf(stderr, "Snapshot \"%s\" is not from this simulation build\n", name);
+        exit(EXIT_FAILURE);
+    }
+    is >> *top;
+    is.read(&main_time, sizeof(main_time));
+    is.read(&first_frame_start, sizeof(first_frame_start));
+    is.read(&frame_start_time, sizeof(frame_start_time));
+    is.read(&vsync_detect, sizeof(vsync_detect));
+    is.read(&vtop_detect, sizeof(vtop_detect));
+    is.read(&hsync_detect, sizeof(hsync_detect));
+    is.read(&last_read_val, sizeof(last_read_val));
+    is.read(&fs, sizeof(fs));
+    bus.restore(is);
+    is.read(frame_buffer, sizeof(frame_buffer));
+    is.close();
+    log_printf("[@t=%8lu] Snapshot restored from \"%s\" (frame %d, bus index %d)\n",
+               main_time,
+               name,
+               fs.frame_num,
+               bus.get_index());
+}
 #endif
 
 void ctrl_c(int s)
@@ -9738,6 +13549,12 @@ void ctrl_c(int s)
     done = true;
 }
 
+void memsnap_usr1(int s)
+{
+    (void)s;
+    memsnap_signal = 1;
+}
+
 // Called by $time in Verilog
 double sc_time_stamp()
 {
@@ -9754,6 +13571,14 @@ int main(int argc, char ** argv)
 
     sigaction(SIGINT, &sigIntHandler, NULL);
 
+    struct sigaction sigUsr1Handler;
+
+    sigUsr1Handler.sa_handler = memsnap_usr1;
+    sigemptyset(&sigUsr1Handler.sa_mask);
+    sigUsr1Handler.sa_flags = SA_RESTART;
+
+    sigaction(SIGUSR1, &sigUsr1Handler, NULL);
+
     if ((logfile = fopen("sim/logs/xosera_vsim.log", "w")) == NULL)
     {
         if ((logfile = fopen("xosera_vsim.log", "w")) == NULL)
@@ -9770,7 +13595,39 @@ int main(int argc, char ** argv)
                Hz,
                PIXEL_CLOCK_MHZ);
 
-    int nextarg = 1;
+    int  nextarg          = 1;
+    bool frame_format_set = false;
+
+    const char * snapshot_save_name    = nullptr;        // -save file
+    const char * snapshot_restore_name = nullptr;        // -restore file
+    int          snapshot_frame        = -1;             // -save_frame number
+    int          snapshot_index        = -1;             // -save_index bus test_data index
+    const char * bus_script_name       = nullptr;        // -script file
+    bool         vram_profile          = false;          // -vprof
+    bool         copper_profile        = false;          // -cprof
+    int          copper_profile_frame  = 1;              // -cprof_frame
+    bool         blit_bench            = false;          // -blitbench
+    bool         fast_bus              = false;          // -fastbus
+    bool         backdoor_upload       = false;          // -backdoor
+    const char * cosim_name            = nullptr;        // -cosim shared memory name
+    const char * record_name           = nullptr;        // -record file
+    const char * replay_name           = nullptr;        // -replay file
+    uint64_t     replay_gap            = 0;              // -replay_gap
+    bool         replay_lenient        = false;          // -replay_lenient
+    bool         spi_cosim             = false;          // -spi
+    int          spi_div               = static_cast<int>(PIXEL_CLOCK_MHZ / 2.0 + 0.5);        // -spi_div
+    uint32_t     spi_gap               = 1000;                                                 // -spi_gap
+    bool         event_log             = false;          // -evlog
+    bool         audio_capture         = false;          // -wav
+    bool         audio_taps            = false;          // -wav_taps
+    uint32_t     audio_rate            = 48000;          // -wav_rate
+    bool         latency_stats         = false;          // -latency
+    const char * check_dir             = nullptr;        // -check (or -check_update) golden frame directory
+    bool         check_update          = false;          // -check_update
+    int          check_max             = 1;              // -check_max mismatches
+
+    std::vector<const char *> copper_listings;        // -cprof_lst files
+    MemSnapshot               memsnap;                // -memsnap frames (and REG_SNAPSHOT() or SIGUSR1)
 
     while (nextarg < argc && (argv[nextarg][0] == '-' || argv[nextarg][0] == '/'))
     {
@@ -9778,15 +13635,307 @@ int main(int argc, char ** argv)
         {
             sim_render = false;
         }
-        else if (strcmp(argv[nextarg] + 1, "b") == 0)
+        else if (strcmp(argv[nextarg] + 1, "f") == 0)
+        {
+            nextarg += 1;
+            if (nextarg >= argc)
+            {
+                printf("-f needs image format (png, ppm, raw or none)\n");
+                exit(EXIT_FAILURE);
+            }
+            if (strcmp(argv[nextarg], "png") == 0 && SDL_RENDER)
+            {
+                frame_format = FRAME_PNG;
+            }
+            else if (strcmp(argv[nextarg], "ppm") == 0)
+            {
+                frame_format = FRAME_PPM;
+            }
+            else if (strcmp(argv[nextarg], "raw") == 0)
+            {
+                frame_format = FRAME_RAW;
+            }
+            else if (strcmp(argv[nextarg], "none") == 0)
+            {
+                frame_format = FRAME_NONE;
+            }
+            else
+            {
+                printf("-f image format \"%s\" not supported\n", argv[nextarg]);
+                exit(EXIT_FAILURE);
+            }
+            frame_format_set = true;
+        }
+        else if (strcmp(argv[nextarg] + 1, "b") == 0)
+        {
+            sim_bus = true;
+        }
+        else if (strcmp(argv[nextarg] + 1, "w") == 0)
+        {
+            wait_close = true;
+        }
+        else if (strcmp(argv[nextarg] + 1, "vprof") == 0)
+        {
+#if SIM_PROFILE
+            vram_profile = true;
+#else
+            printf("-vprof needs simulation built with PROFILE=1\n");
+            exit(EXIT_FAILURE);
+#endif
+        }
+        else if (strcmp(argv[nextarg] + 1, "cprof") == 0)
+        {
+#if SIM_PROFILE
+            copper_profile = true;
+#else
+            printf("-cprof needs simulation built with PROFILE=1\n");
+            exit(EXIT_FAILURE);
+#endif
+        }
+        else if (strcmp(argv[nextarg] + 1, "wav") == 0 || strcmp(argv[nextarg] + 1, "wav_taps") == 0)
+        {
+            audio_capture = true;
+            audio_taps    = audio_taps || strcmp(argv[nextarg] + 1, "wav_taps") == 0;
+        }
+        else if (strcmp(argv[nextarg] + 1, "wav_rate") == 0)
+        {
+            nextarg += 1;
+            if (nextarg >= argc)
+            {
+                printf("-wav_rate needs sample rate\n");
+                exit(EXIT_FAILURE);
+            }
+            audio_rate    = static_cast<uint32_t>(strtoul(argv[nextarg], nullptr, 0));
+            audio_capture = true;
+        }
+        else if (strcmp(argv[nextarg] + 1, "latency") == 0)
+        {
+#if SIM_PROFILE
+            latency_stats = true;
+#else
+            printf("-latency needs simulation built with PROFILE=1\n");
+            exit(EXIT_FAILURE);
+#endif
+        }
+        else if (strcmp(argv[nextarg] + 1, "evlog") == 0)
+        {
+            event_log = true;
+        }
+        else if (strcmp(argv[nextarg] + 1, "check") == 0 || strcmp(argv[nextarg] + 1, "check_update") == 0)
+        {
+            check_update = strcmp(argv[nextarg] + 1, "check_update") == 0;
+            nextarg += 1;
+            if (nextarg >= argc)
+            {
+                printf("-%s needs golden frame directory\n", check_update ? "check_update" : "check");
+                exit(EXIT_FAILURE);
+            }
+            check_dir = argv[nextarg];
+        }
+        else if (strcmp(argv[nextarg] + 1, "check_max") == 0)
+        {
+            nextarg += 1;
+            if (nextarg >= argc || (check_max = static_cast<int>(strtol(argv[nextarg], nullptr, 0))) < 1)
+            {
+                printf("-check_max needs number of mismatched frames (>= 1)\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (strcmp(argv[nextarg] + 1, "memsnap") == 0)
+        {
+            nextarg += 1;
+            int          first = 0;
+            int          last  = 0;
+            const char * end   = nextarg < argc ? parse_trace_range(argv[nextarg], first, last) : nullptr;
+            if (end == nullptr || *end != '\0')
+            {
+                printf("-memsnap needs frame number or range (e.g., 3 or 2-5)\n");
+                exit(EXIT_FAILURE);
+            }
+            memsnap.add_frames(first, last);
+        }
+        else if (strcmp(argv[nextarg] + 1, "fastbus") == 0)
+        {
+            fast_bus = true;
+        }
+        else if (strcmp(argv[nextarg] + 1, "backdoor") == 0)
+        {
+            backdoor_upload = true;
+        }
+        else if (strcmp(argv[nextarg] + 1, "cosim") == 0)
+        {
+            nextarg += 1;
+            if (nextarg >= argc)
+            {
+                printf("-cosim needs shared memory name (e.g., /xosera_cosim)\n");
+                exit(EXIT_FAILURE);
+            }
+            cosim_name = argv[nextarg];
+            sim_bus    = true;
+        }
+        else if (strcmp(argv[nextarg] + 1, "record") == 0 || strcmp(argv[nextarg] + 1, "replay") == 0)
+        {
+            const char * opt = argv[nextarg] + 1;
+            nextarg += 1;
+            if (nextarg >= argc)
+            {
+                printf("-%s needs bus recording filename\n", opt);
+                exit(EXIT_FAILURE);
+            }
+            if (strcmp(opt, "record") == 0)
+            {
+                record_name = argv[nextarg];
+            }
+            else
+            {
+                replay_name = argv[nextarg];
+                sim_bus     = true;
+            }
+        }
+        else if (strcmp(argv[nextarg] + 1, "replay_gap") == 0)
+        {
+            nextarg += 1;
+            if (nextarg >= argc)
+            {
+                printf("-replay_gap needs pixel clocks\n");
+                exit(EXIT_FAILURE);
+            }
+            replay_gap = strtoull(argv[nextarg], nullptr, 0);
+        }
+        else if (strcmp(argv[nextarg] + 1, "replay_lenient") == 0)
+        {
+            replay_lenient = true;
+        }
+        else if (strcmp(argv[nextarg] + 1, "spi") == 0)
+        {
+            spi_cosim = true;
+        }
+        else if (strcmp(argv[nextarg] + 1, "spi_div") == 0 || strcmp(argv[nextarg] + 1, "spi_gap") == 0)
+        {
+            const char * opt = argv[nextarg] + 1;
+            nextarg += 1;
+            if (nextarg >= argc)
+            {
+                printf("-%s needs %s\n", opt, strcmp(opt, "spi_div") == 0 ? "pixel clocks per bit" : "microseconds");
+                exit(EXIT_FAILURE);
+            }
+            if (strcmp(opt, "spi_div") == 0)
+            {
+                spi_div = static_cast<int>(strtol(argv[nextarg], nullptr, 0));
+            }
+            else
+            {
+                spi_gap = static_cast<uint32_t>(strtoul(argv[nextarg], nullptr, 0));
+            }
+            spi_cosim = true;
+        }
+        else if (strcmp(argv[nextarg] + 1, "blitbench") == 0)
+        {
+#if SIM_PROFILE
+            blit_bench = true;
+            sim_bus    = true;
+#else
+            printf("-blitbench needs simulation built with PROFILE=1\n");
+            exit(EXIT_FAILURE);
+#endif
+        }
+        else if (strcmp(argv[nextarg] + 1, "cprof_lst") == 0 || strcmp(argv[nextarg] + 1, "cprof_frame") == 0)
+        {
+            const char * opt = argv[nextarg] + 1;
+            nextarg += 1;
+            if (nextarg >= argc)
+            {
+                printf("-%s needs %s\n", opt, strcmp(opt, "cprof_lst") == 0 ? "filename" : "frame number");
+                exit(EXIT_FAILURE);
+            }
+            if (strcmp(opt, "cprof_lst") == 0)
+            {
+                copper_listings.push_back(argv[nextarg]);
+            }
+            else
+            {
+                copper_profile_frame = static_cast<int>(strtol(argv[nextarg], nullptr, 0));
+            }
+#if SIM_PROFILE
+            copper_profile = true;
+#else
+            printf("-%s needs simulation built with PROFILE=1\n", opt);
+            exit(EXIT_FAILURE);
+#endif
+        }
+        else if (strcmp(argv[nextarg] + 1, "trace") == 0 || strcmp(argv[nextarg] + 1, "trace_pre") == 0 ||
+                 strcmp(argv[nextarg] + 1, "trace_post") == 0)
+        {
+            const char * opt = argv[nextarg] + 1;
+            nextarg += 1;
+            if (nextarg >= argc)
+            {
+                printf("-%s needs %s\n", opt, strcmp(opt, "trace") == 0 ? "trigger" : "number of lines");
+                exit(EXIT_FAILURE);
+            }
+#if VM_TRACE
+            if (strcmp(opt, "trace_pre") == 0)
+            {
+                trace_pre_lines = static_cast<int>(strtol(argv[nextarg], nullptr, 0));
+            }
+            else if (strcmp(opt, "trace_post") == 0)
+            {
+                trace_post_lines = static_cast<int>(strtol(argv[nextarg], nullptr, 0));
+            }
+            else if (!parse_trace_trigger(argv[nextarg]))
+            {
+                printf("-trace trigger \"%s\" not valid\n", argv[nextarg]);
+                exit(EXIT_FAILURE);
+            }
+#else
+            printf("-%s needs simulation built with TRACE=1\n", opt);
+            exit(EXIT_FAILURE);
+#endif
+        }
+        else if (strcmp(argv[nextarg] + 1, "script") == 0)
         {
-            sim_bus = true;
+            nextarg += 1;
+            if (nextarg >= argc)
+            {
+                printf("-script needs filename\n");
+                exit(EXIT_FAILURE);
+            }
+            bus_script_name = argv[nextarg];
+            sim_bus         = true;
         }
-        else if (strcmp(argv[nextarg] + 1, "w") == 0)
+        else if (strcmp(argv[nextarg] + 1, "save") == 0 || strcmp(argv[nextarg] + 1, "restore") == 0 ||
+                 strcmp(argv[nextarg] + 1, "save_frame") == 0 || strcmp(argv[nextarg] + 1, "save_index") == 0)
         {
-            wait_close = true;
+            const char * opt = argv[nextarg] + 1;
+            nextarg += 1;
+            if (nextarg >= argc)
+            {
+                printf("-%s needs %s\n", opt, strncmp(opt, "save_", 5) == 0 ? "number" : "filename");
+                exit(EXIT_FAILURE);
+            }
+#if SIM_SAVABLE
+            if (strcmp(opt, "save") == 0)
+            {
+                snapshot_save_name = argv[nextarg];
+            }
+            else if (strcmp(opt, "restore") == 0)
+            {
+                snapshot_restore_name = argv[nextarg];
+            }
+            else if (strcmp(opt, "save_frame") == 0)
+            {
+                snapshot_frame = static_cast<int>(strtol(argv[nextarg], nullptr, 0));
+            }
+            else
+            {
+                snapshot_index = static_cast<int>(strtol(argv[nextarg], nullptr, 0));
+            }
+#else
+            printf("-%s needs simulation built with SAVABLE=1\n", opt);
+            exit(EXIT_FAILURE);
+#endif
         }
-        if (strcmp(argv[nextarg] + 1, "u") == 0)
+        else if (strcmp(argv[nextarg] + 1, "u") == 0)
         {
             nextarg += 1;
             if (nextarg >= argc)
@@ -9794,53 +13943,184 @@ int main(int argc, char ** argv)
                 printf("-u needs filename\n");
                 exit(EXIT_FAILURE);
             }
-            // upload_data = true;
-            upload_name[num_uploads] = argv[nextarg];
-            num_uploads++;
+            // optional "@offset" and ":length" suffix (only if numeric, so '@' in a file name still works)
+            upload_t     upload = {argv[nextarg], 0, 0, nullptr, 0};
+            const char * at     = strrchr(argv[nextarg], '@');
+            if (at != nullptr)
+            {
+                char * endptr = nullptr;
+                size_t offset = strtoul(at + 1, &endptr, 0);
+                size_t length = 0;
+                if (endptr != at + 1 && *endptr == ':')
+                {
+                    length = strtoul(endptr + 1, &endptr, 0);
+                }
+                if (endptr != at + 1 && *endptr == '\0')
+                {
+                    upload.name.assign(argv[nextarg], at - argv[nextarg]);
+                    upload.offset = offset;
+                    upload.length = length;
+                }
+            }
+            uploads.push_back(upload);
         }
         nextarg += 1;
     }
 
-    if (num_uploads)
+    // log output after this point goes to event log (flushed by writer thread at exit)
+    if (event_log)
+    {
+        logonly_printf("Logging to \"" LOGDIR "xosera_vsim_events.bin\" (decode with sim/xosera_evlog)\n");
+        fflush(logfile);
+        evlog = new EventLog;
+        evlog->init(LOGDIR "xosera_vsim_events.bin");
+        atexit([]() { evlog->finish(); });
+    }
+
+    // -n without -f means no frame images (like before), headless builds default to PPM output
+    if (SDL_RENDER && !sim_render && !frame_format_set)
+    {
+        frame_format = FRAME_NONE;
+    }
+    // -check needs captured frames (and an image format for mismatched frames)
+    FrameCheck * check = nullptr;
+    if (check_dir != nullptr)
     {
-        for (int u = 0; u < num_uploads; u++)
+        if (frame_format == FRAME_NONE)
         {
-            logonly_printf("Reading upload data #%d: \"%s\"...", u + 1, upload_name[u]);
-            FILE * bfp = fopen(upload_name[u], "r");
-            if (bfp != nullptr)
-            {
-                int read_size = fread(upload_buffer, 1, sizeof(upload_buffer), bfp);
-                fclose(bfp);
+            frame_format = SDL_RENDER ? FRAME_PNG : FRAME_PPM;
+        }
+        check = new FrameCheck;
+        check->init(check_dir, check_update, check_max);
+    }
+    sim_capture = sim_render || frame_format != FRAME_NONE;
 
-                if (read_size > 0)
-                {
-                    logonly_printf("read %d bytes.\n", read_size);
-                    upload_size[u]    = read_size;
-                    upload_payload[u] = (uint8_t *)malloc(read_size);
-                    memcpy(upload_payload[u], upload_buffer, read_size);
-                }
-                else
-                {
-                    fprintf(stderr, "Reading upload data \"%s\" error ", upload_name[u]);
-                    perror("fread failed");
-                    exit(EXIT_FAILURE);
-                }
-            }
-            else
-            {
-                fprintf(stderr, "Reading upload data \"%s\" error ", upload_name[u]);
-                perror("fopen failed");
-                exit(EXIT_FAILURE);
-            }
+    // map upload files (no copy, pages are read from disk as the bus upload consumes them)
+    for (size_t u = 0; u < uploads.size(); u++)
+    {
+        upload_t & upload = uploads[u];
+        logonly_printf("Mapping upload data #%d: \"%s\"...", static_cast<int>(u + 1), upload.name.c_str());
+        int fd = open(upload.name.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            fprintf(stderr, "Reading upload data \"%s\" error ", upload.name.c_str());
+            perror("open failed");
+            exit(EXIT_FAILURE);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            fprintf(stderr, "Reading upload data \"%s\" error ", upload.name.c_str());
+            perror("fstat failed");
+            exit(EXIT_FAILURE);
+        }
+        size_t file_size = st.st_size;
+        size_t length    = upload.length ? upload.length : file_size - std::min(upload.offset, file_size);
+        if (upload.offset >= file_size || length > file_size - upload.offset || length > INT_MAX)
+        {
+            fprintf(stderr,
+                    "Upload data \"%s\" offset 0x%zx length 0x%zx not within file size 0x%zx\n",
+                    upload.name.c_str(),
+                    upload.offset,
+                    length,
+                    file_size);
+            exit(EXIT_FAILURE);
+        }
+        // mmap offset must be page aligned
+        size_t map_offset = upload.offset & ~(static_cast<size_t>(sysconf(_SC_PAGESIZE)) - 1);
+        size_t map_length = length + (upload.offset - map_offset);
+        void * map        = mmap(nullptr, map_length, PROT_READ, MAP_PRIVATE, fd, map_offset);
+        close(fd);
+        if (map == MAP_FAILED)
+        {
+            fprintf(stderr, "Reading upload data \"%s\" error ", upload.name.c_str());
+            perror("mmap failed");
+            exit(EXIT_FAILURE);
         }
+        madvise(map, map_length, MADV_SEQUENTIAL);
+        upload.payload = static_cast<const uint8_t *>(map) + (upload.offset - map_offset);
+        upload.size    = static_cast<int>(length);
+        logonly_printf("mapped %d bytes at offset 0x%zx.\n", upload.size, upload.offset);
     }
 
 
 #if BUS_INTERFACE
-    // bus test data init
+    // bus test data init (-script replaces compiled in test_data, command line words replace both)
+    BusScript bus_script;
+    if (bus_script_name)
+    {
+        bus_script.load(bus_script_name);
+    }
     bus.set_cmdline_data(argc, argv, nextarg);
 #endif
 
+    AudioCapture * acap = nullptr;
+    if (audio_capture)
+    {
+        acap = new AudioCapture;
+        acap->init(audio_rate, audio_taps);
+    }
+
+    LatencyStats * lstats = nullptr;
+    if (latency_stats)
+    {
+        lstats = new LatencyStats;
+        lstats->init();
+    }
+
+    // -cosim replaces all other bus test_data (host queues words at run time), -replay issues recorded host words
+    if (replay_name != nullptr)
+    {
+        if (cosim_name != nullptr || record_name != nullptr)
+        {
+            printf("-replay can't be used with -cosim or -record\n");
+            exit(EXIT_FAILURE);
+        }
+        cosim            = new CoSimBridge;
+        int recorded_div = cosim->init_replay(replay_name, replay_gap, replay_lenient);
+        spi_cosim        = recorded_div != 0;
+        spi_div          = spi_cosim ? recorded_div : spi_div;
+    }
+    else if (cosim_name != nullptr)
+    {
+        cosim = new CoSimBridge;
+        cosim->init(cosim_name);
+        if (record_name != nullptr)
+        {
+            cosim->init_record(record_name, spi_cosim ? spi_div : 0);
+        }
+    }
+    else if (record_name != nullptr)
+    {
+        printf("-record needs -cosim <name>\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // -spi host words go to SPI target (which drives bus inputs) instead of bus test_data
+    if (spi_cosim)
+    {
+#if !SIM_SPI
+        printf("-spi needs simulation built with SPI=1\n");
+        exit(EXIT_FAILURE);
+#endif
+        if (cosim == nullptr)
+        {
+            printf("-spi needs -cosim <name>\n");
+            exit(EXIT_FAILURE);
+        }
+        sim_bus = false;
+        spi     = new SpiTarget;
+        spi->init(spi_div, spi_gap);
+    }
+
+    // -blitbench replaces all other bus test_data
+    BlitBench * bbench = nullptr;
+    if (blit_bench)
+    {
+        bbench = new BlitBench;
+        bbench->init();
+    }
+
     Verilated::commandArgs(argc, argv);
 
 #if VM_TRACE
@@ -9852,32 +14132,44 @@ int main(int argc, char ** argv)
 #if SDL_RENDER
     SDL_Renderer * renderer = nullptr;
     SDL_Window *   window   = nullptr;
-    if (sim_render)
+    SDL_Texture *  texture  = nullptr;
+    if (frame_format == FRAME_PNG)
     {
-        if (SDL_Init(SDL_INIT_VIDEO) != 0)
+        if ((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0)
         {
-            fprintf(stderr, "SDL_Init() failed: %s\n", SDL_GetError());
+            fprintf(stderr, "IMG_Init() failed: %s\n", SDL_GetError());
             return EXIT_FAILURE;
         }
-        if ((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0)
+    }
+    if (sim_render)
+    {
+        if (SDL_Init(SDL_INIT_VIDEO) != 0)
         {
-            fprintf(stderr, "IMG_Init() failed: %s\n", SDL_GetError());
+            fprintf(stderr, "SDL_Init() failed: %s\n", SDL_GetError());
             return EXIT_FAILURE;
         }
 
         window = SDL_CreateWindow(
             "Xosera-sim", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, TOTAL_WIDTH, TOTAL_HEIGHT, SDL_WINDOW_SHOWN);
 
-        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+        renderer = SDL_CreateRenderer(window, -1, 0);
         SDL_RenderSetScale(renderer, 1, 1);
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
         SDL_RenderClear(renderer);
-    }
 
-    bool shot_all  = true;        // screenshot all frames
+        // pixels are written to frame_buffer, then streamed to this texture once per frame
+        texture = SDL_CreateTexture(
+            renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, TOTAL_WIDTH, TOTAL_HEIGHT);
+        if (texture == nullptr)
+        {
+            fprintf(stderr, "SDL_CreateTexture() failed: %s\n", SDL_GetError());
+            return EXIT_FAILURE;
+        }
+    }
+#endif        // SDL_RENDER
+    bool shot_all  = check == nullptr;        // screenshot all frames (-check only saves mismatched frames)
     bool take_shot = false;
 
-#endif        // SDL_RENDER
     int  current_x          = 0;
     int  current_y          = 0;
     bool vga_hsync_previous = false;
@@ -9890,24 +14182,80 @@ int main(int argc, char ** argv)
     int  vsync_count  = 0;
     bool image_loaded = false;
 
-#if VM_TRACE
-#if USE_FST
-    const auto trace_path = LOGDIR "xosera_vsim.fst";
-    logonly_printf("Writing FST waveform file to \"%s\"...\n", trace_path);
-    VerilatedFstC * tfp = new VerilatedFstC;
-#else
-    const auto trace_path = LOGDIR "xosera_vsim.vcd";
-    logonly_printf("Writing VCD waveform file to \"%s\"...\n", trace_path);
-    VerilatedVcdC * tfp = new VerilatedVcdC;
-#endif
+    if (snapshot_save_name != nullptr && snapshot_frame < 0 && snapshot_index < 0)
+    {
+        snapshot_frame = 1;        // default to saving at start of first frame
+    }
 
+#if VM_TRACE
+    trace_file_t * tfp = new trace_file_t;
+    TraceWindow    trace_window;
     top->trace(tfp, 99);        // trace to heirarchal depth of 99
-    tfp->open(trace_path);
+    if (trace_triggers.empty())
+    {
+        const auto trace_path = LOGDIR "xosera_vsim" TRACE_EXT;
+        logonly_printf("Writing waveform file to \"%s\"...\n", trace_path);
+        tfp->open(trace_path);
+    }
+    else
+    {
+        logonly_printf("Writing waveform trigger windows to \"" LOGDIR "xosera_vsim_w<n>" TRACE_EXT "\"...\n");
+        trace_window.init(tfp);
+    }
 #endif
 
+    VramProfiler * vprof = nullptr;
+    if (vram_profile)
+    {
+        vprof = new VramProfiler;
+        vprof->init();
+    }
+
+    CopperProfiler * cprof = nullptr;
+    if (copper_profile)
+    {
+        cprof = new CopperProfiler;
+        for (auto name : copper_listings)
+        {
+            cprof->read_listing(name);
+        }
+        cprof->init(copper_profile_frame);
+    }
+
     top->reset_i = 1;        // start in reset
 
     bus.init(top, sim_bus);
+    bus.set_fast(fast_bus, backdoor_upload);
+    if (bus.timing_relaxed())
+    {
+        log_printf("TIMING-RELAXED: %s%s%s (bus timing not representative of a real host)\n",
+                   fast_bus ? "-fastbus minimum strobe spacing" : "",
+                   fast_bus && backdoor_upload ? ", " : "",
+                   backdoor_upload ? "-backdoor VRAM/XR uploads" : "");
+    }
+
+#if SIM_SAVABLE
+    if (snapshot_restore_name != nullptr)
+    {
+        frame_state_t fs;
+        restore_snapshot(snapshot_restore_name, top, fs);
+        current_x          = fs.current_x;
+        current_y          = fs.current_y;
+        vga_hsync_previous = fs.vga_hsync_previous;
+        vga_vsync_previous = fs.vga_vsync_previous;
+        frame_num          = fs.frame_num;
+        x_max              = fs.x_max;
+        y_max              = fs.y_max;
+        hsync_count        = fs.hsync_count;
+        hsync_min          = fs.hsync_min;
+        hsync_max          = fs.hsync_max;
+        vsync_count        = fs.vsync_count;
+    }
+#endif
+
+    auto       wall_start       = std::chrono::steady_clock::now();
+    vluint64_t wall_start_ticks = main_time / 2;                      // non-zero if restored from snapshot
+    int        wall_start_frame = frame_num > 0 ? frame_num : 0;
 
     while (!done && !Verilated::gotFinish())
     {
@@ -9919,16 +14267,61 @@ int main(int argc, char ** argv)
 #if BUS_INTERFACE
         bus.process(top);
 #endif
+        if (spi != nullptr)
+        {
+            spi->cycle(top);
+        }
 
         top->eval();         // see https://lawrie.github.io/blackicemxbook/Simulation/Simulation.html
         top->clk = 1;        // clock rising
         top->eval();
 
 #if VM_TRACE
-        if (frame_num <= MAX_TRACE_FRAMES)
+        if (!trace_triggers.empty())
+        {
+            trace_window.check_events(top, frame_num, current_y);        // before dump, so trigger edge is included
+        }
+        if (trace_triggers.empty() ? frame_num <= MAX_TRACE_FRAMES : trace_window.dumping())
             tfp->dump(main_time);
 #endif
 
+        if (vprof != nullptr && frame_num > 0)
+        {
+            vprof->cycle(top, current_x, current_y);
+        }
+
+        if (cprof != nullptr)
+        {
+            cprof->cycle(top, frame_num, current_y);
+        }
+
+        if (bbench != nullptr)
+        {
+            bbench->cycle(top);
+        }
+
+        if (acap != nullptr)
+        {
+            acap->cycle(top);
+        }
+
+        if (lstats != nullptr)
+        {
+            lstats->cycle(top);
+        }
+
+        if (cosim != nullptr)
+        {
+            cosim->cycle(top);
+        }
+
+        if (memsnap_why != nullptr || memsnap_signal)
+        {
+            memsnap.save(top, frame_num, memsnap_why != nullptr ? memsnap_why : "SIGUSR1");
+            memsnap_why    = nullptr;
+            memsnap_signal = 0;
+        }
+
         if (top->reconfig_o)
         {
             log_printf("FPGA RECONFIG: config #0x%x\n", top->boot_select_o);
@@ -9937,48 +14330,64 @@ int main(int argc, char ** argv)
 
         if (top->bus_intr_o)
         {
-            logonly_printf("[@t=%8lu FPGA INTERRUPT]\n", main_time);
+            if (evlog != nullptr)
+            {
+                evlog->put(EV_INTR, main_time, 0, 0, 0);
+            }
+            else
+            {
+                logonly_printf("[@t=%8lu FPGA INTERRUPT]\n", main_time);
+            }
         }
 
         if (frame_num > 1)
         {
-            if (top->xosera_main->vram_arb->regs_ack_o)
+            if (XOSERA_MAIN(top)->vram_arb->regs_ack_o && evlog != nullptr)
+            {
+                auto arb = XOSERA_MAIN(top)->vram_arb;
+                evlog->put(arb->regs_wr_i ? EV_VRAM_WR : EV_VRAM_RD,
+                           main_time,
+                           0,
+                           arb->regs_addr_i,
+                           arb->regs_wr_i ? arb->regs_data_i : arb->vram_data_o);
+            }
+            else if (XOSERA_MAIN(top)->vram_arb->regs_ack_o)
             {
-                if (top->xosera_main->vram_arb->regs_wr_i)
+                if (XOSERA_MAIN(top)->vram_arb->regs_wr_i)
                 {
                     logonly_printf(" => regs write VRAM[0x%04x]<=0x%04x\n",
-                                   top->xosera_main->vram_arb->regs_addr_i,
-                                   top->xosera_main->vram_arb->regs_data_i);
+                                   XOSERA_MAIN(top)->vram_arb->regs_addr_i,
+                                   XOSERA_MAIN(top)->vram_arb->regs_data_i);
                 }
                 else
                 {
                     logonly_printf(" <= regs read VRAM[0x%04x]=>0x%04x\n",
-                                   top->xosera_main->vram_arb->regs_addr_i,
-                                   top->xosera_main->vram_arb->vram_data_o);
+                                   XOSERA_MAIN(top)->vram_arb->regs_addr_i,
+                                   XOSERA_MAIN(top)->vram_arb->vram_data_o);
                 }
             }
 #if 0
-            if (top->xosera_main->xrmem_arb->xr_ack_o)
+            if (XOSERA_MAIN(top)->xrmem_arb->xr_ack_o)
             {
-                if (top->xosera_main->xrmem_arb->xr_wr_i)
+                if (XOSERA_MAIN(top)->xrmem_arb->xr_wr_i)
                 {
                     logonly_printf(" => regs write XR[0x%04x]<=0x%04x\n",
-                                   top->xosera_main->xrmem_arb->xr_addr_i,
-                                   top->xosera_main->xrmem_arb->xr_data_i);
+                                   XOSERA_MAIN(top)->xrmem_arb->xr_addr_i,
+                                   XOSERA_MAIN(top)->xrmem_arb->xr_data_i);
                 }
                 else
                 {
                     logonly_printf(" <= regs read XR[0x%04x]=>0x%04x\n",
-                                   top->xosera_main->xrmem_arb->xr_addr_i,
-                                   top->xosera_main->xrmem_arb->xr_data_o);
+                                   XOSERA_MAIN(top)->xrmem_arb->xr_addr_i,
+                                   XOSERA_MAIN(top)->xrmem_arb->xr_data_o);
                 }
             }
 
-            if (top->xosera_main->xrmem_arb->copp_xr_sel_i)
+            if (XOSERA_MAIN(top)->xrmem_arb->copp_xr_sel_i)
             {
                 logonly_printf(" => COPPER XR write XR[0x%04x]<=0x%04x\n",
-                               top->xosera_main->xrmem_arb->copp_xr_addr_i,
-                               top->xosera_main->xrmem_arb->copp_xr_data_i);
+                               XOSERA_MAIN(top)->xrmem_arb->copp_xr_addr_i,
+                               XOSERA_MAIN(top)->xrmem_arb->copp_xr_data_i);
             }
 #endif
         }
@@ -9986,17 +14395,13 @@ int main(int argc, char ** argv)
         bool hsync = H_SYNC_POLARITY ? top->hsync_o : !top->hsync_o;
         bool vsync = V_SYNC_POLARITY ? top->vsync_o : !top->vsync_o;
 
-#if SDL_RENDER
-        if (sim_render)
+        if (sim_capture)
         {
+            uint32_t argb;
             if (top->dv_de_o)
             {
                 // sim_render current VGA output pixel (4 bits per gun)
-                SDL_SetRenderDrawColor(renderer,
-                                       (top->red_o << 4) | top->red_o,
-                                       (top->green_o << 4) | top->green_o,
-                                       (top->blue_o << 4) | top->blue_o,
-                                       255);
+                argb = 0xff000000 | (top->red_o * 0x110000) | (top->green_o * 0x001100) | (top->blue_o * 0x000011);
             }
             else
             {
@@ -10015,24 +14420,27 @@ int main(int argc, char ** argv)
                 if (((current_x ^ current_y) & 1) == 1)        // non-visible
                 {
                     // dither with dimmed color 0 // TODO: fix border
-                    //                    auto       vmem    = top->xosera_main->xrmem_arb->colormem->bram;
+                    //                    auto       vmem    = XOSERA_MAIN(top)->xrmem_arb->colormem->bram;
                     //                    uint16_t * color0p = &vmem[0];
                     uint16_t color0 = 0;        //*color0p;
-                    SDL_SetRenderDrawColor(
-                        renderer, ((color0 & 0x0f00) >> 5), ((color0 & 0x00f0) >> 1), ((color0 & 0x000f) << 7), 255);
+                    argb            = 0xff000000 | (((color0 & 0x0f00) >> 5) << 16) | (((color0 & 0x00f0) >> 1) << 8) |
+                           (((color0 & 0x000f) << 7) & 0xff);
                 }
                 else
                 {
-                    SDL_SetRenderDrawColor(renderer, 0x21, vsync ? 0x41 : 0x21, hsync ? 0x41 : 0x21, 0xff);
+                    argb = 0xff210000 | ((vsync ? 0x41 : 0x21) << 8) | (hsync ? 0x41 : 0x21);
                 }
             }
 
-            if (frame_num > 0)
+            if (frame_num > 0 && current_x < TOTAL_WIDTH && current_y < TOTAL_HEIGHT)
             {
-                SDL_RenderDrawPoint(renderer, current_x, current_y);
+                frame_buffer[current_y][current_x] = argb;
+                if (check != nullptr && top->dv_de_o)
+                {
+                    check->pixel(argb);
+                }
             }
         }
-#endif
         current_x++;
 
         if (hsync)
@@ -10053,9 +14461,21 @@ int main(int argc, char ** argv)
             if (current_x > x_max)
                 x_max = current_x;
 
+            if (cprof != nullptr)
+            {
+                cprof->end_line(frame_num, current_y);
+            }
+
             current_x = 0;
             current_y++;
 
+#if VM_TRACE
+            if (!trace_triggers.empty())
+            {
+                trace_window.scanline(frame_num, current_y);
+            }
+#endif
+
             if (vsync)
                 vsync_count++;
         }
@@ -10092,43 +14512,64 @@ int main(int argc, char ** argv)
                     hsync_max,
                     vsync_count);
 
-#if SDL_RENDER
+                if (vprof != nullptr)
+                {
+                    vprof->end_frame(frame_num);
+                }
 
-                if (sim_render)
+                if (memsnap.at_frame(frame_num))
+                {
+                    char why[32];
+                    snprintf(why, sizeof(why), "frame %d", frame_num);
+                    memsnap.save(top, frame_num, why);
+                }
+
+                if (check != nullptr && !check->end_frame(frame_num))
+                {
+                    done = true;
+                }
+
+                if (frame_format != FRAME_NONE &&
+                    (shot_all || take_shot || (frame_num == MAX_TRACE_FRAMES && check == nullptr)))
                 {
-                    if (shot_all || take_shot || frame_num == MAX_TRACE_FRAMES)
+                    char save_base[256] = {0};
+                    char save_name[256] = {0};
+                    snprintf(save_base,
+                             sizeof(save_base),
+                             LOGDIR "xosera_vsim_%dx%d_f%02d",
+                             VISIBLE_WIDTH,
+                             VISIBLE_HEIGHT,
+                             frame_num);
+                    if (save_frame(save_base, save_name, sizeof(save_name)))
                     {
-                        int  w = 0, h = 0;
-                        char save_name[256] = {0};
-                        SDL_GetRendererOutputSize(renderer, &w, &h);
-                        SDL_Surface * screen_shot =
-                            SDL_CreateRGBSurface(0, w, h, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
-                        SDL_RenderReadPixels(
-                            renderer, NULL, SDL_PIXELFORMAT_ARGB8888, screen_shot->pixels, screen_shot->pitch);
-                        snprintf(save_name,
-                                 sizeof(save_name),
-                                 LOGDIR "xosera_vsim_%dx%d_f%02d.png",
-                                 VISIBLE_WIDTH,
-                                 VISIBLE_HEIGHT,
-                                 frame_num);
-                        IMG_SavePNG(screen_shot, save_name);
-                        SDL_FreeSurface(screen_shot);
                         float fnum = ((1.0 / PIXEL_CLOCK_MHZ) * ((main_time - first_frame_start) / 2)) / 1000.0;
                         log_printf("[@t=%8lu] %8.03f ms frame #%3u saved as \"%s\" (%dx%d)\n",
                                    main_time,
                                    fnum,
                                    frame_num,
                                    save_name,
-                                   w,
-                                   h);
-                        take_shot = false;
+                                   TOTAL_WIDTH,
+                                   TOTAL_HEIGHT);
                     }
+                    else
+                    {
+                        log_printf("[@t=%8lu] frame #%3u save as \"%s\" failed\n", main_time, frame_num, save_name);
+                    }
+                    take_shot = false;
+                }
 
+#if SDL_RENDER
+                if (sim_render)
+                {
+                    SDL_UpdateTexture(texture, nullptr, frame_buffer, sizeof(frame_buffer[0]));
+                    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
                     SDL_RenderPresent(renderer);
-                    SDL_SetRenderDrawColor(renderer, 0x20, 0x20, 0x20, 0xff);
-                    SDL_RenderClear(renderer);
                 }
 #endif
+                if (sim_capture)
+                {
+                    std::fill(&frame_buffer[0][0], &frame_buffer[0][0] + (TOTAL_WIDTH * TOTAL_HEIGHT), 0xff202020);
+                }
             }
             frame_start_time = main_time;
             hsync_min        = 0;
@@ -10136,7 +14577,8 @@ int main(int argc, char ** argv)
             vsync_count      = 0;
             current_y        = 0;
 
-            if (frame_num == MAX_TRACE_FRAMES)
+            if (frame_num == MAX_TRACE_FRAMES && bbench == nullptr &&
+                cosim == nullptr)        // -blitbench and -cosim run until REG_END
             {
                 break;
             }
@@ -10159,11 +14601,32 @@ int main(int argc, char ** argv)
         top->eval();
 
 #if VM_TRACE
-        if (frame_num <= MAX_TRACE_FRAMES)
+        if (trace_triggers.empty() ? frame_num <= MAX_TRACE_FRAMES : trace_window.dumping())
             tfp->dump(main_time);
 #endif
         main_time++;
 
+#if SIM_SAVABLE
+        if (snapshot_save_name != nullptr &&
+            ((snapshot_frame >= 0 && frame_num >= snapshot_frame) ||
+             (snapshot_index >= 0 && bus.get_index() >= snapshot_index)))
+        {
+            frame_state_t fs = {current_x,
+                                current_y,
+                                vga_hsync_previous,
+                                vga_vsync_previous,
+                                frame_num,
+                                x_max,
+                                y_max,
+                                hsync_count,
+                                hsync_min,
+                                hsync_max,
+                                vsync_count};
+            save_snapshot(snapshot_save_name, top, fs);
+            snapshot_save_name = nullptr;
+        }
+#endif
+
 #if SDL_RENDER
         if (sim_render)
         {
@@ -10183,7 +14646,7 @@ int main(int argc, char ** argv)
     FILE * mfp = fopen(LOGDIR "xosera_vsim_text.txt", "w");
     if (mfp != nullptr)
     {
-        auto       vmem = top->xosera_main->vram_arb->vram->memory;
+        auto       vmem = XOSERA_MAIN(top)->vram_arb->vram->memory;
         uint16_t * mem  = &vmem[0];
 
         for (int y = 0; y < VISIBLE_HEIGHT / 16; y++)
@@ -10213,7 +14676,7 @@ int main(int argc, char ** argv)
         FILE * bfp = fopen(LOGDIR "xosera_vsim_vram.bin", "w");
         if (bfp != nullptr)
         {
-            auto       vmem = top->xosera_main->vram_arb->vram->memory;
+            auto       vmem = XOSERA_MAIN(top)->vram_arb->vram->memory;
             uint16_t * mem  = &vmem[0];
             fwrite(mem, 128 * 1024, 1, bfp);
             fclose(bfp);
@@ -10224,7 +14687,7 @@ int main(int argc, char ** argv)
         FILE * tfp = fopen(LOGDIR "xosera_vsim_vram_hex.txt", "w");
         if (tfp != nullptr)
         {
-            auto       vmem = top->xosera_main->vram_arb->vram->memory;
+            auto       vmem = XOSERA_MAIN(top)->vram_arb->vram->memory;
             uint16_t * mem  = &vmem[0];
             for (int i = 0; i < 65536; i += 16)
             {
@@ -10240,10 +14703,72 @@ int main(int argc, char ** argv)
     }
 #endif
 
+    double wall_secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
     top->final();
 
+    if (vprof != nullptr)
+    {
+        vprof->finish();
+        delete vprof;
+    }
+
+    if (cprof != nullptr)
+    {
+        cprof->finish();
+        delete cprof;
+    }
+
+    if (bbench != nullptr)
+    {
+        bbench->finish();
+        delete bbench;
+    }
+
+    if (acap != nullptr)
+    {
+        acap->finish();
+        delete acap;
+    }
+
+    if (lstats != nullptr)
+    {
+        lstats->finish();
+        delete lstats;
+    }
+
+    memsnap.finish();
+
+    bool sim_pass = true;
+    if (check != nullptr)
+    {
+        sim_pass = check->finish();
+        delete check;
+    }
+
+    if (spi != nullptr)
+    {
+        spi->finish();
+        delete spi;
+        spi = nullptr;
+    }
+
+    if (cosim != nullptr)
+    {
+        sim_pass = cosim->finish() && sim_pass;
+        delete cosim;
+        cosim = nullptr;
+    }
+
 #if VM_TRACE
-    tfp->close();
+    if (trace_triggers.empty())
+    {
+        tfp->close();
+    }
+    else
+    {
+        trace_window.finish(frame_num, current_y);
+    }
 #endif
 
 #if SDL_RENDER
@@ -10259,16 +14784,35 @@ int main(int argc, char ** argv)
             fgetc(stdin);
         }
 
+        SDL_DestroyTexture(texture);
+        SDL_DestroyRenderer(renderer);
         SDL_DestroyWindow(window);
-        IMG_Quit();
         SDL_Quit();
     }
+    if (frame_format == FRAME_PNG)
+    {
+        IMG_Quit();
+    }
 #endif
 
     log_printf("Simulation ended after %d frames, %lu pixel clock ticks (%.04f milliseconds)\n",
                frame_num,
                (main_time / 2),
                ((1.0 / (PIXEL_CLOCK_MHZ * 1000000)) * (main_time / 2)) * 1000.0);
+    if (wall_secs > 0.0)
+    {
+        double clocks_per_sec = ((main_time / 2) - wall_start_ticks) / wall_secs;
+        log_printf("Simulation throughput: %.0f pixel clocks/sec, %.03f frames/sec, %.03f%% of real-time (%.03f "
+                   "sec wall-clock, %d model thread%s, trace %s%s)\n",
+                   clocks_per_sec,
+                   ((frame_num > 0 ? frame_num : 0) - wall_start_frame) / wall_secs,
+                   (clocks_per_sec / (PIXEL_CLOCK_MHZ * 1000000)) * 100.0,
+                   wall_secs,
+                   SIM_THREADS,
+                   SIM_THREADS == 1 ? "" : "s",
+                   VM_TRACE ? "on" : "off",
+                   bus.timing_relaxed() ? ", TIMING-RELAXED bus" : "");
+    }
 
-    return EXIT_SUCCESS;
+    return sim_pass ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,151 @@
+// xosera_spi_sim.sv - Verilator simulation top for SPI=1 builds (see sim.mk)
+//
+// vim: set et ts=4 sw=4
+//
+// Copyright (c) 2020 Xark - https://hackaday.io/Xark
+//
+// See top-level LICENSE file for license information. (Hint: MIT)
+//
+// Wraps xosera_main with spi_target.sv and the icebreaker/xosera_iceb.sv SPI_INTERFACE command bridge, so -spi
+// co-simulation clocks host SPI bytes through the same RTL as the iCEBreaker SPI build.  Has the same ports as
+// xosera_main (used when spi_sel_i is 0) plus the SPI pins.
+//
+`default_nettype none               // mandatory for Verilog sanity
+`timescale 1ns/1ps                  // mandatory to shut up Icarus Verilog
+
+`ifdef SPI_INTERFACE
+
+`include "xosera_pkg.sv"
+
+module xosera_spi_sim(
+    input  wire logic           bus_cs_n_i,         // register select strobe (active low)
+    input  wire logic           bus_rd_nwr_i,       // 0 = write, 1 = read
+    input  wire logic [3:0]     bus_reg_num_i,      // register number
+    input  wire logic           bus_bytesel_i,      // 0 = even byte, 1 = odd byte
+    input  wire logic [7:0]     bus_data_i,         // 8-bit data bus input
+    output logic      [7:0]     bus_data_o,         // 8-bit data bus output
+    output logic                bus_intr_o,         // Xosera CPU interrupt strobe
+    output logic      [3:0]     red_o,              // red color gun output
+    output logic      [3:0]     green_o,            // green color gun output
+    output logic      [3:0]     blue_o,             // blue color gun output
+    output logic                hsync_o, vsync_o,   // horizontal and vertical sync
+    output logic                dv_de_o,            // pixel visible (aka display enable)
+    output logic                audio_l_o,          // left channel audio PWM output
+    output logic                audio_r_o,          // right channel audio PWM output
+    output logic                serial_txd_o,       // UART transmit
+    input  wire logic           serial_rxd_i,       // UART receive
+    output logic                reconfig_o,         // reconfigure iCE40 from flash
+    output logic      [1:0]     boot_select_o,      // reconfigure configuration number (0-3)
+    input  wire logic           spi_sel_i,          // 1 = SPI bridge drives bus (-spi), 0 = bus_xxx_i inputs
+    input  wire logic           spi_sck_i,          // SPI clock from controller
+    input  wire logic           spi_copi_i,         // SPI controller out/peripheral in
+    output logic                spi_cipo_o,         // SPI controller in/peripheral out
+    input  wire logic           spi_cs_n_i,         // SPI CS for FPGA from controller
+    input  wire logic           reset_i,            // reset signal
+    input  wire logic           clk                 // pixel clock
+);
+/* verilator public_module */
+
+logic           bus_cs_n;                   // bus signals to xosera_main
+logic           bus_rd_nwr;
+logic  [3:0]    bus_reg_num;
+logic           bus_bytesel;
+logic  [7:0]    bus_data_in;
+logic  [7:0]    bus_data_out_r;             // registered bus_data_o (as xosera_iceb.sv)
+logic           spi_reset;                  // SPI "soft" reset
+logic           spi_reset_r;
+logic           reset;
+
+assign reset                = reset_i || spi_reset_r;
+
+xosera_main xosera_main(
+    .bus_cs_n_i(bus_cs_n),
+    .bus_rd_nwr_i(bus_rd_nwr),
+    .bus_reg_num_i(bus_reg_num),
+    .bus_bytesel_i(bus_bytesel),
+    .bus_data_i(bus_data_in),
+    .bus_data_o(bus_data_o),
+    .bus_intr_o(bus_intr_o),
+    .red_o(red_o),
+    .green_o(green_o),
+    .blue_o(blue_o),
+    .hsync_o(hsync_o),
+    .vsync_o(vsync_o),
+    .dv_de_o(dv_de_o),
+    .audio_l_o(audio_l_o),
+    .audio_r_o(audio_r_o),
+    .serial_txd_o(serial_txd_o),
+    .serial_rxd_i(serial_rxd_i),
+    .reconfig_o(reconfig_o),
+    .boot_select_o(boot_select_o),
+    .reset_i(reset),
+    .clk(clk)
+);
+
+// SPI command bridge below matches xosera_iceb.sv SPI_INTERFACE
+
+logic   spi_select;
+logic   spi_receive_strobe;
+/* verilator lint_off UNUSED */
+logic   spi_transmit_strobe;
+/* verilator lint_on UNUSED */
+logic   [7:0] spi_receive_data;
+logic   [7:0] spi_transmit_data;
+
+spi_target  spi_target(
+            .spi_sck_i(spi_sck_i),
+            .spi_copi_i(spi_copi_i),
+            .spi_cipo_o(spi_cipo_o),
+            .spi_cs_i(spi_cs_n_i),
+            .select_o(spi_select),
+            .receive_strobe_o(spi_receive_strobe),
+            .receive_byte_o(spi_receive_data),
+            .transmit_strobe_o(spi_transmit_strobe),
+            .transmit_byte_i(spi_transmit_data),
+            .reset_i(reset),
+            .clk(clk)
+);
+// SPI cmd byte (all active HIGH):
+//  7  6  5  4  3  2  1  0
+// CS WR RS BS R3 R2 R1 R0
+logic [7:0] spi_cmd_byte;
+logic [7:0] spi_data_byte;
+logic       spi_payload_byte;           // true on 2nd byte (payload byte) of packet
+logic       spi_cs_hold0;               // saved CS from spi_cmd_byte (held for two cycles)
+logic       spi_cs_hold1;               // saved CS from spi_cmd_byte (held for two cycles)
+
+assign bus_cs_n             = spi_sel_i ? ~spi_cs_hold0     : bus_cs_n_i;       // CS bit
+assign bus_rd_nwr           = spi_sel_i ? ~spi_cmd_byte[6]  : bus_rd_nwr_i;     // WR bit
+assign bus_bytesel          = spi_sel_i ? spi_cmd_byte[4]   : bus_bytesel_i;    // BS bit
+assign bus_reg_num          = spi_sel_i ? spi_cmd_byte[3:0] : bus_reg_num_i;    // register bits
+assign bus_data_in          = spi_sel_i ? spi_data_byte     : bus_data_i;       // bus data to write
+assign spi_reset            = spi_sel_i && spi_cmd_byte[5];                     // RS bit
+assign spi_transmit_data    = spi_payload_byte ? bus_data_out_r : 8'hCB;        // bus data to read
+
+always_ff @(posedge clk) begin
+    bus_data_out_r      <= bus_data_o;
+    spi_reset_r         <= spi_reset;                   // registered into reset (as xosera_iceb.sv)
+    spi_cs_hold0        <= spi_cs_hold1;                // clear held CS
+    spi_cs_hold1        <= 1'b0;                        // clear held CS
+    spi_cmd_byte[5]     <= 1'b0;                        // clear RS bit
+    if (!spi_select) begin                              // if SPI de-selected
+        spi_payload_byte    <= 1'b0;                    // next byte is command byte
+    end
+    if (spi_receive_strobe) begin                       // if an SPI byte received
+        if (!spi_payload_byte) begin                    // if not a payload byte (aka is a command byte)
+            spi_cmd_byte        <= spi_receive_data;    // save command byte
+            spi_payload_byte    <= 1'b1;
+        end
+        else begin                                      // else payload byte
+            spi_data_byte       <= spi_receive_data;    // put data byte on bus
+            spi_cs_hold0        <= spi_cmd_byte[7];     // hold CS for next cycle
+            spi_cs_hold1        <= spi_cmd_byte[7];     // hold CS for next cycle
+            spi_payload_byte    <= 1'b0;                // next byte is command byte
+        end
+    end
+end
+
+endmodule
+
+`endif
+`default_nettype wire               // restore default
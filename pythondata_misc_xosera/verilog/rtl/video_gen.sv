@@ -105,6 +105,14 @@ addr_t              pa_vram_addr;                       // vram word address out
 logic               pa_tile_sel;                        // tile mem read select
 tile_addr_t         pa_tile_addr;                       // tile mem word address out (16x5K)
 
+`ifdef SIM_PROFILE
+// audio DMA vram use (for simulation VRAM profiling, public in PROFILE=1 builds)
+/* verilator lint_off UNUSEDSIGNAL */
+logic               audio_vram_req;                     // audio DMA wants vram read
+logic               audio_vram_sel;                     // vram read select is for audio DMA
+/* verilator lint_on  UNUSEDSIGNAL */
+`endif
+
 `ifdef EN_PF_B
 // playfield B generation control signals
 logic               pb_blank;                           // disable plane B
@@ -217,8 +225,15 @@ always_comb begin
     vram_addr_o     = pa_vram_addr;
     tilemem_addr_o  = pa_tile_addr;
 
+`ifdef SIM_PROFILE
+    audio_vram_req  = 1'b0;
+    audio_vram_sel  = 1'b0;
+`endif
 `ifdef EN_AUDIO
     audio_dma_cycle = 1'b0;
+`ifdef SIM_PROFILE
+    audio_vram_req  = ~audio_dma_ack & audio_dma_vram_req;
+`endif
 `endif
 
     if (pa_vram_sel) begin
@@ -230,6 +245,9 @@ always_comb begin
 `ifdef EN_AUDIO
     end else if (~audio_dma_ack & audio_dma_vram_req) begin
         audio_dma_cycle = 1'b1;
+`ifdef SIM_PROFILE
+        audio_vram_sel  = 1'b1;
+`endif
         vram_sel_o      = 1'b1;
         vram_addr_o     = audio_dma_addr;
 `endif
@@ -256,8 +274,15 @@ always_comb begin
     vram_addr_o     = pa_vram_addr;
     tilemem_addr_o  = pa_tile_addr;
 
+`ifdef SIM_PROFILE
+    audio_vram_req  = 1'b0;
+    audio_vram_sel  = 1'b0;
+`endif
 `ifdef EN_AUDIO
     audio_dma_cycle = 1'b0;
+`ifdef SIM_PROFILE
+    audio_vram_req  = ~audio_dma_ack & audio_dma_vram_req;
+`endif
 `endif
 
     if (pa_vram_sel) begin
@@ -266,6 +291,9 @@ always_comb begin
 `ifdef EN_AUDIO
     end else if (~audio_dma_ack & audio_dma_vram_req) begin
         audio_dma_cycle = 1'b1;
+`ifdef SIM_PROFILE
+        audio_vram_sel  = 1'b1;
+`endif
         vram_sel_o      = 1'b1;
         vram_addr_o     = audio_dma_addr;
 `endif
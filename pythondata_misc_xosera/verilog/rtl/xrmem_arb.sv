@@ -96,6 +96,15 @@ word_t                          copp2_data_out;
 addr_t                          xr_addr;
 word_t                          xr_write_data;
 
+`ifdef SIM_PROFILE
+// simulation backdoor XR memory write (driven from C++ for -backdoor uploads, has priority over other writes)
+/* verilator lint_off UNDRIVEN */
+logic                           sim_xr_wr;
+addr_t                          sim_xr_addr;
+word_t                          sim_xr_data;
+/* verilator lint_on UNDRIVEN */
+`endif
+
 // combinatorial write ack signals
 `ifdef EN_COPP
 logic           copp_wr_ack_next;
@@ -155,15 +164,23 @@ assign  copp_xr_color_sel   = (copp_xr_addr_i[15:14] == xv::XR_COLOR_ADDR[15:14]
 assign  copp_xr_copp_sel    = (copp_xr_addr_i[15:14] == xv::XR_COPPER_ADDR[15:14]);
 `endif
 
-`ifdef EN_COPP
 // select addr and write data from XR or copper XR write
-assign xr_addr          = copp_xr_sel_i ? copp_xr_addr_i : xr_addr_i;
-assign xr_write_data    = copp_xr_sel_i ? copp_xr_data_i : xr_data_i;
-`else
-// select addr and write data from XR
-assign xr_addr          = xr_addr_i;
-assign xr_write_data    = xr_data_i;
+always_comb begin
+    xr_addr             = xr_addr_i;
+    xr_write_data       = xr_data_i;
+`ifdef EN_COPP
+    if (copp_xr_sel_i) begin
+        xr_addr             = copp_xr_addr_i;
+        xr_write_data       = copp_xr_data_i;
+    end
+`endif
+`ifdef SIM_PROFILE
+    if (sim_xr_wr) begin
+        xr_addr             = sim_xr_addr;
+        xr_write_data       = sim_xr_data;
+    end
 `endif
+end
 
 // XR memory interface write select (copper / regs)
 always_comb begin
@@ -193,6 +210,18 @@ always_comb begin
         copp_wr_en          = xr_copp_sel;
 `endif
     end
+`ifdef SIM_PROFILE
+    // simulation backdoor write has priority (copper and regs writes wait)
+    if (sim_xr_wr) begin
+        xr_wr_ack_next      = 1'b0;
+        color_wr_en         = (sim_xr_addr[15:14] == xv::XR_COLOR_ADDR[15:14]);
+        tile_wr_en          = (sim_xr_addr[15:14] == xv::XR_TILE_ADDR[15:14]);
+`ifdef EN_COPP
+        copp_wr_ack_next    = 1'b0;
+        copp_wr_en          = (sim_xr_addr[15:14] == xv::XR_COPPER_ADDR[15:14]);
+`endif
+    end
+`endif
 end
 
 // XR read result select
@@ -235,6 +264,13 @@ always_comb begin
         xreg_rd_ack_next    = xr_regs_sel & ~xr_wr_i;
         xreg_wr_o           = xr_regs_sel & xr_wr_i;
     end
+`ifdef SIM_PROFILE
+    // XR register bus in use by simulation backdoor write (regs and copper wait)
+    if (sim_xr_wr) begin
+        xreg_rd_ack_next    = 1'b0;
+        xreg_wr_o           = 1'b0;
+    end
+`endif
 end
 
 // color mem read (vgen or reg XR memory)
@@ -195,6 +195,15 @@ $(OBJECTS): $(CASMOUTPUT) $(MAKEFILE_LIST)
 	@$(MKDIR) -p $(@D)
 	$(VASM) $(VASMFLAGS) $(EXTRA_VASMFLAGS) -L $(basename $@).lst -o $@ $<
 
+# CopAsm copper sources (all assembled by one batch mode copasm, grouped target needs GNU make 4.3 or later, older
+# make uses the per-file pattern rule below)
+ifneq ($(filter-out 3.% 4.0% 4.1% 4.2%,$(MAKE_VERSION)),)
+ifneq ($(CASMSOURCES),)
+$(addsuffix .h,$(basename $(CASMSOURCES))) &: $(CASMSOURCES) $(COPASM)
+	$(COPASM) -j 0 -v -l -i $(XOSERA_M68K_API) -o %.h $(filter %.casm,$^)
+endif
+endif
+
 # CopAsm copper source
 %.h : %.casm
 	@$(MKDIR) -p $(@D)
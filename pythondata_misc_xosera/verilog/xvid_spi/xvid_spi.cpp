@@ -67,8 +67,12 @@ enum
     SPI_CMD_REGMASK = 0x0F
 };
 
+#if !defined(DEBUG_HEXDUMP)
 #define DEBUG_HEXDUMP 1
+#endif
 
+// NOTE: can be set with CCFLAGS (e.g., for simulation "make vspibench" queue size sweep)
+#if !defined(MAX_SEND)
 #if 0
 #define MAX_SEND    1024
 #define FLUSH_QUEUE 1020
@@ -76,6 +80,11 @@ enum
 #define MAX_SEND    16
 #define FLUSH_QUEUE 4
 #endif
+#endif
+
+#if FLUSH_QUEUE + 4 > MAX_SEND
+#error FLUSH_QUEUE + 4 must be <= MAX_SEND (xvid_setw queues 4 bytes before flush check)
+#endif
 
 static uint8_t   send_buffer[MAX_SEND];
 static uint8_t   xmit_buffer[MAX_SEND];
@@ -269,10 +278,9 @@ static void reboot_Xosera(int8_t config)
         spi_queue_flush();
     } while (xvid_getw(XM_RD_ADDR) != 0x1234 || xvid_getw(XM_RD_INCR) != 0xABCD);
 
-    width  = ((xvid_getbl(XM_FEATURES) & 0xF) == 0) ? 640 : 848;
+    width  = ((xvid_getbl(XM_FEATURE) & 0xF) == 0) ? 640 : 848;
     height = 480;
-    xvid_setw(XM_RD_XADDR, XM_FEATURES);        // select features
-    features = xvid_getw(XM_XDATA);
+    features = xvid_getw(XM_FEATURE);
     printf("(%dx%d, features=0x%04x) ready.\n", width, height, features);
     columns = width / 8;
     rows    = height / 16;
@@ -951,6 +959,7 @@ void test_smoothscroll()
 
 bool reset_only    = false;
 bool no_reset      = false;
+bool bitmap_only   = false;
 int  xosera_config = -1;
 
 #define MAX_CMDS 256
@@ -971,6 +980,11 @@ int main(int argc, char ** argv)
             no_reset = true;
             continue;
         }
+        else if (strcmp(argv[i], "-b") == 0)
+        {
+            bitmap_only = true;
+            continue;
+        }
         else if (strncmp(argv[i], "-c", 2) == 0)
         {
             if (argv[i][2] < '0' || argv[i][2] > '3')
@@ -1025,6 +1039,16 @@ int main(int argc, char ** argv)
     xvid_setw(XM_WR_XADDR, XR_PA_GFX_CTRL);
     xvid_setw(XM_XDATA, 0x0040);
     test_mono_bitmap("space_shuttle_color_small.raw");
+
+    if (bitmap_only)
+    {
+        spi_queue_flush();
+        host_spi_close();
+        printf("Exiting after bitmap upload (\"-b\" option)\n");
+
+        exit(EXIT_SUCCESS);
+    }
+
     delay(5000);        // let the stunning boot logo display. :)
 
     // text mode